@@ -0,0 +1,131 @@
+/**
+ * thread scaling of concurrent_lru against one lru behind a global mutex.
+ * build: g++ -std=c++17 -O2 -pthread -I../lru concurrent_lru.cpp -o concurrent_lru
+ * usage: ./concurrent_lru [max_threads [ops_per_thread]]
+ *   (default: hardware threads, 1000000)
+ * every op is a get, followed by a save on a miss (read-through);
+ * keys are drawn from 1M distinct keys, uniformly or zipfian (s = 0.99),
+ * and the caches hold a quarter of them.
+ * engines: global_mutex (one lru, one mutex), sharded (concurrent_lru,
+ * hits go through the read buffer, drained at threshold 16 and 4) and
+ * sharded_clock (CLOCK mode, hits only set a bit).
+ * output: csv, one line per (engine, distribution, threads):
+ *   million ops per second over all threads, hit ratio, and the
+ *   share of hits whose promotion the read buffer dropped
+*/
+#include "concurrent-lru.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+using cache_type = sjtu::concurrent_lru<long long, long long, std::hash<long long>, std::equal_to<long long> >;
+using clock_cache_type = sjtu::concurrent_lru<long long, long long, std::hash<long long>, std::equal_to<long long>,
+	std::allocator<sjtu::pair<const long long, long long> >, sjtu::pow2_hash_policy, sjtu::clock_eviction>;
+using lru_type = sjtu::basic_lru<long long, long long, std::hash<long long>, std::equal_to<long long> >;
+using value_type = sjtu::pair<const long long, long long>;
+
+const size_t key_count = 1 << 20;
+const size_t capacity = key_count / 4;
+
+/**
+ * ops keys for one thread; zipfian ranks are sampled by inverting
+ * the cdf and then scattered over the key space
+*/
+std::vector<long long> make_keys(const std::string &dist, const std::vector<double> &cdf, size_t ops, unsigned seed) {
+	std::mt19937_64 rng(seed);
+	std::uniform_real_distribution<double> unit(0.0, 1.0);
+	std::vector<long long> keys(ops);
+	for (auto &k: keys) {
+		size_t rank = dist == "uniform" ? size_t(rng() % key_count)
+			: size_t(std::lower_bound(cdf.begin(), cdf.end(), unit(rng)) - cdf.begin());
+		if (rank >= key_count) {rank = key_count - 1; }
+		k = (long long)((rank * 0x9E3779B97F4A7C15ull) >> 4);
+	}
+	return keys;
+}
+
+template<class Cache>
+void run_sharded(const char *engine, const std::string &dist, const std::vector<std::vector<long long> > &keys,
+	size_t threshold) {
+	Cache sharded(capacity, 64);
+	sharded.drain_threshold(threshold);
+	auto r = run(keys, [&](long long k) {
+		long long v;
+		if (sharded.get(k, v)) {return 1; }
+		sharded.save(value_type(k, k));
+		return 0;
+	});
+	sjtu::read_buffer_stats stats = sharded.read_stats();
+	double hits = r.second * keys.size() * keys[0].size();
+	std::cout << engine << "," << dist << "," << keys.size() << "," << r.first << "," << r.second << ","
+		<< (hits > 0 ? stats.dropped / hits : 0) << std::endl;
+}
+
+/**
+ * run op(key) over every thread's keys at once; return (mops, hit ratio)
+*/
+template<class Op>
+std::pair<double, double> run(const std::vector<std::vector<long long> > &keys, Op op) {
+	std::atomic<size_t> ready(0), hits(0);
+	std::atomic<bool> go(false);
+	std::vector<std::thread> workers;
+	for (size_t t = 0; t < keys.size(); ++t) {
+		workers.emplace_back([&, t]() {
+			++ready;
+			while (!go) {std::this_thread::yield(); }
+			size_t h = 0;
+			for (auto k: keys[t]) {h += op(k); }
+			hits += h;
+		});
+	}
+	while (ready < keys.size()) {std::this_thread::yield(); }
+	auto start = Clock::now();
+	go = true;
+	for (auto &w: workers) {w.join(); }
+	double sec = std::chrono::duration<double>(Clock::now() - start).count();
+	double ops = double(keys.size() * keys[0].size());
+	return std::make_pair(ops / sec / 1e6, double(hits) / ops);
+}
+
+int main(int argc, char **argv) {
+	size_t max_threads = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : std::thread::hardware_concurrency();
+	size_t ops = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000000;
+	if (max_threads == 0) {max_threads = 1; }
+
+	std::vector<double> cdf(key_count);
+	double sum = 0;
+	for (size_t i = 0; i < key_count; ++i) {cdf[i] = sum += 1.0 / std::pow(double(i + 1), 0.99); }
+	for (auto &c: cdf) {c /= sum; }
+
+	std::cout << "engine,dist,threads,mops,hit_ratio,dropped_ratio" << std::endl;
+	for (std::string dist: {"uniform", "zipf"}) {
+		for (size_t threads = 1; ; threads = std::min(threads * 2, max_threads)) {
+			std::vector<std::vector<long long> > keys;
+			for (size_t t = 0; t < threads; ++t) {keys.push_back(make_keys(dist, cdf, ops, unsigned(t + 1))); }
+
+			lru_type global(capacity);
+			std::mutex global_lock;
+			auto r = run(keys, [&](long long k) {
+				std::lock_guard<std::mutex> guard(global_lock);
+				if (global.get(k) != nullptr) {return 1; }
+				global.save(value_type(k, k));
+				return 0;
+			});
+			std::cout << "global_mutex," << dist << "," << threads << "," << r.first << "," << r.second << ",0" << std::endl;
+
+			run_sharded<cache_type>("sharded", dist, keys, 16);
+			run_sharded<cache_type>("sharded_drain4", dist, keys, 4);
+			run_sharded<clock_cache_type>("sharded_clock", dist, keys, 16);
+			if (threads == max_threads) {break; }
+		}
+	}
+	return 0;
+}
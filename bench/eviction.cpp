@@ -0,0 +1,102 @@
+/**
+ * hit ratio and throughput of the eviction modes on key traces.
+ * build: g++ -std=c++17 -O2 -I../lru eviction.cpp -o eviction
+ * usage: ./eviction capacity [trace ...]
+ *   a trace file is whitespace separated integer keys, one request
+ *   each; without files three synthetic traces are used:
+ *     zipf       2M requests, zipfian (s = 0.99) over 200k keys
+ *     zipf+scan  the same, with a 50k-key one-off scan every 200k
+ *     loop       2M requests cycling over 1.25 * capacity keys
+ * every request is a get, followed by a save on a miss.
+ * output: csv, one line per (mode, trace): hit ratio, million ops/s,
+ *   bytes the mode keeps besides the nodes (ghosts, sketch) per entry
+*/
+#include "eviction.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+using value_type = sjtu::pair<const long long, long long>;
+
+template<template<class> class Eviction>
+using cache_type = sjtu::basic_lru<long long, long long, std::hash<long long>, std::equal_to<long long>,
+	std::allocator<value_type>, sjtu::pow2_hash_policy, Eviction>;
+
+struct trace{
+	std::string name;
+	std::vector<long long> keys;
+};
+
+std::vector<long long> zipf_keys(size_t requests, size_t distinct, size_t scan_every, size_t scan_len) {
+	std::vector<double> cdf(distinct);
+	double sum = 0;
+	for (size_t i = 0; i < distinct; ++i) {cdf[i] = sum += 1.0 / std::pow(double(i + 1), 0.99); }
+	std::mt19937_64 rng(7);
+	std::uniform_real_distribution<double> unit(0.0, sum);
+	std::vector<long long> keys;
+	long long fresh = (long long)distinct;  // scan keys are never requested again
+	while (keys.size() < requests) {
+		if (scan_every != 0 && keys.size() % scan_every == scan_every - 1) {
+			for (size_t i = 0; i < scan_len; ++i) {keys.push_back(fresh++); }
+		}
+		keys.push_back(std::lower_bound(cdf.begin(), cdf.end(), unit(rng)) - cdf.begin());
+	}
+	return keys;
+}
+
+template<template<class> class Eviction>
+void run(const char *mode, const trace &t, size_t capacity) {
+	cache_type<Eviction> cache((int)capacity);
+	size_t hits = 0;
+	auto start = Clock::now();
+	for (auto k: t.keys) {
+		if (cache.get(k) != nullptr) {
+			++hits;
+		} else {
+			cache.save(value_type(k, k));
+		}
+	}
+	double sec = std::chrono::duration<double>(Clock::now() - start).count();
+	std::cout << mode << "," << t.name << "," << capacity << "," << double(hits) / t.keys.size() << ","
+		<< t.keys.size() / sec / 1e6 << "," << double(cache.eviction().bytes()) / cache.size() << std::endl;
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		std::cerr << "usage: " << argv[0] << " capacity [trace ...]" << std::endl;
+		return 1;
+	}
+	size_t capacity = std::strtoull(argv[1], nullptr, 10);
+	std::vector<trace> traces;
+	for (int i = 2; i < argc; ++i) {
+		std::ifstream in(argv[i]);
+		trace t{argv[i], {}};
+		for (long long k; in >> k; ) {t.keys.push_back(k); }
+		traces.push_back(t);
+	}
+	if (traces.empty()) {
+		traces.push_back({"zipf", zipf_keys(2000000, 200000, 0, 0)});
+		traces.push_back({"zipf+scan", zipf_keys(2000000, 200000, 200000, 50000)});
+		trace loop{"loop", {}};
+		for (size_t i = 0; i < 2000000; ++i) {loop.keys.push_back((long long)(i % (capacity + capacity / 4))); }
+		traces.push_back(loop);
+	}
+
+	std::cout << "mode,trace,capacity,hit_ratio,mops,meta_bytes_per_entry" << std::endl;
+	for (auto &t: traces) {
+		run<sjtu::lru_eviction>("lru", t, capacity);
+		run<sjtu::clock_eviction>("clock", t, capacity);
+		run<sjtu::fifo_eviction>("fifo", t, capacity);
+		run<sjtu::slru_eviction>("slru", t, capacity);
+		run<sjtu::two_queue_eviction>("2q", t, capacity);
+		run<sjtu::arc_eviction>("arc", t, capacity);
+		run<sjtu::tinylfu_eviction>("tinylfu", t, capacity);
+	}
+	return 0;
+}
@@ -0,0 +1,100 @@
+/**
+ * startup and lookups of a frozen (memory-mapped) map against the
+ * in-memory hashmap and linked_hashmap.
+ * build: g++ -std=c++17 -O2 -I../lru frozen.cpp -o frozen
+ * usage: ./frozen [dir] [n] [rows]
+ *   n entries (default 1000000) of Integer -> Matrix<int> rows x rows
+ *   (default 2), files in dir (default /tmp).
+ *   startup: rebuilding the linked_hashmap by inserts, loading it from
+ *   a snapshot (snapshot.hpp), and opening the frozen file.
+ *   lookups: 4M finds of random keys, half of them absent, reading
+ *   one element of each value found.
+ * output: csv engine,op,n,seconds,ns_per_op
+*/
+#include "frozen.hpp"
+#include "snapshot.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+using value_type = sjtu::pair<const Integer, Matrix<int> >;
+
+double since(Clock::time_point start) {
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void report(const char *engine, const char *op, size_t n, double sec) {
+	std::cout << engine << "," << op << "," << n << "," << sec << "," << sec / n * 1e9 << std::endl;
+}
+
+/**
+ * find(key) gives something that is null when absent and indexable
+ * as [0][0] otherwise; sums the first elements so nothing is skipped
+*/
+template<class F>
+void lookups(const char *engine, const std::vector<int> &keys, F &&find) {
+	long long sink = 0;
+	auto start = Clock::now();
+	for (int k: keys) {sink += find(k); }
+	report(engine, "find", keys.size(), since(start));
+	if (sink == 42) {std::cout << "";}
+}
+
+int main(int argc, char **argv) {
+	std::string dir = argc > 1 ? argv[1] : "/tmp";
+	size_t n = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000000;
+	size_t rows = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 2;
+	std::string snap = dir + "/sjtu-bench.snap", frozen = dir + "/sjtu-bench.frozen";
+	std::cout << "engine,op,n,seconds,ns_per_op" << std::endl;
+	try {
+		auto start = Clock::now();
+		sjtu::linked_hashmap<Integer, Matrix<int>, Hash, Equal> map;
+		for (size_t i = 0; i < n; ++i) {map.insert(value_type(Integer(int(i)), Matrix<int>(rows, rows, int(i)))); }
+		report("linked_hashmap", "insert_all", n, since(start));
+		sjtu::save_snapshot(map, snap.c_str());
+		sjtu::freeze(map, frozen.c_str());
+
+		start = Clock::now();
+		{
+			sjtu::linked_hashmap<Integer, Matrix<int>, Hash, Equal> loaded;
+			sjtu::load_snapshot(loaded, snap.c_str());
+			report("linked_hashmap", "load_snapshot", n, since(start));
+		}
+		start = Clock::now();
+		sjtu::frozen_map<> fmap(frozen.c_str());
+		report("frozen_map", "open", n, since(start));
+
+		sjtu::hashmap<Integer, Matrix<int>, Hash, Equal> hmap;
+		for (size_t i = 0; i < n; ++i) {hmap.insert(value_type(Integer(int(i)), Matrix<int>(rows, rows, int(i)))); }
+
+		std::mt19937 rng(5);
+		std::vector<int> keys(4000000);
+		for (auto &k: keys) {k = int(rng() % (2 * n)); }
+		// the first pass over the frozen file also faults its pages in
+		lookups("frozen_map(cold)", keys, [&](int k) {
+			auto m = fmap.find(Integer(k));
+			return m && rows != 0 ? m[0][0] : 0;
+		});
+		lookups("frozen_map", keys, [&](int k) {
+			auto m = fmap.find(Integer(k));
+			return m && rows != 0 ? m[0][0] : 0;
+		});
+		lookups("hashmap", keys, [&](int k) {
+			auto it = hmap.find(Integer(k));
+			return it != hmap.end() && rows != 0 ? it->second[0][0] : 0;
+		});
+		lookups("linked_hashmap", keys, [&](int k) {
+			auto it = map.find(Integer(k));
+			return it != map.end() && rows != 0 ? it->second[0][0] : 0;
+		});
+	} catch (const sjtu::exception &) {
+		std::cerr << "cannot write or read files in " << dir << std::endl;
+		return 1;
+	}
+	std::remove(snap.c_str());
+	std::remove(frozen.c_str());
+	return 0;
+}
@@ -0,0 +1,70 @@
+/**
+ * chain-length distribution of every hash policy on our key patterns.
+ * build: g++ -std=c++17 -O2 -I../lru hash_policy.cpp -o hash_policy
+ * usage: ./hash_policy [n]   (default: 1000000 keys per pattern)
+ * output: csv, one line per (policy, pattern):
+ *   buckets, empty bucket ratio, mean length of non-empty chains,
+ *   longest chain, ns per successful find
+*/
+#include "lru.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+std::vector<long long> make_keys(const std::string &pattern, size_t n) {
+	std::vector<long long> keys(n);
+	std::mt19937_64 rng(99);
+	for (size_t i = 0; i < n; ++i) {
+		if (pattern == "sequential") {keys[i] = i; }
+		else if (pattern == "mod99") {keys[i] = i * 99; }  // distinct keys of i-(i%99) in 8.cpp
+		else if (pattern == "stride1024") {keys[i] = i * 1024; }
+		else if (pattern == "stride4096+7") {keys[i] = i * 4096 + 7; }
+		else {keys[i] = (long long)(rng() >> 1); }
+	}
+	return keys;
+}
+
+template<class Policy>
+void run(const char *policy, const std::string &pattern, size_t n) {
+	using map_type = sjtu::hashmap<long long, long long, std::hash<long long>, std::equal_to<long long>,
+		std::allocator<sjtu::pair<const long long, long long> >, Policy>;
+	std::vector<long long> keys = make_keys(pattern, n);
+	map_type map;
+	for (auto k: keys) {map.insert(typename map_type::value_type(k, k)); }
+
+	size_t empty = 0, longest = 0, used = 0;
+	for (size_t b = 0; b < map.index.size; ++b) {
+		size_t len = 0;
+		for (auto cur = map.index.buckets[b]; cur != nullptr; cur = cur->chain) {++len; }
+		if (len == 0) {++empty; }
+		else {++used; }
+		if (len > longest) {longest = len; }
+	}
+
+	std::shuffle(keys.begin(), keys.end(), std::mt19937_64(1));
+	long long sink = 0;
+	auto start = Clock::now();
+	for (auto k: keys) {sink += map.find(k)->second; }
+	double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / n;
+
+	std::cout << policy << "," << pattern << "," << map.index.size << ","
+		<< double(empty) / map.index.size << "," << double(n) / used << ","
+		<< longest << "," << ns << (sink == 42 ? " " : "") << std::endl;
+}
+
+int main(int argc, char **argv) {
+	size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+	std::cout << "policy,pattern,buckets,empty_ratio,mean_chain,max_chain,find_ns" << std::endl;
+	for (std::string pattern: {"sequential", "mod99", "stride1024", "stride4096+7", "random"}) {
+		run<sjtu::mod_hash_policy>("mod", pattern, n);
+		run<sjtu::pow2_hash_policy>("pow2", pattern, n);
+		run<sjtu::fibonacci_hash_policy>("fibonacci", pattern, n);
+		run<sjtu::prime_hash_policy>("prime", pattern, n);
+	}
+	return 0;
+}
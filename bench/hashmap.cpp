@@ -0,0 +1,62 @@
+/**
+ * side-by-side benchmark of the chained hashmap and flat_hashmap.
+ * build: g++ -std=c++17 -O2 -I../lru hashmap.cpp -o hashmap
+ * usage: ./hashmap [n ...]   (default: 100000 1000000 10000000)
+ * output: csv, one line per (engine, n, op), time in ns per operation
+*/
+#include "lru.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+template<class Map>
+void run(const char *engine, size_t n) {
+	using value_type = typename Map::value_type;
+	std::mt19937_64 rng(20240311);
+	std::vector<long long> keys(n);
+	// even keys are inserted, odd keys are guaranteed misses
+	for (auto &k: keys) {k = (long long)(rng() >> 2) * 2; }
+
+	Map map;
+	auto report = [&](const char *op, Clock::time_point start) {
+		double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+		std::cout << engine << "," << n << "," << op << "," << ns / n << std::endl;
+	};
+	long long sink = 0;
+
+	auto start = Clock::now();
+	for (auto k: keys) {map.insert(value_type(k, k)); }
+	report("insert", start);
+
+	std::shuffle(keys.begin(), keys.end(), rng);
+	start = Clock::now();
+	for (auto k: keys) {sink += map.find(k)->second; }
+	report("find_hit", start);
+
+	start = Clock::now();
+	for (auto k: keys) {sink += map.find(k + 1) == map.end(); }
+	report("find_miss", start);
+
+	start = Clock::now();
+	for (auto k: keys) {sink += map.remove(k); }
+	report("remove", start);
+
+	if (sink == 42) {std::cout << "";}
+}
+
+int main(int argc, char **argv) {
+	std::vector<size_t> sizes;
+	for (int i = 1; i < argc; ++i) {sizes.push_back(std::strtoull(argv[i], nullptr, 10)); }
+	if (sizes.empty()) {sizes = {100000, 1000000, 10000000}; }
+
+	std::cout << "engine,n,op,ns_per_op" << std::endl;
+	for (auto n: sizes) {
+		run<sjtu::hashmap<long long, long long>>("chained", n);
+		run<sjtu::flat_hashmap<long long, long long>>("flat", n);
+	}
+	return 0;
+}
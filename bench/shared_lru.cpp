@@ -0,0 +1,168 @@
+/**
+ * worker processes with a private lru each against one shared_lru.
+ * build: g++ -std=c++17 -O2 -I../lru shared_lru.cpp -o shared_lru
+ * usage: ./shared_lru [max_workers [ops_per_worker]]
+ *   (default: hardware threads, 500000)
+ * each worker is a forked process; every op is a get, followed by a
+ * save on a miss (read-through), of a 4 x 4 Matrix<int>.  keys are
+ * zipfian (s = 0.99) over 1M distinct keys, and a cache holds 64K.
+ * engines: private (one lru of 64K per worker), private_split (one of
+ * 64K / workers per worker, the memory of one shared cache) and shared
+ * (one shared_lru of 64K in a 32 MB segment, 16 shards).
+ * output: csv, one line per (engine, workers): million ops per second
+ * over all workers, hit ratio, and the memory of the caches in MB
+ * (resident growth of the workers for private, the segment for shared)
+*/
+#include "shared-lru.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+
+using Clock = std::chrono::steady_clock;
+using value_type = sjtu::pair<const Integer, Matrix<int> >;
+
+const size_t key_count = 1 << 20;
+const size_t capacity = 1 << 16;
+
+std::vector<int> make_keys(const std::vector<double> &cdf, size_t ops, unsigned seed) {
+	std::mt19937_64 rng(seed);
+	std::uniform_real_distribution<double> unit(0.0, 1.0);
+	std::vector<int> keys(ops);
+	for (auto &k: keys) {
+		size_t rank = size_t(std::lower_bound(cdf.begin(), cdf.end(), unit(rng)) - cdf.begin());
+		if (rank >= key_count) {rank = key_count - 1; }
+		k = int((rank * 0x9E3779B97F4A7C15ull) >> 36);
+	}
+	return keys;
+}
+
+size_t resident_bytes() {
+	std::ifstream statm("/proc/self/statm");
+	size_t pages = 0, resident = 0;
+	statm >> pages >> resident;
+	return resident * size_t(sysconf(_SC_PAGESIZE));
+}
+
+struct result{
+	size_t hits;
+	size_t bytes;
+};
+
+/**
+ * fork one worker per key list, each running work(keys) -> result,
+ * started together, and print their line; shared_bytes is memory the
+ * workers share besides what they report
+*/
+template<class Work>
+void run(const char *engine, const std::vector<std::vector<int> > &keys, size_t shared_bytes, Work work) {
+	std::vector<pid_t> pids;
+	std::vector<int> reports;
+	int start[2];
+	if (::pipe(start) != 0) {throw sjtu::runtime_error(); }
+	for (size_t w = 0; w < keys.size(); ++w) {
+		int report[2];
+		if (::pipe(report) != 0) {throw sjtu::runtime_error(); }
+		pid_t pid = ::fork();
+		if (pid == 0) {
+			::close(start[1]);
+			::close(report[0]);
+			char go;
+			if (::read(start[0], &go, 1) != 1) {_exit(1); }
+			result r = work(keys[w]);
+			_exit(::write(report[1], &r, sizeof(r)) == sizeof(r) ? 0 : 1);
+		}
+		::close(report[1]);
+		pids.push_back(pid);
+		reports.push_back(report[0]);
+	}
+	::close(start[0]);
+	auto begin = Clock::now();
+	std::string go(keys.size(), 'g');
+	if (::write(start[1], go.data(), go.size()) != ssize_t(go.size())) {throw sjtu::runtime_error(); }
+	::close(start[1]);
+	result total = {0, shared_bytes};
+	for (size_t w = 0; w < keys.size(); ++w) {
+		result r = {0, 0};
+		if (::read(reports[w], &r, sizeof(r)) != sizeof(r)) {std::cerr << "worker " << w << " failed" << std::endl; }
+		::close(reports[w]);
+		total.hits += r.hits;
+		total.bytes += r.bytes;
+	}
+	double sec = std::chrono::duration<double>(Clock::now() - begin).count();
+	for (pid_t pid: pids) {::waitpid(pid, nullptr, 0); }
+	double ops = double(keys.size() * keys[0].size());
+	std::cout << engine << "," << keys.size() << "," << ops / sec / 1e6 << "," << total.hits / ops << ","
+		<< total.bytes / 1048576.0 << std::endl;
+}
+
+int main(int argc, char **argv) {
+	size_t max_workers = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : std::thread::hardware_concurrency();
+	size_t ops = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 500000;
+	if (max_workers == 0) {max_workers = 1; }
+	std::string name = "/sjtu-bench-" + std::to_string(::getpid());
+
+	std::vector<double> cdf(key_count);
+	double sum = 0;
+	for (size_t i = 0; i < key_count; ++i) {cdf[i] = sum += 1.0 / std::pow(double(i + 1), 0.99); }
+	for (auto &c: cdf) {c /= sum; }
+	const Matrix<int> value(4, 4, 1);
+
+	std::cout << "engine,workers,mops,hit_ratio,mb" << std::endl;
+	try {
+		for (size_t workers = 1; ; workers = std::min(workers * 2, max_workers)) {
+			std::vector<std::vector<int> > keys;
+			for (size_t w = 0; w < workers; ++w) {keys.push_back(make_keys(cdf, ops, unsigned(w + 1))); }
+
+			for (size_t each: {capacity, capacity / workers}) {
+				run(each == capacity ? "private" : "private_split", keys, 0, [&](const std::vector<int> &mine) {
+					size_t before = resident_bytes();
+					result r = {0, 0};
+					{
+						sjtu::lru cache(each);
+						for (int k: mine) {
+							if (cache.get(Integer(k)) != nullptr) {
+								++r.hits;
+							} else {
+								cache.save(value_type(Integer(k), value));
+							}
+						}
+						r.bytes = resident_bytes() - before;
+					}
+					return r;
+				});
+				if (workers == 1) {break; }
+			}
+
+			{
+				sjtu::shared_lru<> shared(name.c_str(), capacity, size_t(32) << 20, 16);
+				run("shared", keys, shared.bytes(), [&](const std::vector<int> &mine) {
+					sjtu::shared_lru<> cache(name.c_str());
+					result r = {0, 0};
+					Matrix<int> out;
+					for (int k: mine) {
+						if (cache.get(Integer(k), out)) {
+							++r.hits;
+						} else {
+							cache.save(Integer(k), value);
+						}
+					}
+					return r;
+				});
+				sjtu::shared_lru<>::unlink(name.c_str());
+			}
+			if (workers == max_workers) {break; }
+		}
+	} catch (const sjtu::exception &) {
+		sjtu::shared_lru<>::unlink(name.c_str());
+		std::cerr << "cannot create the shared segment " << name << std::endl;
+		return 1;
+	}
+	return 0;
+}
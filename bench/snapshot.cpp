@@ -0,0 +1,101 @@
+/**
+ * snapshot and warm-restart throughput of linked_hashmap and lru.
+ * build: g++ -std=c++17 -O2 -I../lru snapshot.cpp -o snapshot
+ * usage: ./snapshot [dir] [n]
+ *   n entries (default 200000) of int -> long long and Integer ->
+ *   Matrix<int> R x R for R = 2, 8, 32 (fewer if they would pass
+ *   256 MB), snapshotted to dir (default /tmp) and loaded back, best
+ *   of three rounds each.
+ *   the file is fresh in the page cache, so this is the cost of
+ *   (de)serializing and the buffered copies rather than of the disk.
+ *   the "insert" rows rebuild the same container from the entries in
+ *   memory, for scale.
+ * output: csv engine,value,n,bytes,op,seconds,gb_per_s
+*/
+#include "snapshot.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * best of three timings of f(*fresh()); making and destroying the
+ * container is not timed
+*/
+template<class Fresh, class F>
+double best_of_three(Fresh &&fresh, F &&f) {
+	double best = 1e30;
+	for (int round = 0; round < 3; ++round) {
+		auto target = fresh();
+		auto start = Clock::now();
+		f(*target);
+		best = std::min(best, std::chrono::duration<double>(Clock::now() - start).count());
+	}
+	return best;
+}
+
+void report(const char *engine, const std::string &value, size_t n, uint64_t bytes, const char *op, double sec) {
+	std::cout << engine << "," << value << "," << n << "," << bytes << "," << op << "," << sec << ","
+		<< double(bytes) / sec / 1e9 << std::endl;
+}
+
+/**
+ * fresh() makes an empty container, fill(map) puts the n entries in
+*/
+template<class Fresh, class Fill>
+void run(const char *engine, const std::string &value, size_t n, const std::string &path, Fresh fresh, Fill fill) {
+	auto source = fresh();
+	fill(*source);
+	uint64_t bytes = 0;
+	double save = best_of_three([&] {return source.get(); }, [&](decltype(*source) map) {
+		bytes = sjtu::save_snapshot(map, path.c_str());
+	});
+	report(engine, value, n, bytes, "save", save);
+	double load = best_of_three(fresh, [&](decltype(*source) warm) {sjtu::load_snapshot(warm, path.c_str()); });
+	report(engine, value, n, bytes, "load", load);
+	double insert = best_of_three(fresh, fill);
+	report(engine, value, n, bytes, "insert", insert);
+	std::remove(path.c_str());
+}
+
+struct integer_hash{
+	size_t operator()(const Integer &k) const {return std::hash<int>()(k.val); }
+};
+struct integer_equal{
+	bool operator()(const Integer &a, const Integer &b) const {return a.val == b.val; }
+};
+
+int main(int argc, char **argv) {
+	std::string dir = argc > 1 ? argv[1] : "/tmp";
+	size_t n = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 200000;
+	std::string path = dir + "/sjtu-bench.snap";
+	std::cout << "engine,value,n,bytes,op,seconds,gb_per_s" << std::endl;
+	try {
+		using int_map = sjtu::linked_hashmap<int, long long>;
+		using int_lru = sjtu::basic_lru<int, long long, std::hash<int>, std::equal_to<int>,
+			std::allocator<sjtu::pair<const int, long long> > >;
+		run("linked_hashmap", "int", n, path, [] {return std::unique_ptr<int_map>(new int_map()); },
+			[n](int_map &m) {for (size_t i = 0; i < n; ++i) {m.insert(sjtu::pair<const int, long long>(int(i), i)); } });
+		run("lru", "int", n, path, [n] {return std::unique_ptr<int_lru>(new int_lru(n)); },
+			[n](int_lru &l) {for (size_t i = 0; i < n; ++i) {l.save(sjtu::pair<const int, long long>(int(i), i)); } });
+
+		using matrix_map = sjtu::linked_hashmap<Integer, Matrix<int>, integer_hash, integer_equal>;
+		using value_type = sjtu::pair<const Integer, Matrix<int> >;
+		for (size_t r: {2, 8, 32}) {
+			// at most 256 MB of matrices
+			size_t m = std::min(n, (size_t(256) << 20) / (r * r * sizeof(int)));
+			std::string value = "m" + std::to_string(r);
+			run("linked_hashmap", value, m, path, [] {return std::unique_ptr<matrix_map>(new matrix_map()); },
+				[m, r](matrix_map &map) {for (size_t i = 0; i < m; ++i) {map.insert(value_type(Integer(int(i)), Matrix<int>(r, r, int(i)))); } });
+			run("lru", value, m, path, [m] {return std::unique_ptr<sjtu::lru>(new sjtu::lru(m)); },
+				[m, r](sjtu::lru &l) {for (size_t i = 0; i < m; ++i) {l.save(value_type(Integer(int(i)), Matrix<int>(r, r, int(i)))); } });
+		}
+	} catch (const sjtu::exception &) {
+		std::cerr << "cannot write or read " << path << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,434 @@
+/**
+ * throughput and latency of hashmap, linked_hashmap and lru against
+ * std::unordered_map (and std::unordered_map + std::list for the lru)
+ * under generated key streams.
+ * build: g++ -std=c++17 -O2 -I../lru suite.cpp -o suite
+ * usage: ./suite [--json] [--sizes n,...] [--values v,...] [--skew s]
+ *                [--read r] [--mem MB]
+ *   sizes   entries per table, default 1000,10000,100000,1000000
+ *           (up to 10000000 is fine if the values fit in --mem)
+ *   values  int (Integer) or mR (Matrix<int> R x R), default
+ *           int,m2,m8,m64; a size whose entries would not fit in
+ *           --mem (default 2048) megabytes is skipped
+ *   skew    zipf exponent, default 0.99
+ *   read    share of reads in the mixed workload, default 0.9
+ *
+ * keys are ints drawn from a space of 2n, so about half the lookups
+ * of n stored entries miss.  workloads:
+ *   uniform  every key equally likely
+ *   zipf     key ranks zipfian with exponent skew (hot keys scattered)
+ *   scan     0, 1, 2, ... over the whole key space, again and again
+ *   mixed    zipf keys, a share `read` of the operations read and the
+ *            rest write (maps: half insert, half remove; caches: save)
+ * per engine and size: insert n keys, then for every workload a stream
+ * of max(2n, 200000) operations (find on maps, get and save-on-miss on
+ * caches, which start full), then remove on maps.
+ * every 8th operation is timed on its own for the percentiles (the
+ * cost of reading the clock is measured and subtracted); throughput is
+ * over the whole stream, sampled operations included.
+ * output: csv (or one json object per line) of
+ *   engine,value,n,workload,op,ops,mops,hit_ratio,p50_ns,p90_ns,p99_ns,p999_ns
+ * hit_ratio is the share of reads that found their key (1 for the
+ * insert and remove rows).
+*/
+#include "lru.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * zipf ranks 1..n by rejection-inversion (Hörmann & Derflinger), so
+ * no table of n probabilities is needed
+*/
+class zipf_distribution{
+public:
+	zipf_distribution(long long n, double s): n(n), s(s) {
+		hX1 = H(1.5) - 1.0;
+		hN = H(n + 0.5);
+		cut = 2.0 - H_inverse(H(2.5) - h(2.0));
+	}
+	template<class Rng>
+	long long operator()(Rng &rng) {
+		std::uniform_real_distribution<double> unit(0.0, 1.0);
+		while (true) {
+			double u = hN + unit(rng) * (hX1 - hN);
+			double x = H_inverse(u);
+			long long k = (long long)(x + 0.5);
+			if (k < 1) {k = 1; }
+			else if (k > n) {k = n; }
+			if (k - x <= cut || u >= H(k + 0.5) - h(double(k))) {return k; }
+		}
+	}
+private:
+	long long n;
+	double s, hX1, hN, cut;
+
+	double h(double x) const {
+		return std::exp(-s * std::log(x));
+	}
+	double H(double x) const {
+		double lx = std::log(x);
+		return expm1_over((1.0 - s) * lx) * lx;
+	}
+	double H_inverse(double x) const {
+		double t = x * (1.0 - s);
+		if (t < -1.0) {t = -1.0; }
+		return std::exp(log1p_over(t) * x);
+	}
+	static double log1p_over(double x) {
+		return std::fabs(x) > 1e-8 ? std::log1p(x) / x : 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+	}
+	static double expm1_over(double x) {
+		return std::fabs(x) > 1e-8 ? std::expm1(x) / x : 1.0 + x * 0.5 * (1.0 + x / 3.0 * (1.0 + 0.25 * x));
+	}
+};
+
+struct options{
+	bool json = false;
+	std::vector<size_t> sizes{1000, 10000, 100000, 1000000};
+	std::vector<std::string> values{"int", "m2", "m8", "m64"};
+	double skew = 0.99;
+	double read = 0.9;
+	size_t memMB = 2048;
+};
+
+/**
+ * one operation of a stream: the key, and whether it writes
+*/
+struct request{
+	int key;
+	bool write;
+};
+
+std::vector<request> make_stream(const std::string &workload, size_t ops, int space, const options &opt) {
+	std::vector<request> stream(ops);
+	std::mt19937_64 rng(12345);
+	std::uniform_int_distribution<int> uniform(0, space - 1);
+	std::uniform_real_distribution<double> unit(0.0, 1.0);
+	zipf_distribution zipf(space, opt.skew);
+	for (size_t i = 0; i < ops; ++i) {
+		request &r = stream[i];
+		r.write = false;
+		if (workload == "uniform") {r.key = uniform(rng); }
+		else if (workload == "scan") {r.key = int(i % size_t(space)); }
+		else {
+			// scatter the ranks over the key space (2654435761 is prime)
+			r.key = int((unsigned long long)(zipf(rng) - 1) * 2654435761ull % (unsigned long long)space);
+			if (workload == "mixed") {r.write = unit(rng) >= opt.read; }
+		}
+	}
+	return stream;
+}
+
+template<class V> V make_value(int key);
+template<> Integer make_value<Integer>(int key) {
+	return Integer(key);
+}
+template<size_t R> struct square{
+	static Matrix<int> make(int key) {return Matrix<int>(R, R, key); }
+};
+
+/**
+ * latency samples of a stream and its total time
+*/
+class recorder{
+public:
+	static const size_t every = 8;
+	explicit recorder(size_t ops) {
+		samples.reserve(ops / every + 1);
+	}
+	template<class F>
+	void run(size_t i, F &&op) {
+		if (i % every != 0) {
+			op();
+			return;
+		}
+		auto t = Clock::now();
+		op();
+		samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - t).count());
+	}
+	double percentile(double q) {
+		if (samples.empty()) {return 0; }
+		size_t k = size_t(q * (samples.size() - 1));
+		std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+		double ns = samples[k] - overhead();
+		return ns > 0 ? ns : 0;
+	}
+	/**
+	 * the cheapest back-to-back clock reading, taken as its cost
+	*/
+	static double overhead() {
+		static double cost = [] {
+			double best = 1e9;
+			for (int i = 0; i < 10000; ++i) {
+				auto t = Clock::now();
+				double ns = std::chrono::duration<double, std::nano>(Clock::now() - t).count();
+				if (ns < best) {best = ns; }
+			}
+			return best;
+		}();
+		return cost;
+	}
+private:
+	std::vector<double> samples;
+};
+
+class reporter{
+public:
+	explicit reporter(const options &o): opt(o) {
+		if (!opt.json) {
+			std::cout << "engine,value,n,workload,op,ops,mops,hit_ratio,p50_ns,p90_ns,p99_ns,p999_ns" << std::endl;
+		}
+	}
+	void row(const std::string &engine, const std::string &value, size_t n, const std::string &workload,
+		const std::string &op, size_t ops, double sec, size_t hits, recorder &rec) {
+		double mops = ops / sec / 1e6, ratio = double(hits) / ops;
+		double p50 = rec.percentile(0.5), p90 = rec.percentile(0.9), p99 = rec.percentile(0.99), p999 = rec.percentile(0.999);
+		if (opt.json) {
+			std::cout << "{\"engine\":\"" << engine << "\",\"value\":\"" << value << "\",\"n\":" << n
+				<< ",\"workload\":\"" << workload << "\",\"op\":\"" << op << "\",\"ops\":" << ops
+				<< ",\"mops\":" << mops << ",\"hit_ratio\":" << ratio << ",\"p50_ns\":" << p50
+				<< ",\"p90_ns\":" << p90 << ",\"p99_ns\":" << p99 << ",\"p999_ns\":" << p999 << "}" << std::endl;
+		} else {
+			std::cout << engine << "," << value << "," << n << "," << workload << "," << op << "," << ops << ","
+				<< mops << "," << ratio << "," << p50 << "," << p90 << "," << p99 << "," << p999 << std::endl;
+		}
+	}
+private:
+	const options &opt;
+};
+
+/**
+ * the engines behind one interface:
+ * maps     insert(k, v), find(k) -> found, remove(k)
+ * caches   get(k) -> found, save(k, v)
+*/
+template<class V> struct sjtu_hashmap{
+	static const char *name() {return "hashmap"; }
+	sjtu::hashmap<Integer, V, Hash, Equal> map;
+	void insert(int k, V &&v) {map.insert(typename sjtu::hashmap<Integer, V, Hash, Equal>::value_type(Integer(k), std::move(v))); }
+	bool find(int k) {return map.find(Integer(k)) != map.end(); }
+	void remove(int k) {map.remove(Integer(k)); }
+};
+template<class V> struct sjtu_linked_hashmap{
+	static const char *name() {return "linked_hashmap"; }
+	sjtu::linked_hashmap<Integer, V, Hash, Equal> map;
+	void insert(int k, V &&v) {map.insert(typename sjtu::linked_hashmap<Integer, V, Hash, Equal>::value_type(Integer(k), std::move(v))); }
+	bool find(int k) {return map.find(Integer(k)) != map.end(); }
+	void remove(int k) {
+		auto it = map.find(Integer(k));
+		if (it != map.end()) {map.remove(it); }
+	}
+};
+template<class V> struct std_hashmap{
+	static const char *name() {return "std_unordered_map"; }
+	std::unordered_map<Integer, V, Hash, Equal> map;
+	void insert(int k, V &&v) {map.insert_or_assign(Integer(k), std::move(v)); }
+	bool find(int k) {return map.find(Integer(k)) != map.end(); }
+	void remove(int k) {map.erase(Integer(k)); }
+};
+
+template<class V> struct sjtu_cache{
+	static const char *name() {return "lru"; }
+	sjtu::basic_lru<Integer, V, Hash, Equal> cache;
+	explicit sjtu_cache(size_t capacity): cache(capacity) {}
+	bool get(int k) {return cache.get(Integer(k)) != nullptr; }
+	void save(int k, V &&v) {cache.save(sjtu::pair<const Integer, V>(Integer(k), std::move(v))); }
+};
+template<class V> struct std_cache{
+	static const char *name() {return "std_list_lru"; }
+	using entry = std::pair<Integer, V>;
+	std::list<entry> order;
+	std::unordered_map<Integer, typename std::list<entry>::iterator, Hash, Equal> index;
+	size_t capacity;
+	explicit std_cache(size_t c): capacity(c) {}
+	bool get(int k) {
+		auto it = index.find(Integer(k));
+		if (it == index.end()) {return false; }
+		order.splice(order.end(), order, it->second);
+		return true;
+	}
+	void save(int k, V &&v) {
+		auto it = index.find(Integer(k));
+		if (it != index.end()) {
+			it->second->second = std::move(v);
+			order.splice(order.end(), order, it->second);
+			return;
+		}
+		if (index.size() >= capacity) {
+			index.erase(order.front().first);
+			order.pop_front();
+		}
+		order.emplace_back(Integer(k), std::move(v));
+		index.emplace(Integer(k), std::prev(order.end()));
+	}
+};
+
+const char *workloads[] = {"uniform", "zipf", "scan", "mixed"};
+
+/**
+ * the op column: the read op, or read/write for the mixed workload
+*/
+std::string r_op(const std::string &workload, const std::string &read) {
+	return workload == "mixed" ? read + "/write" : read;
+}
+
+size_t stream_length(size_t n) {
+	return std::max<size_t>(2 * n, 200000);
+}
+
+template<class Engine, class V, class Make>
+void bench_map(const std::string &value, size_t n, Make make, const options &opt, reporter &out) {
+	Engine engine;
+	int space = int(2 * n);
+	std::vector<int> keys(space);
+	for (int i = 0; i < space; ++i) {keys[i] = i; }
+	std::shuffle(keys.begin(), keys.end(), std::mt19937_64(7));
+	keys.resize(n);
+
+	recorder ins(n);
+	auto start = Clock::now();
+	for (size_t i = 0; i < n; ++i) {ins.run(i, [&] {engine.insert(keys[i], make(keys[i])); }); }
+	out.row(Engine::name(), value, n, "uniform", "insert", n, std::chrono::duration<double>(Clock::now() - start).count(), n, ins);
+
+	for (auto workload: workloads) {
+		auto stream = make_stream(workload, stream_length(n), space, opt);
+		recorder rec(stream.size());
+		size_t hits = 0, flip = 0;
+		start = Clock::now();
+		for (size_t i = 0; i < stream.size(); ++i) {
+			const request &r = stream[i];
+			rec.run(i, [&] {
+				if (!r.write) {hits += engine.find(r.key); }
+				else if (++flip & 1) {engine.insert(r.key, make(r.key)); }
+				else {engine.remove(r.key); }
+			});
+		}
+		out.row(Engine::name(), value, n, workload, r_op(workload, "find"), stream.size(),
+			std::chrono::duration<double>(Clock::now() - start).count(), hits, rec);
+	}
+
+	recorder rem(n);
+	start = Clock::now();
+	for (size_t i = 0; i < n; ++i) {rem.run(i, [&] {engine.remove(keys[i]); }); }
+	out.row(Engine::name(), value, n, "uniform", "remove", n, std::chrono::duration<double>(Clock::now() - start).count(), n, rem);
+}
+
+template<class Engine, class V, class Make>
+void bench_cache(const std::string &value, size_t n, Make make, const options &opt, reporter &out) {
+	int space = int(2 * n);
+	for (auto workload: workloads) {
+		Engine engine(n);
+		// start full: the first n keys of a shuffled space
+		std::vector<int> keys(space);
+		for (int i = 0; i < space; ++i) {keys[i] = i; }
+		std::shuffle(keys.begin(), keys.end(), std::mt19937_64(7));
+		for (size_t i = 0; i < n; ++i) {engine.save(keys[i], make(keys[i])); }
+
+		auto stream = make_stream(workload, stream_length(n), space, opt);
+		recorder rec(stream.size());
+		size_t hits = 0, reads = 0;
+		auto start = Clock::now();
+		for (size_t i = 0; i < stream.size(); ++i) {
+			const request &r = stream[i];
+			rec.run(i, [&] {
+				if (r.write) {
+					engine.save(r.key, make(r.key));
+					return;
+				}
+				++reads;
+				if (engine.get(r.key)) {++hits; }
+				else {engine.save(r.key, make(r.key)); }
+			});
+		}
+		double sec = std::chrono::duration<double>(Clock::now() - start).count();
+		// hit ratio over the reads: scale hits to the stream length
+		size_t scaled = reads == 0 ? 0 : size_t(double(hits) / reads * stream.size());
+		out.row(Engine::name(), value, n, workload, r_op(workload, "get"), stream.size(), sec, scaled, rec);
+	}
+}
+
+template<class V, class Make>
+void bench_value(const std::string &value, size_t n, Make make, const options &opt, reporter &out) {
+	bench_map<sjtu_hashmap<V>, V>(value, n, make, opt, out);
+	bench_map<sjtu_linked_hashmap<V>, V>(value, n, make, opt, out);
+	bench_map<std_hashmap<V>, V>(value, n, make, opt, out);
+	bench_cache<sjtu_cache<V>, V>(value, n, make, opt, out);
+	bench_cache<std_cache<V>, V>(value, n, make, opt, out);
+}
+
+template<size_t R>
+bool bench_square(size_t rows, size_t n, const options &opt, reporter &out) {
+	if (rows != R) {return false; }
+	bench_value<Matrix<int> >("m" + std::to_string(R), n, square<R>::make, opt, out);
+	return true;
+}
+
+std::vector<std::string> split(const char *list) {
+	std::vector<std::string> parts;
+	std::string cur;
+	for (const char *p = list; ; ++p) {
+		if (*p == ',' || *p == '\0') {
+			if (!cur.empty()) {parts.push_back(cur); }
+			cur.clear();
+			if (*p == '\0') {break; }
+		} else {
+			cur += *p;
+		}
+	}
+	return parts;
+}
+
+int main(int argc, char **argv) {
+	options opt;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		bool more = i + 1 < argc;
+		if (arg == "--json") {opt.json = true; }
+		else if (arg == "--sizes" && more) {
+			opt.sizes.clear();
+			for (auto &s: split(argv[++i])) {opt.sizes.push_back(std::strtoull(s.c_str(), nullptr, 10)); }
+		}
+		else if (arg == "--values" && more) {opt.values = split(argv[++i]); }
+		else if (arg == "--skew" && more) {opt.skew = std::atof(argv[++i]); }
+		else if (arg == "--read" && more) {opt.read = std::atof(argv[++i]); }
+		else if (arg == "--mem" && more) {opt.memMB = std::strtoull(argv[++i], nullptr, 10); }
+		else {
+			std::cerr << "usage: " << argv[0] << " [--json] [--sizes n,...] [--values int,m2,...] [--skew s] [--read r] [--mem MB]" << std::endl;
+			return 1;
+		}
+	}
+
+	reporter out(opt);
+	for (auto &value: opt.values) {
+		size_t rows = value == "int" ? 0 : std::strtoull(value.c_str() + 1, nullptr, 10);
+		size_t entry = rows * rows * sizeof(int) + 128;  // payload plus node and bucket, roughly
+		for (auto n: opt.sizes) {
+			if (n * entry > opt.memMB << 20) {
+				std::cerr << "skip " << value << " n=" << n << ": about " << (n * entry >> 20) << " MB" << std::endl;
+				continue;
+			}
+			if (rows == 0) {
+				bench_value<Integer>(value, n, make_value<Integer>, opt, out);
+				continue;
+			}
+			bool known = bench_square<2>(rows, n, opt, out) || bench_square<4>(rows, n, opt, out)
+				|| bench_square<8>(rows, n, opt, out) || bench_square<16>(rows, n, opt, out)
+				|| bench_square<32>(rows, n, opt, out) || bench_square<64>(rows, n, opt, out);
+			if (!known) {
+				std::cerr << "unknown value " << value << " (int, m2, m4, m8, m16, m32 or m64)" << std::endl;
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
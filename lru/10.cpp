@@ -0,0 +1,103 @@
+#include "src.hpp"
+#if defined (_UNORDERED_MAP_)  || (defined (_LIST_)) || (defined (_MAP_)) || (defined (_SET_)) || (defined (_UNORDERED_SET_))||(defined (_GLIBCXX_MAP)) || (defined (_GLIBCXX_UNORDERED_MAP))
+BOOM :)
+#endif
+#include <iostream>
+#include <string>
+#include <memory_resource>
+
+// the same workload on every allocator must print the same thing
+#define _OUTPUT_
+
+std::string c[]={
+    "   pass!",
+    "   error.",
+    "allocator: std::allocator",
+    "allocator: sjtu::pool_allocator",
+    "allocator: std::pmr::polymorphic_allocator(node_pool)",
+    "allocator: std::pmr::polymorphic_allocator(monotonic_buffer_resource)",
+    "hashmap churn",
+    "Congratulations. Your submission has passed all correctness tests. Good job! :)",
+    "test: memcheck",
+};
+
+using value_type = sjtu::pair<Integer,Matrix<int> >;
+
+template<class Lru>
+void lru_workload(Lru &tester){
+    const int n=3000;
+    for(int i=0;i<n;i++){
+        tester.save(value_type(Integer(i),Matrix<int>(2,2,i)));
+        tester.get(Integer(i-(i%37)));
+    }
+    tester.print();
+}
+
+template<class Map>
+void hashmap_churn(Map &map){
+    using pair_type = sjtu::pair<Integer,Integer>;
+    const int n=20000;
+    for(int round=0;round<4;round++){
+        for(int i=0;i<n;i++){
+            map.insert(pair_type(Integer(i),Integer(i+round)));
+        }
+        for(int i=0;i<n;i+=2){
+            map.remove(Integer(i));
+        }
+    }
+    Map copy(map);
+    long long sum=0;
+    for(int i=0;i<n;i++){
+        auto it = copy.find(Integer(i));
+        if(it != copy.end()) sum += (*it).second.val;
+    }
+    std::cout<<sum<<std::endl;
+}
+
+int main(){
+#ifdef _OUTPUT_
+    freopen("10.out","w",stdout);
+#endif
+    using pool_alloc = sjtu::pool_allocator<value_type>;
+    using pmr_alloc = std::pmr::polymorphic_allocator<value_type>;
+    {
+        std::cout<<c[2]<<std::endl;
+        sjtu::lru tester(50);
+        lru_workload(tester);
+    }
+    {
+        std::cout<<c[3]<<std::endl;
+        sjtu::node_pool pool;
+        sjtu::basic_lru<Integer,Matrix<int>,Hash,Equal,pool_alloc> tester(50, pool_alloc(pool));
+        lru_workload(tester);
+    }
+    {
+        std::cout<<c[4]<<std::endl;
+        sjtu::node_pool pool;
+        sjtu::basic_lru<Integer,Matrix<int>,Hash,Equal,pmr_alloc> tester(50, pmr_alloc(&pool));
+        lru_workload(tester);
+    }
+    {
+        std::cout<<c[5]<<std::endl;
+        std::pmr::monotonic_buffer_resource arena;
+        sjtu::basic_lru<Integer,Matrix<int>,Hash,Equal,pmr_alloc> tester(50, pmr_alloc(&arena));
+        lru_workload(tester);
+    }
+    {
+        std::cout<<c[6]<<std::endl;
+        sjtu::hashmap<Integer,Integer,Hash,Equal> plain;
+        hashmap_churn(plain);
+        sjtu::node_pool pool;
+        sjtu::hashmap<Integer,Integer,Hash,Equal,sjtu::pool_allocator<sjtu::pair<const Integer,Integer> > > pooled(1024, pool);
+        hashmap_churn(pooled);
+    }
+    std::cout<<c[8];
+    if(Integer::counter == 0){
+        std::cout<<c[0]<<std::endl;
+    }
+    else{
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+    std::cout << c[7] << std::endl;
+}
@@ -0,0 +1,122 @@
+#include "src.hpp"
+#if defined (_UNORDERED_MAP_)  || (defined (_LIST_)) || (defined (_MAP_)) || (defined (_SET_)) || (defined (_UNORDERED_SET_))||(defined (_GLIBCXX_MAP)) || (defined (_GLIBCXX_UNORDERED_MAP))
+BOOM :)
+#endif
+#include <iostream>
+#include <string>
+
+// incremental rehash must not change what the containers hold
+#define _OUTPUT_
+
+std::string c[]={
+    "   pass!",
+    "   error.",
+    "test: hashmap incremental rehash",
+    "test: iterate while resizing",
+    "test: lru incremental rehash",
+    "Congratulations. Your submission has passed all correctness tests. Good job! :)",
+    "test: memcheck",
+    "test: low max load",
+};
+
+void hashmap_tester(){
+    using value_type = sjtu::pair<Integer,Integer>;
+    using mp = sjtu::hashmap<Integer,Integer,Hash,Equal>;
+    const int n = 20000;
+    std::cout<<c[2];
+    mp map;
+    map.incremental_rehash(true);
+    for(int i=0;i<n;i++){
+        map.insert(value_type(Integer(i),Integer(i)));
+        if(i%7==0) map.remove(Integer(i/2));
+    }
+    for(int i=0;i<n;i++){
+        mp::iterator it = map.find(Integer(i));
+        bool removed = ((2*i)%7==0 && 2*i<n) || ((2*i+1)%7==0 && 2*i+1<n);
+        if(removed != (it == map.end()) || (!removed && (*it).second.val != i)){
+            std::cout<<c[1]<<std::endl;
+            exit(0);
+        }
+    }
+    std::cout<<c[0]<<std::endl;
+
+    std::cout<<c[3];
+    // stop in the middle of a resize, then walk the whole map
+    mp map2;
+    map2.incremental_rehash(true);
+    int cnt = 0;
+    for(int i=0;i<513;i++){
+        map2.insert(value_type(Integer(i),Integer(i)));
+    }
+    for(mp::iterator it = map2.begin();it != map2.end();it++){
+        cnt++;
+    }
+    mp map3(map2);
+    map2.clear();
+    for(mp::iterator it = map3.begin();it != map3.end();it++){
+        cnt--;
+    }
+    std::cout<<(cnt == 0 ? c[0] : c[1])<<std::endl;
+}
+
+void lru_tester(){
+    using value_type = sjtu::pair<Integer,Matrix<int> >;
+    std::cout<<c[4]<<std::endl;
+    sjtu::lru tester(3000);
+    tester.incremental_rehash(true);
+    const int n=10000;
+    for(int i=0;i<n;i++){
+        tester.save(value_type( Integer(i),Matrix<int>(1,1,i)));
+        tester.get(Integer(i-(i%99)));
+    }
+    tester.print();
+}
+
+// however low the max load, a resize is done before the next one starts,
+// so no insert has to finish one
+void low_load_tester(){
+    using value_type = sjtu::pair<Integer,Integer>;
+    using mp = sjtu::hashmap<Integer,Integer,Hash,Equal>;
+    std::cout<<c[7];
+    for(double ml: {0.01, 0.1, 0.3, 0.5, 2.0}){
+        mp map(8);
+        map.incremental_rehash(true);
+        map.max_load_factor(ml);
+        for(int i=0;i<20000;i++){
+            bool resizing = map.index.resizing();
+            size_t buckets = map.bucket_count();
+            map.insert(value_type(Integer(i),Integer(i)));
+            if(i%5==0) map.remove(Integer(i/2));
+            if(map.bucket_count() != buckets && resizing){
+                std::cout<<c[1]<<std::endl;
+                exit(0);
+            }
+        }
+        for(int i=0;i<20000;i++){
+            bool removed = (i*2<20000 && (i*2)%5==0) || (i*2+1<20000 && (i*2+1)%5==0);
+            if(removed != (map.find(Integer(i)) == map.end())){
+                std::cout<<c[1]<<std::endl;
+                exit(0);
+            }
+        }
+    }
+    std::cout<<c[0]<<std::endl;
+}
+
+int main(){
+#ifdef _OUTPUT_
+    freopen("11.out","w",stdout);
+#endif
+    hashmap_tester();
+    lru_tester();
+    low_load_tester();
+    std::cout<<c[6];
+    if(Integer::counter == 0){
+        std::cout<<c[0]<<std::endl;
+    }
+    else{
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+    std::cout << c[5] << std::endl;
+}
@@ -0,0 +1,144 @@
+#include "src.hpp"
+#if defined (_UNORDERED_MAP_)  || (defined (_LIST_)) || (defined (_MAP_)) || (defined (_SET_)) || (defined (_UNORDERED_SET_))||(defined (_GLIBCXX_MAP)) || (defined (_GLIBCXX_UNORDERED_MAP))
+BOOM :)
+#endif
+#include <iostream>
+#include <string>
+#include <cmath>
+
+// cached hash codes: string keys keep their hash in the node
+#define _OUTPUT_
+
+std::string c[]={
+    "   pass!",
+    "   error.",
+    "test: hashmap cached hash",
+    "test: linked_hashmap cached hash",
+    "test: flat_hashmap cached hash",
+    "Congratulations. Your submission has passed all correctness tests. Good job! :)",
+    "test: hashmap max_load_factor",
+    "test: linked_hashmap max_load_factor",
+    "test: flat_hashmap max_load_factor",
+};
+
+long long hashCalls = 0, equalCalls = 0;
+struct CountHash {
+    size_t operator()(const std::string &s) const {
+        hashCalls++;
+        return std::hash<std::string>()(s);
+    }
+};
+struct CountEqual {
+    bool operator()(const std::string &a, const std::string &b) const {
+        equalCalls++;
+        return a == b;
+    }
+};
+
+std::string key(int i){
+    return "key-" + std::to_string(i);
+}
+
+void check(bool ok){
+    if(!ok){
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+}
+
+template<class Map>
+bool erase(Map &map, const std::string &k){
+    return map.remove(k);
+}
+template<class... Args>
+bool erase(sjtu::linked_hashmap<Args...> &map, const std::string &k){
+    auto it = map.find(k);
+    if(it == map.end()) return false;
+    map.remove(it);
+    return true;
+}
+
+// n inserts through several resizes, then hits and misses;
+// a resize must not call Hash and a miss must not call Equal
+template<class Map>
+void tester(int title){
+    using value_type = typename Map::value_type;
+    const int n = 20000;
+    std::cout<<c[title];
+    Map map;
+    for(int i=0;i<n;i++){
+        map.insert(value_type(key(i),i));
+    }
+    hashCalls = 0;
+    map.rehash(map.bucket_count() * 4);
+    check(hashCalls == 0);
+    equalCalls = 0;
+    for(int i=0;i<n;i++){
+        check(map.find(key(i)) != map.end() && map.find(key(i))->second == i);
+        check(map.find(key(i + n)) == map.end());
+    }
+    check(equalCalls == 2 * n);
+    for(int i=0;i<n;i+=3){
+        check(erase(map, key(i)));
+    }
+    Map map2(map);
+    for(int i=0;i<n;i++){
+        check((map2.find(key(i)) == map2.end()) == (i % 3 == 0));
+    }
+    std::cout<<c[0]<<std::endl;
+}
+
+// a load factor that is not positive is refused, one too small or
+// too big is clamped, so inserts still end
+template<class Map>
+void load_tester(int title){
+    using value_type = typename Map::value_type;
+    std::cout<<c[title];
+    Map map;
+    double before = map.max_load_factor();
+    for(double ml: {0.0, -1.0, std::nan("")}){
+        bool thrown = false;
+        try{
+            map.max_load_factor(ml);
+        }catch(const sjtu::runtime_error &){
+            thrown = true;
+        }
+        check(thrown && map.max_load_factor() == before);
+    }
+    map.max_load_factor(1e-9);
+    check(map.max_load_factor() > 0);
+    for(int i=0;i<2000;i++){
+        map.insert(value_type(key(i),i));
+    }
+    check(map.load_factor() <= map.max_load_factor());
+    map.max_load_factor(1e9);
+    check(map.max_load_factor() <= 64);
+    for(int i=0;i<2000;i++){
+        check(map.find(key(i)) != map.end() && map.find(key(i))->second == i);
+    }
+    // a copy, made or assigned, grows like the original
+    map.max_load_factor(0.25);
+    Map made(map), assigned;
+    assigned = map;
+    check(made.max_load_factor() == 0.25 && assigned.max_load_factor() == 0.25);
+    for(int i=2000;i<4000;i++){
+        map.insert(value_type(key(i),i));
+        made.insert(value_type(key(i),i));
+        assigned.insert(value_type(key(i),i));
+        check(made.bucket_count() == map.bucket_count() && assigned.load_factor() <= 0.25);
+    }
+    std::cout<<c[0]<<std::endl;
+}
+
+int main(){
+#ifdef _OUTPUT_
+    freopen("12.out","w",stdout);
+#endif
+    tester<sjtu::hashmap<std::string,int,CountHash,CountEqual> >(2);
+    tester<sjtu::linked_hashmap<std::string,int,CountHash,CountEqual> >(3);
+    tester<sjtu::flat_hashmap<std::string,int,CountHash,CountEqual> >(4);
+    load_tester<sjtu::hashmap<std::string,int> >(6);
+    load_tester<sjtu::linked_hashmap<std::string,int> >(7);
+    load_tester<sjtu::flat_hashmap<std::string,int> >(8);
+    std::cout << c[5] << std::endl;
+}
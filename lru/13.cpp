@@ -0,0 +1,123 @@
+#include "src.hpp"
+#if defined (_UNORDERED_MAP_)  || (defined (_LIST_)) || (defined (_MAP_)) || (defined (_SET_)) || (defined (_UNORDERED_SET_))||(defined (_GLIBCXX_MAP)) || (defined (_GLIBCXX_UNORDERED_MAP))
+BOOM :)
+#endif
+#include <iostream>
+#include <string>
+
+// values must be built in place once and never copied on the way in
+#define _OUTPUT_
+
+std::string c[]={
+    "   pass!",
+    "   error.",
+    "test: hashmap emplace",
+    "test: linked_hashmap emplace",
+    "test: flat_hashmap emplace",
+    "Congratulations. Your submission has passed all correctness tests. Good job! :)",
+    "test: lru save by move",
+    "test: memcheck",
+};
+
+int built = 0, copied = 0, moved = 0, alive = 0;
+struct Value {
+    int v;
+    Value(int x, int y): v(x + y) {built++; alive++;}
+    Value(const Value &o): v(o.v) {copied++; alive++;}
+    Value(Value &&o) noexcept: v(o.v) {moved++; alive++;}
+    Value & operator=(const Value &o) {v = o.v; copied++; return *this;}
+    Value & operator=(Value &&o) noexcept {v = o.v; moved++; return *this;}
+    ~Value() {alive--;}
+};
+std::ostream & operator<<(std::ostream &os, const Value &x) {
+    return os << x.v;
+}
+
+void reset(){
+    built = copied = moved = 0;
+}
+void check(bool ok){
+    if(!ok){
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+}
+
+template<class Map>
+void tester(int title, bool nodes){
+    using value_type = typename Map::value_type;
+    // flat_hashmap moves elements around while placing them
+    std::cout<<c[title];
+    {
+        Map map;
+        reset();
+        for(int i=0;i<1000;i++){
+            check(map.try_emplace(i, i, 1).second);
+        }
+        check(built == 1000 && copied == 0);
+        check(!map.try_emplace(5, 0, 0).second && map.find(5)->second.v == 6);
+        check(built == 1000);
+        reset();
+        check(!map.insert_or_assign(5, Value(1, 1)).second && map.find(5)->second.v == 2);
+        check(built == 1 && copied == 0 && (!nodes || moved == 1));
+        reset();
+        check(map.insert(value_type(2000, Value(2, 2))).second);
+        check(built == 1 && copied == 0 && (!nodes || moved == 2));
+        check(map.find(2000)->second.v == 4);
+        reset();
+        Map map2(map);
+        check(copied == 1001 && map2.find(999)->second.v == 1000);
+    }
+    check(alive == 0);
+    std::cout<<c[0]<<std::endl;
+}
+
+void lru_tester(){
+    using lru = sjtu::basic_lru<int, Value, std::hash<int>, std::equal_to<int> >;
+    using value_type = sjtu::pair<const int, Value>;
+    std::cout<<c[6];
+    {
+        lru cache(100);
+        reset();
+        for(int i=0;i<300;i++){
+            cache.emplace(i, i, 0);
+            cache.save(value_type(i + 1000, Value(i, 1)));
+            cache.get(i);
+        }
+        // emplace builds the value, then moves it in once there is room;
+        // save moves into the pair, then into the node
+        check(built == 600 && copied == 0 && moved == 900);
+        reset();
+        cache.emplace(299, 7, 7);
+        check(built == 1 && copied == 0 && moved == 1 && cache.get(299)->v == 14);
+        check(cache.get(1299) != nullptr && cache.get(1299)->v == 300);
+        check(cache.get(0) == nullptr);
+    }
+    check(alive == 0);
+    // a moved Matrix hands over its rows instead of copying them
+    Matrix<int> a(2, 3, 7);
+    Matrix<int> b(std::move(a));
+    check(a.RowSize() == 0 && b.RowSize() == 2 && b[1][2] == 7);
+    a = std::move(b);
+    check(b.RowSize() == 0 && a.ColSize() == 3 && a[0][0] == 7);
+    std::cout<<c[0]<<std::endl;
+}
+
+int main(){
+#ifdef _OUTPUT_
+    freopen("13.out","w",stdout);
+#endif
+    tester<sjtu::hashmap<int,Value> >(2, true);
+    tester<sjtu::linked_hashmap<int,Value> >(3, true);
+    tester<sjtu::flat_hashmap<int,Value> >(4, false);
+    lru_tester();
+    std::cout<<c[7];
+    if(Integer::counter == 0){
+        std::cout<<c[0]<<std::endl;
+    }
+    else{
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+    std::cout << c[5] << std::endl;
+}
@@ -0,0 +1,142 @@
+#include "concurrent-lru.hpp"
+#if defined (_UNORDERED_MAP_)  || (defined (_LIST_)) || (defined (_MAP_)) || (defined (_SET_)) || (defined (_UNORDERED_SET_))||(defined (_GLIBCXX_MAP)) || (defined (_GLIBCXX_UNORDERED_MAP))
+BOOM :)
+#endif
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// sharded lru under several threads
+#define _OUTPUT_
+
+std::string c[]={
+    "   pass!",
+    "   error.",
+    "test: concurrent save/get",
+    "test: shard capacity",
+    "test: concurrent lru order",
+    "Congratulations. Your submission has passed all correctness tests. Good job! :)",
+    "test: memcheck",
+    "test: pooled shards",
+};
+
+using value_type = sjtu::pair<Integer,Matrix<int> >;
+// Integer counts its instances without atomics, so the threads use plain keys
+using shared_lru = sjtu::concurrent_lru<long long,Matrix<int>,std::hash<long long>,std::equal_to<long long> >;
+using shared_value = sjtu::pair<const long long,Matrix<int> >;
+
+void check(bool ok){
+    if(!ok){
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+}
+
+// every thread owns the keys i with i % threads == t
+void concurrent_tester(){
+    const int threads = 8, n = 20000;
+    std::cout<<c[2];
+    shared_lru cache(n, 16);
+    std::vector<int> bad(threads, 0);
+    std::vector<std::thread> workers;
+    for(int t=0;t<threads;t++){
+        workers.emplace_back([&, t](){
+            for(int i=t;i<n;i+=threads){
+                cache.save(shared_value(i,Matrix<int>(1,1,i)));
+                Matrix<int> m;
+                if(cache.get(i, m) && m[0][0] != i) bad[t]++;
+                if(i >= threads && cache.visit(i-threads, [&](Matrix<int> &v){ if(v[0][0] != i-threads) bad[t]++; }) == false){
+                    // may only be gone if its shard was full
+                    if(cache.size() < (size_t)n / 2) bad[t]++;
+                }
+            }
+        });
+    }
+    for(auto &w: workers) w.join();
+    int total = 0;
+    for(int t=0;t<threads;t++) total += bad[t];
+    check(total == 0 && cache.size() <= cache.shard_count() * cache.shard_capacity());
+    std::cout<<c[0]<<std::endl;
+
+    std::cout<<c[3];
+    sjtu::concurrent_lru<> small(100, 4);
+    check(small.shard_count() == 4 && small.shard_capacity() == 25);
+    for(int i=0;i<1000;i++){
+        small.emplace(Integer(i), 1, 1, i);
+    }
+    check(small.size() <= 100 && small.size() > 4 * 20);
+    int found = 0;
+    for(int i=900;i<1000;i++){
+        Matrix<int> m;
+        if(small.get(Integer(i), m)) found++;
+    }
+    check(found > 50);
+    std::cout<<c[0]<<std::endl;
+}
+
+// with a single shard it is a plain lru
+void order_tester(){
+    std::cout<<c[4]<<std::endl;
+    sjtu::concurrent_lru<> cache(5, 1);
+    for(int i=0;i<10;i++){
+        cache.save(value_type(Integer(i),Matrix<int>(1,1,i)));
+        Matrix<int> m;
+        cache.get(Integer(i-(i%3)), m);
+    }
+    cache.print();
+}
+
+// node_pool is not thread safe: every shard must get one of its own,
+// never the shared default pool
+void pool_tester(){
+    const int threads = 8, n = 20000;
+    std::cout<<c[7];
+    using pooled_lru = sjtu::concurrent_lru<long long,Matrix<int>,std::hash<long long>,std::equal_to<long long>,
+        sjtu::pool_allocator<shared_value> >;
+    size_t before = sjtu::default_node_pool().slabs_in_use();
+    {
+        pooled_lru cache(n / 2, 16);
+        std::vector<std::thread> workers;
+        for(int t=0;t<threads;t++){
+            workers.emplace_back([&, t](){
+                for(int i=t;i<n;i+=threads){
+                    cache.save(shared_value(i,Matrix<int>(1,1,i)));
+                    Matrix<int> m;
+                    cache.get(i - i % 7, m);
+                }
+            });
+        }
+        for(auto &w: workers) w.join();
+        check(cache.size() <= cache.shard_count() * cache.shard_capacity());
+        size_t found = 0;
+        for(int i=0;i<n;i++){
+            Matrix<int> m;
+            if(cache.get(i, m)){
+                check(m[0][0] == i);
+                found++;
+            }
+        }
+        check(found == cache.size() && found > 0);
+    }
+    check(sjtu::default_node_pool().slabs_in_use() == before);
+    std::cout<<c[0]<<std::endl;
+}
+
+int main(){
+#ifdef _OUTPUT_
+    freopen("14.out","w",stdout);
+#endif
+    concurrent_tester();
+    order_tester();
+    pool_tester();
+    std::cout<<c[6];
+    if(Integer::counter == 0){
+        std::cout<<c[0]<<std::endl;
+    }
+    else{
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+    std::cout << c[5] << std::endl;
+}
@@ -0,0 +1,86 @@
+#include "src.hpp"
+#if defined (_UNORDERED_MAP_)  || (defined (_LIST_)) || (defined (_MAP_)) || (defined (_SET_)) || (defined (_UNORDERED_SET_))||(defined (_GLIBCXX_MAP)) || (defined (_GLIBCXX_UNORDERED_MAP))
+BOOM :)
+#endif
+#include <iostream>
+#include <string>
+
+// CLOCK eviction mode: hits only mark, eviction gives a second chance
+#define _OUTPUT_
+
+std::string c[]={
+    "   pass!",
+    "   error.",
+    "test: second chance",
+    "test: get keeps the order",
+    "test: clock lru",
+    "Congratulations. Your submission has passed all correctness tests. Good job! :)",
+    "test: memcheck",
+};
+
+using value_type = sjtu::pair<Integer,Matrix<int> >;
+
+void check(bool ok){
+    if(!ok){
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+}
+
+void second_chance_tester(){
+    std::cout<<c[2];
+    sjtu::clock_lru cache(3);
+    for(int i=1;i<=3;i++){
+        cache.save(value_type(Integer(i),Matrix<int>(1,1,i)));
+    }
+    check(cache.get(Integer(1)) != nullptr);
+    // 1 is marked, so 2 goes
+    cache.save(value_type(Integer(4),Matrix<int>(1,1,4)));
+    check(cache.get(Integer(2)) == nullptr && cache.get(Integer(1)) != nullptr);
+    check(cache.get(Integer(3)) != nullptr && cache.get(Integer(4)) != nullptr);
+    // everyone marked: one full lap, then the head (3) goes
+    cache.save(value_type(Integer(5),Matrix<int>(1,1,5)));
+    check(cache.get(Integer(3)) == nullptr && cache.get(Integer(5)) != nullptr);
+    std::cout<<c[0]<<std::endl;
+}
+
+void order_tester(){
+    std::cout<<c[3]<<std::endl;
+    sjtu::clock_lru cache(4);
+    for(int i=0;i<4;i++){
+        cache.save(value_type(Integer(i),Matrix<int>(1,1,i)));
+    }
+    cache.get(Integer(0));
+    cache.get(Integer(2));
+    cache.print();
+}
+
+void lru_tester(){
+    std::cout<<c[4]<<std::endl;
+    sjtu::clock_lru tester(30);
+    const int n=1000;
+    for(int i=0;i<n;i++){
+        tester.save(value_type( Integer(i),Matrix<int>(1,1,i)));
+        tester.get(Integer(i-(i%99)));
+        tester.get(Integer(i-(i%7)));
+    }
+    tester.print();
+}
+
+int main(){
+#ifdef _OUTPUT_
+    freopen("15.out","w",stdout);
+#endif
+    second_chance_tester();
+    order_tester();
+    lru_tester();
+    std::cout<<c[6];
+    if(Integer::counter == 0){
+        std::cout<<c[0]<<std::endl;
+    }
+    else{
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+    std::cout << c[5] << std::endl;
+}
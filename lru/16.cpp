@@ -0,0 +1,100 @@
+#include "concurrent-lru.hpp"
+#if defined (_UNORDERED_MAP_)  || (defined (_LIST_)) || (defined (_MAP_)) || (defined (_SET_)) || (defined (_UNORDERED_SET_))||(defined (_GLIBCXX_MAP)) || (defined (_GLIBCXX_UNORDERED_MAP))
+BOOM :)
+#endif
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// read buffer of concurrent_lru: batched promotions
+#define _OUTPUT_
+
+std::string c[]={
+    "   pass!",
+    "   error.",
+    "test: every hit is applied or dropped",
+    "test: drain threshold",
+    "test: same evictions as lru",
+    "Congratulations. Your submission has passed all correctness tests. Good job! :)",
+    "test: memcheck",
+};
+
+using shared_lru = sjtu::concurrent_lru<long long,long long,std::hash<long long>,std::equal_to<long long> >;
+using shared_value = sjtu::pair<const long long,long long>;
+using value_type = sjtu::pair<Integer,Matrix<int> >;
+
+void check(bool ok){
+    if(!ok){
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+}
+
+void buffer_tester(){
+    const int threads = 8, n = 2000, rounds = 50;
+    std::cout<<c[2];
+    shared_lru cache(2 * n, 4);
+    for(int i=0;i<n;i++) cache.save(shared_value(i,i));
+    std::vector<long long> hits(threads, 0);
+    std::vector<std::thread> readers;
+    for(int t=0;t<threads;t++){
+        readers.emplace_back([&, t](){
+            long long v;
+            for(int r=0;r<rounds;r++){
+                for(int i=t;i<n;i+=threads){
+                    if(cache.get(i, v) && v == i) hits[t]++;
+                }
+            }
+        });
+    }
+    for(auto &r: readers) r.join();
+    cache.flush();
+    long long total = 0;
+    for(auto h: hits) total += h;
+    sjtu::read_buffer_stats stats = cache.read_stats();
+    check(total == (long long)n * rounds && (long long)(stats.applied + stats.dropped) == total);
+    check(stats.drains > 0);
+    std::cout<<c[0]<<std::endl;
+
+    std::cout<<c[3];
+    check(cache.drain_threshold() == 16);
+    cache.drain_threshold(0);
+    check(cache.drain_threshold() == 1);
+    cache.drain_threshold(1000);
+    check(cache.drain_threshold() == 16);
+    std::cout<<c[0]<<std::endl;
+}
+
+// one shard, draining on every hit: exactly the plain lru
+void order_tester(){
+    std::cout<<c[4];
+    sjtu::concurrent_lru<> cache(50, 1);
+    cache.drain_threshold(1);
+    sjtu::lru plain(50);
+    for(int i=0;i<1000;i++){
+        cache.save(value_type(Integer(i),Matrix<int>(1,1,i)));
+        plain.save(value_type(Integer(i),Matrix<int>(1,1,i)));
+        Matrix<int> m;
+        check(cache.get(Integer(i-(i%7)), m) == (plain.get(Integer(i-(i%7))) != nullptr));
+        check(cache.get(Integer(i/3), m) == (plain.get(Integer(i/3)) != nullptr));
+    }
+    std::cout<<c[0]<<std::endl;
+}
+
+int main(){
+#ifdef _OUTPUT_
+    freopen("16.out","w",stdout);
+#endif
+    buffer_tester();
+    order_tester();
+    std::cout<<c[6];
+    if(Integer::counter == 0){
+        std::cout<<c[0]<<std::endl;
+    }
+    else{
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+    std::cout << c[5] << std::endl;
+}
@@ -0,0 +1,129 @@
+#include "src.hpp"
+#if defined (_UNORDERED_MAP_)  || (defined (_LIST_)) || (defined (_MAP_)) || (defined (_SET_)) || (defined (_UNORDERED_SET_))||(defined (_GLIBCXX_MAP)) || (defined (_GLIBCXX_UNORDERED_MAP))
+BOOM :)
+#endif
+#include <iostream>
+#include <string>
+
+// byte-bounded lru: entries weigh their node plus their matrix
+#define _OUTPUT_
+
+std::string c[]={
+    "   pass!",
+    "   error.",
+    "test: byte budget",
+    "test: oversized entries",
+    "test: weighted lru order",
+    "test: emplace evicts like save",
+    "Congratulations. Your submission has passed all correctness tests. Good job! :)",
+    "test: memcheck",
+};
+
+using value_type = sjtu::pair<Integer,Matrix<int> >;
+using byte_lru = sjtu::basic_lru<Integer, Matrix<int>, Hash, Equal, std::allocator<sjtu::pair<const Integer, Matrix<int> > >,
+    sjtu::pow2_hash_policy, sjtu::lru_eviction, sjtu::byte_weigher>;
+using byte_clock_lru = sjtu::basic_lru<Integer, Matrix<int>, Hash, Equal, std::allocator<sjtu::pair<const Integer, Matrix<int> > >,
+    sjtu::pow2_hash_policy, sjtu::clock_eviction, sjtu::byte_weigher>;
+const size_t node = sizeof(byte_lru::node_type);
+
+void check(bool ok){
+    if(!ok){
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+}
+
+size_t weight_of(int rows){
+    return node + rows * rows * sizeof(int);
+}
+
+void budget_tester(){
+    std::cout<<c[2];
+    const size_t budget = 64 * 1024;
+    byte_lru cache(budget);
+    size_t live = 0;
+    for(int i=0;i<2000;i++){
+        int rows = 1 + (i * 7) % 40;
+        check(cache.save(value_type(Integer(i),Matrix<int>(rows,rows,i))));
+        check(cache.weight() <= budget);
+        if(i % 3 == 0) cache.get(Integer(i / 2));
+    }
+    // the weight must be the sum over what is left
+    for(int i=0;i<2000;i++){
+        if(cache.get(Integer(i)) != nullptr){
+            live += weight_of(1 + (i * 7) % 40);
+        }
+    }
+    check(live == cache.weight() && cache.max_weight() == budget);
+    // replacing a value re-weighs it
+    size_t before = cache.weight();
+    Matrix<int> *m = cache.get(Integer(1999));
+    size_t rows = m->RowSize();
+    check(cache.save(value_type(Integer(1999),Matrix<int>(1,1,0))));
+    check(cache.weight() == before - weight_of(rows) + weight_of(1));
+    std::cout<<c[0]<<std::endl;
+
+    std::cout<<c[3];
+    size_t count = cache.size();
+    check(!cache.save(value_type(Integer(-1),Matrix<int>(200,200,0))));
+    check(!cache.emplace(Integer(-2),200,200,0));
+    check(cache.get(Integer(-1)) == nullptr && cache.get(Integer(-2)) == nullptr);
+    check(cache.size() == count && cache.weight() == before - weight_of(rows) + weight_of(1));
+    std::cout<<c[0]<<std::endl;
+}
+
+// room for three 2x2 matrices: a 3x3 one pushes out two of them
+void order_tester(){
+    std::cout<<c[4]<<std::endl;
+    byte_lru cache(3 * weight_of(2));
+    for(int i=0;i<3;i++){
+        cache.save(value_type(Integer(i),Matrix<int>(2,2,i)));
+    }
+    cache.get(Integer(0));
+    cache.emplace(Integer(3),3,3,3);
+    cache.print();
+    std::cout<<(cache.size() == 2 ? c[0] : c[1])<<std::endl;
+}
+
+// the same keys saved into one cache and emplaced into the other:
+// eviction must pick the same entries, never the one being added
+template<class Cache>
+void emplace_tester(){
+    Cache saved(40 * weight_of(2)), emplaced(40 * weight_of(2));
+    unsigned seed = 1;
+    for(int i=0;i<3000;i++){
+        seed = seed * 1103515245u + 12345u;
+        int key = int((seed >> 16) % (i % 5 == 0 ? 20 : 80)), rows = 1 + key % 3;
+        if(i % 3 == 0){
+            check((saved.get(Integer(key)) == nullptr) == (emplaced.get(Integer(key)) == nullptr));
+            continue;
+        }
+        check(saved.save(value_type(Integer(key),Matrix<int>(rows,rows,key))));
+        check(emplaced.emplace(Integer(key),rows,rows,key));
+        check(emplaced.lookup(Integer(key)) != nullptr && saved.weight() == emplaced.weight());
+        for(int k=0;k<80;k++){
+            check((saved.lookup(Integer(k)) == nullptr) == (emplaced.lookup(Integer(k)) == nullptr));
+        }
+    }
+}
+
+int main(){
+#ifdef _OUTPUT_
+    freopen("17.out","w",stdout);
+#endif
+    budget_tester();
+    order_tester();
+    std::cout<<c[5];
+    emplace_tester<byte_lru>();
+    emplace_tester<byte_clock_lru>();
+    std::cout<<c[0]<<std::endl;
+    std::cout<<c[7];
+    if(Integer::counter == 0){
+        std::cout<<c[0]<<std::endl;
+    }
+    else{
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+    std::cout << c[6] << std::endl;
+}
@@ -0,0 +1,170 @@
+#include "eviction.hpp"
+#if defined (_UNORDERED_MAP_)  || (defined (_LIST_)) || (defined (_MAP_)) || (defined (_SET_)) || (defined (_UNORDERED_SET_))||(defined (_GLIBCXX_MAP)) || (defined (_GLIBCXX_UNORDERED_MAP))
+BOOM :)
+#endif
+#include <iostream>
+#include <string>
+
+// fifo, slru and 2q eviction modes, and the ghost list behind 2q
+#define _OUTPUT_
+
+std::string c[]={
+    "   pass!",
+    "   error.",
+    "test: fifo",
+    "test: slru",
+    "test: 2q",
+    "Congratulations. Your submission has passed all correctness tests. Good job! :)",
+    "test: memcheck",
+    "test: ghost list",
+    "test: emplace evicts like save",
+};
+
+using value_type = sjtu::pair<Integer,Matrix<int> >;
+template<template<class> class Eviction>
+using cache_type = sjtu::basic_lru<Integer, Matrix<int>, Hash, Equal, std::allocator<sjtu::pair<const Integer, Matrix<int> > >,
+    sjtu::pow2_hash_policy, Eviction>;
+
+void check(bool ok){
+    if(!ok){
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+}
+
+template<class Cache>
+void fill(Cache &cache, int from, int to){
+    for(int i=from;i<to;i++){
+        check(cache.save(value_type(Integer(i),Matrix<int>(1,1,i))));
+    }
+}
+
+template<class Cache>
+bool has(const Cache &cache, int key){
+    return cache.lookup(Integer(key)) != nullptr;
+}
+
+// a hit does not save the oldest entry
+void fifo_tester(){
+    std::cout<<c[2]<<std::endl;
+    cache_type<sjtu::fifo_eviction> cache(3);
+    fill(cache, 0, 3);
+    check(cache.get(Integer(0)) != nullptr);
+    fill(cache, 3, 4);
+    check(!has(cache, 0) && has(cache, 1) && has(cache, 3));
+    cache.print();
+    std::cout<<c[0]<<std::endl;
+}
+
+void slru_tester(){
+    std::cout<<c[3]<<std::endl;
+    // entries hit once survive a scan
+    cache_type<sjtu::slru_eviction> cache(5);
+    fill(cache, 0, 5);
+    cache.get(Integer(0));
+    cache.get(Integer(1));
+    fill(cache, 100, 104);
+    check(has(cache, 0) && has(cache, 1) && !has(cache, 100) && has(cache, 103));
+    cache.print();
+    // protected holds at most 80%: its lru entry goes back to probation
+    cache_type<sjtu::slru_eviction> full(5);
+    fill(full, 0, 5);
+    for(int i=0;i<5;i++) full.get(Integer(i));
+    fill(full, 5, 6);
+    check(!has(full, 0) && has(full, 1) && has(full, 5));
+    std::cout<<c[0]<<std::endl;
+}
+
+void two_queue_tester(){
+    std::cout<<c[4]<<std::endl;
+    cache_type<sjtu::two_queue_eviction> cache(8);
+    fill(cache, 0, 8);
+    check(cache.get(Integer(0)) != nullptr);
+    fill(cache, 8, 9);
+    check(!has(cache, 0));
+    // 0 comes back from the ghost list into Am and outlives a scan
+    fill(cache, 0, 1);
+    fill(cache, 100, 120);
+    check(has(cache, 0) && has(cache, 119) && !has(cache, 100) && cache.size() == 8);
+    cache.print();
+    std::cout<<c[0]<<std::endl;
+}
+
+void ghost_tester(){
+    std::cout<<c[7];
+    sjtu::ghost_list<Integer, Hash, Equal> ghosts;
+    for(int i=0;i<10;i++) ghosts.push(Integer(i));
+    ghosts.trim(4);
+    check(ghosts.size() == 4 && !ghosts.contains(Integer(5)) && ghosts.contains(Integer(6)));
+    check(ghosts.erase(Integer(7)) && !ghosts.erase(Integer(7)) && ghosts.size() == 3);
+    ghosts.pop();
+    check(!ghosts.contains(Integer(6)) && ghosts.contains(Integer(9)) && ghosts.bytes() > 0);
+    std::cout<<c[0]<<std::endl;
+}
+
+/**
+ * random saves into one cache and the same emplaces into the other:
+ * the same entries must go, and ghost(cache, key) must agree
+*/
+template<template<class> class Eviction, class Ghost>
+void lockstep(size_t capacity, Ghost ghost){
+    cache_type<Eviction> saved(capacity), emplaced(capacity);
+    unsigned seed = unsigned(capacity);
+    for(int i=0;i<2000;i++){
+        seed = seed * 1103515245u + 12345u;
+        int key = int((seed >> 16) % (capacity * 3));
+        if(i % 3 == 0){
+            check((saved.get(Integer(key)) == nullptr) == (emplaced.get(Integer(key)) == nullptr));
+            continue;
+        }
+        check(saved.save(value_type(Integer(key),Matrix<int>(1,1,key))));
+        check(emplaced.emplace(Integer(key),1,1,key));
+        // the entry just added is live, so it cannot be a ghost
+        check(has(emplaced, key) && !ghost(emplaced, key));
+        for(int k=0;k<int(capacity * 3);k++){
+            check(has(saved, k) == has(emplaced, k) && ghost(saved, k) == ghost(emplaced, k));
+        }
+    }
+}
+
+void emplace_tester(){
+    std::cout<<c[8];
+    auto none = [](const cache_type<sjtu::fifo_eviction> &, int){return false; };
+    auto none_slru = [](const cache_type<sjtu::slru_eviction> &, int){return false; };
+    auto out = [](const cache_type<sjtu::two_queue_eviction> &cache, int key){
+        return cache.eviction().out.contains(Integer(key));
+    };
+    for(size_t capacity: {2, 3, 8, 30}){
+        lockstep<sjtu::fifo_eviction>(capacity, none);
+        lockstep<sjtu::slru_eviction>(capacity, none_slru);
+        lockstep<sjtu::two_queue_eviction>(capacity, out);
+    }
+    // ends with 0 coming back while A1in is empty: it must not be
+    // chosen as the A1in victim, and so not be remembered in A1out
+    cache_type<sjtu::two_queue_eviction> cache(2);
+    for(int key: {0, 2, 1, 1, 0, 0, 4, 1, 4, 0}){
+        check(cache.emplace(Integer(key),1,1,key));
+        check(has(cache, key) && !cache.eviction().out.contains(Integer(key)));
+    }
+    std::cout<<c[0]<<std::endl;
+}
+
+int main(){
+#ifdef _OUTPUT_
+    freopen("18.out","w",stdout);
+#endif
+    fifo_tester();
+    slru_tester();
+    two_queue_tester();
+    ghost_tester();
+    emplace_tester();
+    std::cout<<c[6];
+    if(Integer::counter == 0){
+        std::cout<<c[0]<<std::endl;
+    }
+    else{
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+    std::cout << c[5] << std::endl;
+}
@@ -0,0 +1,136 @@
+#include "eviction.hpp"
+#if defined (_UNORDERED_MAP_)  || (defined (_LIST_)) || (defined (_MAP_)) || (defined (_SET_)) || (defined (_UNORDERED_SET_))||(defined (_GLIBCXX_MAP)) || (defined (_GLIBCXX_UNORDERED_MAP))
+BOOM :)
+#endif
+#include <iostream>
+#include <string>
+
+// w-tinylfu: frequency sketch and admission of window entries
+#define _OUTPUT_
+
+std::string c[]={
+    "   pass!",
+    "   error.",
+    "test: frequency sketch",
+    "test: one-hit wonders",
+    "test: window",
+    "Congratulations. Your submission has passed all correctness tests. Good job! :)",
+    "test: memcheck",
+    "test: emplace of cold keys",
+};
+
+using value_type = sjtu::pair<Integer,Matrix<int> >;
+using tinylfu = sjtu::basic_lru<Integer, Matrix<int>, Hash, Equal, std::allocator<sjtu::pair<const Integer, Matrix<int> > >,
+    sjtu::pow2_hash_policy, sjtu::tinylfu_eviction>;
+
+void check(bool ok){
+    if(!ok){
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+}
+
+void sketch_tester(){
+    std::cout<<c[2];
+    sjtu::frequency_sketch sketch(64);
+    check(sketch.bytes() == 8 * 64 && sketch.estimate(1) == 0);
+    for(int i=0;i<5;i++) sketch.increment(1);
+    for(int i=0;i<40;i++) sketch.increment(2);
+    check(sketch.estimate(1) >= 5 && sketch.estimate(2) == 15);
+    sketch.age();
+    check(sketch.estimate(2) == 7 && sketch.estimate(1) >= 2);
+    // 10 increments per key fill a sample and age it by themselves
+    sjtu::frequency_sketch small(8);
+    for(int i=0;i<79;i++) small.increment(i % 8 + 100);
+    check(small.estimate(107) >= 9);
+    small.increment(107);
+    check(small.estimate(107) <= 5);
+    std::cout<<c[0]<<std::endl;
+}
+
+// the hot keys stay while a stream of fresh keys passes by
+void wonder_tester(){
+    std::cout<<c[3];
+    tinylfu cache(10);
+    for(int r=0;r<4;r++){
+        for(int i=0;i<10;i++){
+            if(cache.get(Integer(i)) == nullptr) cache.save(value_type(Integer(i),Matrix<int>(1,1,i)));
+        }
+    }
+    for(int i=100;i<300;i++){
+        cache.save(value_type(Integer(i),Matrix<int>(1,1,i)));
+    }
+    int hot = 0;
+    for(int i=0;i<10;i++){
+        if(cache.lookup(Integer(i)) != nullptr) hot++;
+    }
+    check(hot == 9 && cache.size() == 10 && cache.lookup(Integer(299)) != nullptr);
+    check(cache.eviction().bytes() == 8 * 16);
+    std::cout<<c[0]<<std::endl;
+}
+
+// a fresh key is only admitted once it is used more than main's victim
+void window_tester(){
+    std::cout<<c[4]<<std::endl;
+    tinylfu cache(4);
+    cache.eviction().window_percent(0);
+    for(int i=0;i<4;i++) cache.save(value_type(Integer(i),Matrix<int>(1,1,i)));
+    cache.get(Integer(0));
+    cache.get(Integer(1));
+    cache.save(value_type(Integer(4),Matrix<int>(1,1,4)));
+    check(cache.lookup(Integer(3)) == nullptr);
+    cache.save(value_type(Integer(5),Matrix<int>(1,1,5)));
+    check(cache.lookup(Integer(4)) == nullptr);
+    cache.get(Integer(5));
+    cache.get(Integer(5));
+    cache.save(value_type(Integer(6),Matrix<int>(1,1,6)));
+    check(cache.lookup(Integer(5)) != nullptr && cache.lookup(Integer(6)) != nullptr);
+    cache.print();
+    std::cout<<c[0]<<std::endl;
+}
+
+// the same through emplace: a cold newcomer loses admission and goes,
+// the hot entries stay, exactly as with save
+void emplace_tester(){
+    std::cout<<c[7];
+    tinylfu saved(10), emplaced(10);
+    for(int r=0;r<4;r++){
+        for(int i=0;i<10;i++){
+            if(saved.get(Integer(i)) == nullptr) saved.save(value_type(Integer(i),Matrix<int>(1,1,i)));
+            if(emplaced.get(Integer(i)) == nullptr) check(emplaced.emplace(Integer(i),1,1,i));
+        }
+    }
+    for(int i=100;i<300;i++){
+        saved.save(value_type(Integer(i),Matrix<int>(1,1,i)));
+        check(emplaced.emplace(Integer(i),1,1,i));
+        for(int k=0;k<10;k++){
+            check((saved.lookup(Integer(k)) == nullptr) == (emplaced.lookup(Integer(k)) == nullptr));
+        }
+        check((saved.lookup(Integer(i - 1)) == nullptr) == (emplaced.lookup(Integer(i - 1)) == nullptr));
+    }
+    int hot = 0;
+    for(int i=0;i<10;i++){
+        if(emplaced.lookup(Integer(i)) != nullptr) hot++;
+    }
+    check(hot == 9 && emplaced.size() == 10 && emplaced.lookup(Integer(2)) != nullptr);
+    std::cout<<c[0]<<std::endl;
+}
+
+int main(){
+#ifdef _OUTPUT_
+    freopen("19.out","w",stdout);
+#endif
+    sketch_tester();
+    wonder_tester();
+    window_tester();
+    emplace_tester();
+    std::cout<<c[6];
+    if(Integer::counter == 0){
+        std::cout<<c[0]<<std::endl;
+    }
+    else{
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+    std::cout << c[5] << std::endl;
+}
@@ -0,0 +1,125 @@
+#include "eviction.hpp"
+#if defined (_UNORDERED_MAP_)  || (defined (_LIST_)) || (defined (_MAP_)) || (defined (_SET_)) || (defined (_UNORDERED_SET_))||(defined (_GLIBCXX_MAP)) || (defined (_GLIBCXX_UNORDERED_MAP))
+BOOM :)
+#endif
+#include <iostream>
+#include <string>
+
+// arc: t1/t2 split adapting to ghost hits
+#define _OUTPUT_
+
+std::string c[]={
+    "   pass!",
+    "   error.",
+    "test: ghost hit in b1",
+    "test: ghost hit in b2",
+    "test: bounded ghosts",
+    "Congratulations. Your submission has passed all correctness tests. Good job! :)",
+    "test: memcheck",
+    "test: emplace evicts like save",
+};
+
+using value_type = sjtu::pair<Integer,Matrix<int> >;
+
+void check(bool ok){
+    if(!ok){
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+}
+
+void save(sjtu::arc_lru &cache, int key){
+    check(cache.save(value_type(Integer(key),Matrix<int>(1,1,key))));
+}
+
+bool has(const sjtu::arc_lru &cache, int key){
+    return cache.lookup(Integer(key)) != nullptr;
+}
+
+void adapt_tester(){
+    sjtu::arc_lru cache(4);
+    for(int i=0;i<4;i++) save(cache, i);
+    cache.get(Integer(0));
+    cache.get(Integer(1));
+    std::cout<<c[2]<<std::endl;
+    save(cache, 4);
+    check(!has(cache, 2) && cache.eviction().b1.contains(Integer(2)));
+    // 2 was evicted too early: t1 should have been bigger
+    save(cache, 2);
+    check(has(cache, 2) && !has(cache, 3) && cache.eviction().target() == 1);
+    cache.print();
+    std::cout<<c[0]<<std::endl;
+
+    std::cout<<c[3]<<std::endl;
+    save(cache, 5);
+    check(!has(cache, 0) && cache.eviction().b2.contains(Integer(0)));
+    // 0 was evicted too early: t2 should have been bigger
+    save(cache, 0);
+    check(has(cache, 0) && !has(cache, 4) && cache.eviction().target() == 0);
+    cache.print();
+    std::cout<<c[0]<<std::endl;
+}
+
+void bound_tester(){
+    std::cout<<c[4];
+    sjtu::arc_lru cache(50);
+    for(int r=0;r<20;r++){
+        for(int i=0;i<200;i++){
+            int key = (i * 7 + r * 13) % (i % 3 == 0 ? 40 : 400);
+            if(cache.get(Integer(key)) == nullptr) save(cache, key);
+            auto &arc = cache.eviction();
+            check(cache.size() <= 50 && arc.target() <= 50);
+            check(arc.recentCount + arc.b1.size() <= 50 && cache.size() + arc.b1.size() + arc.b2.size() <= 100);
+        }
+    }
+    check(cache.eviction().bytes() > 0);
+    std::cout<<c[0]<<std::endl;
+}
+
+void emplace_tester(){
+    std::cout<<c[7];
+    // all of t2: the newcomer lands in t1, the lru of t2 goes to b2
+    sjtu::arc_lru cache(4);
+    for(int i=0;i<4;i++) save(cache, i);
+    for(int i=0;i<4;i++) cache.get(Integer(i));
+    check(cache.emplace(Integer(100),1,1,100));
+    auto &arc = cache.eviction();
+    check(has(cache, 100) && !arc.b1.contains(Integer(100)) && !has(cache, 0) && arc.b2.contains(Integer(0)));
+    // and in lockstep with save
+    for(size_t capacity: {2, 3, 8, 30}){
+        sjtu::arc_lru saved(capacity), emplaced(capacity);
+        unsigned seed = unsigned(capacity);
+        for(int op=0;op<2000;op++){
+            seed = seed * 1103515245u + 12345u;
+            int key = int((seed >> 16) % 80);
+            if(saved.get(Integer(key)) == nullptr) save(saved, key);
+            if(emplaced.get(Integer(key)) == nullptr) check(emplaced.emplace(Integer(key),1,1,key));
+            auto &s = saved.eviction(), &e = emplaced.eviction();
+            check(s.target() == e.target() && s.b1.size() == e.b1.size() && s.b2.size() == e.b2.size());
+            for(int k=0;k<80;k++){
+                check(has(saved, k) == has(emplaced, k));
+                check(s.b1.contains(Integer(k)) == e.b1.contains(Integer(k)));
+                check(s.b2.contains(Integer(k)) == e.b2.contains(Integer(k)));
+            }
+        }
+    }
+    std::cout<<c[0]<<std::endl;
+}
+
+int main(){
+#ifdef _OUTPUT_
+    freopen("20.out","w",stdout);
+#endif
+    adapt_tester();
+    bound_tester();
+    emplace_tester();
+    std::cout<<c[6];
+    if(Integer::counter == 0){
+        std::cout<<c[0]<<std::endl;
+    }
+    else{
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+    std::cout << c[5] << std::endl;
+}
@@ -0,0 +1,134 @@
+#include "expiry.hpp"
+#if defined (_UNORDERED_MAP_)  || (defined (_LIST_)) || (defined (_MAP_)) || (defined (_SET_)) || (defined (_UNORDERED_SET_))||(defined (_GLIBCXX_MAP)) || (defined (_GLIBCXX_UNORDERED_MAP))
+BOOM :)
+#endif
+#include <iostream>
+#include <string>
+
+// time to live on a timer wheel, driven by a manual clock
+#define _OUTPUT_
+
+std::string c[]={
+    "   pass!",
+    "   error.",
+    "test: expire after write",
+    "test: expire after access",
+    "test: per-entry ttl",
+    "Congratulations. Your submission has passed all correctness tests. Good job! :)",
+    "test: memcheck",
+    "test: far deadlines",
+};
+
+using value_type = sjtu::pair<Integer,Matrix<int> >;
+using ttl_lru = sjtu::basic_lru<Integer, Matrix<int>, Hash, Equal, std::allocator<sjtu::pair<const Integer, Matrix<int> > >,
+    sjtu::pow2_hash_policy, sjtu::lru_eviction, sjtu::unit_weigher, sjtu::wheel_expiry<sjtu::manual_clock> >;
+
+void check(bool ok){
+    if(!ok){
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+}
+
+void save(ttl_lru &cache, int key){
+    check(cache.save(value_type(Integer(key),Matrix<int>(1,1,key))));
+}
+
+void write_tester(){
+    std::cout<<c[2]<<std::endl;
+    ttl_lru cache(10);
+    auto &clock = cache.expiry().clock;
+    cache.expiry().expire_after_write(100);
+    for(int i=0;i<5;i++) save(cache, i);
+    clock.advance(50);
+    for(int i=5;i<10;i++) save(cache, i);
+    clock.advance(49);
+    check(cache.get(Integer(0)) != nullptr);
+    clock.advance(1);
+    // dead entries miss at once but stay until cleaned up
+    check(cache.get(Integer(0)) == nullptr && cache.lookup(Integer(4)) == nullptr && cache.size() == 10);
+    check(cache.cleanup() == 5 && cache.size() == 5 && cache.weight() == 5);
+    // a write starts the time again
+    save(cache, 5);
+    clock.advance(50);
+    save(cache, 10);
+    check(cache.size() == 2 && cache.get(Integer(5)) != nullptr && cache.get(Integer(6)) == nullptr);
+    cache.print();
+    std::cout<<c[0]<<std::endl;
+}
+
+void access_tester(){
+    std::cout<<c[3];
+    ttl_lru cache(10);
+    auto &clock = cache.expiry().clock;
+    cache.expiry().expire_after_access(10);
+    save(cache, 0);
+    save(cache, 1);
+    clock.advance(5);
+    check(cache.get(Integer(0)) != nullptr);
+    clock.advance(7);
+    check(cache.get(Integer(1)) == nullptr && cache.cleanup() == 1);
+    check(cache.get(Integer(0)) != nullptr);
+    clock.advance(10);
+    check(cache.get(Integer(0)) == nullptr && cache.cleanup() == 1 && cache.size() == 0);
+    std::cout<<c[0]<<std::endl;
+}
+
+void entry_tester(){
+    std::cout<<c[4];
+    ttl_lru cache(10);
+    auto &clock = cache.expiry().clock;
+    save(cache, 0);
+    save(cache, 1);
+    check(cache.expire_in(Integer(1), 3) && !cache.expire_in(Integer(2), 3));
+    clock.advance(1000);
+    check(cache.get(Integer(0)) != nullptr && cache.get(Integer(1)) == nullptr);
+    check(cache.cleanup() == 1 && cache.expiry().scheduled() == 0);
+    std::cout<<c[0]<<std::endl;
+}
+
+// deadlines on every level of the wheel, reached in uneven steps
+void far_tester(){
+    std::cout<<c[7];
+    const int n = 300;
+    ttl_lru cache(n);
+    auto &clock = cache.expiry().clock;
+    for(int i=0;i<n;i++){
+        save(cache, i);
+        cache.expire_in(Integer(i), 1 + (unsigned long long)i * i * i * 7);
+    }
+    size_t alive = n;
+    unsigned long long step = 1;
+    while(alive > 0){
+        clock.advance(step);
+        step = step * 3 / 2 + 1;
+        size_t dead = cache.cleanup();
+        check(dead <= alive);
+        alive -= dead;
+        check(cache.size() == alive && cache.expiry().scheduled() == alive);
+        for(int i=0;i<n;i++){
+            bool due = 1 + (unsigned long long)i * i * i * 7 <= clock.now();
+            check((cache.lookup(Integer(i)) == nullptr) == due);
+        }
+    }
+    std::cout<<c[0]<<std::endl;
+}
+
+int main(){
+#ifdef _OUTPUT_
+    freopen("21.out","w",stdout);
+#endif
+    write_tester();
+    access_tester();
+    entry_tester();
+    far_tester();
+    std::cout<<c[6];
+    if(Integer::counter == 0){
+        std::cout<<c[0]<<std::endl;
+    }
+    else{
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+    std::cout << c[5] << std::endl;
+}
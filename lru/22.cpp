@@ -0,0 +1,87 @@
+#define SJTU_STATS
+#include "src.hpp"
+#if defined (_UNORDERED_MAP_)  || (defined (_LIST_)) || (defined (_MAP_)) || (defined (_SET_)) || (defined (_UNORDERED_SET_))||(defined (_GLIBCXX_MAP)) || (defined (_GLIBCXX_UNORDERED_MAP))
+BOOM :)
+#endif
+#include <iostream>
+#include <string>
+
+// stats() snapshots of lru, hashmap and flat_hashmap
+#define _OUTPUT_
+
+std::string c[]={
+    "   pass!",
+    "   error.",
+    "test: lru counters",
+    "test: hashmap shape",
+    "test: flat_hashmap shape",
+    "Congratulations. Your submission has passed all correctness tests. Good job! :)",
+    "test: memcheck",
+};
+
+using value_type = sjtu::pair<Integer,Matrix<int> >;
+
+void check(bool ok){
+    if(!ok){
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+}
+
+void lru_tester(){
+    std::cout<<c[2]<<std::endl;
+    sjtu::lru cache(10);
+    for(int i=0;i<30;i++){
+        cache.save(value_type(Integer(i % 20),Matrix<int>(1,1,i)));
+    }
+    for(int i=0;i<20;i++) cache.get(Integer(i));
+    cache.emplace(Integer(19),2,2,0);
+    cache.save(value_type(Integer(9),Matrix<int>(1,1,9)));
+    sjtu::lru_stats st = cache.stats();
+    std::cout<<st.hits<<" "<<st.misses<<" "<<st.inserts<<" "<<st.updates<<" "<<st.evictions<<std::endl;
+    check(st.hits == 10 && st.misses == 10 && st.inserts == 31 && st.updates == 1 && st.evictions == 21);
+    check(st.weight == 10 && st.capacity == 10 && st.hit_ratio() == 0.5);
+    check(st.table.elements == 10 && st.table.finds >= 20 && st.table.probes > 0);
+    check(st.table.node_bytes == 10 * sizeof(sjtu::lru::node_type) && st.table.bucket_bytes > 0);
+    std::cout<<c[0]<<std::endl;
+}
+
+void hashmap_tester(){
+    std::cout<<c[3];
+    sjtu::hashmap<Integer,Matrix<int>,Hash,Equal> map(4);
+    for(int i=0;i<100;i++) map.insert(value_type(Integer(i),Matrix<int>(1,1,i)));
+    sjtu::table_stats st = map.stats();
+    check(st.elements == 100 && st.resizes >= 5 && st.load_factor() == map.load_factor());
+    check(st.chain_total == 100 && st.chains <= 100 && st.max_chain >= 1 && st.mean_chain() >= 1);
+    for(int i=0;i<100;i++) map.find(Integer(i));
+    check(map.stats().finds - st.finds == 100 && map.stats().probes - st.probes >= 100);
+    std::cout<<c[0]<<std::endl;
+}
+
+void flat_tester(){
+    std::cout<<c[4];
+    sjtu::flat_hashmap<Integer,Matrix<int>,Hash,Equal> map(16);
+    for(int i=0;i<100;i++) map.insert(value_type(Integer(i),Matrix<int>(1,1,i)));
+    sjtu::table_stats st = map.stats();
+    check(st.elements == 100 && st.chains == 100 && st.resizes >= 2 && st.buckets == map.bucket_count());
+    check(st.mean_chain() >= 1 && st.max_chain >= 1 && st.node_bytes == st.buckets * sizeof(value_type));
+    std::cout<<c[0]<<std::endl;
+}
+
+int main(){
+#ifdef _OUTPUT_
+    freopen("22.out","w",stdout);
+#endif
+    lru_tester();
+    hashmap_tester();
+    flat_tester();
+    std::cout<<c[6];
+    if(Integer::counter == 0){
+        std::cout<<c[0]<<std::endl;
+    }
+    else{
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+    std::cout << c[5] << std::endl;
+}
@@ -0,0 +1,170 @@
+#include "trace.hpp"
+#include "eviction.hpp"
+#if defined (_UNORDERED_MAP_)  || (defined (_LIST_)) || (defined (_MAP_)) || (defined (_SET_)) || (defined (_UNORDERED_SET_))||(defined (_GLIBCXX_MAP)) || (defined (_GLIBCXX_UNORDERED_MAP))
+BOOM :)
+#endif
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// key traces, the order-statistic tree and the one-pass miss-ratio curve
+#define _OUTPUT_
+
+std::string c[]={
+    "   pass!",
+    "   error.",
+    "test: trace round trip",
+    "test: traced cache",
+    "test: order statistic tree",
+    "Congratulations. Your submission has passed all correctness tests. Good job! :)",
+    "test: memcheck",
+    "test: curve against replay",
+};
+
+const char *path = "23.trace";
+unsigned long long seed = 23;
+
+unsigned long long next_random(){
+    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+    return seed >> 33;
+}
+
+void check(bool ok){
+    if(!ok){
+        std::cout<<c[1]<<std::endl;
+        std::remove(path);
+        exit(0);
+    }
+}
+
+void round_trip_tester(){
+    std::cout<<c[2]<<std::endl;
+    std::vector<sjtu::trace_record> records;
+    uint64_t edges[] = {0, 1, ~0ull, 0, 1ull << 63, (1ull << 63) - 1, 31, 32, 5, 4};
+    for(auto k: edges) records.push_back({sjtu::trace_save, k});
+    for(int i=0;i<100000;i++){
+        uint64_t key = next_random() % 3 == 0 ? next_random() << 20 : next_random() % 1000;
+        records.push_back({sjtu::trace_op(next_random() % 3), key});
+    }
+    {
+        sjtu::trace_writer out(path);
+        for(auto &r: records) out.record(r.op, r.key);
+        check(out.records() == records.size());
+    }
+    sjtu::trace_reader in(path);
+    sjtu::trace_record r;
+    for(auto &want: records){
+        check(in.next(r) && r.op == want.op && r.key == want.key);
+    }
+    check(!in.next(r));
+    bool thrown = false;
+    try{
+        sjtu::trace_reader bad("23.cpp");
+    }catch(const sjtu::runtime_error &){
+        thrown = true;
+    }
+    check(thrown);
+}
+
+void traced_tester(){
+    std::cout<<c[3]<<std::endl;
+    {
+        sjtu::trace_writer out(path);
+        sjtu::traced<sjtu::basic_lru<> > cache(out, 2);
+        cache.save(sjtu::pair<const Integer, Matrix<int> >(Integer(-7), Matrix<int>(1,1,7)));
+        check(cache.get(Integer(-7)) != nullptr);
+        check(cache.get(Integer(3)) == nullptr);
+        check(out.records() == 3);
+    }
+    sjtu::trace_reader in(path);
+    sjtu::trace_record r;
+    check(in.next(r) && r.op == sjtu::trace_save && r.key == uint64_t(-7));
+    check(in.next(r) && r.op == sjtu::trace_get && r.key == uint64_t(-7));
+    check(in.next(r) && r.op == sjtu::trace_get && r.key == 3);
+    check(!in.next(r));
+}
+
+void tree_tester(){
+    std::cout<<c[4]<<std::endl;
+    const size_t n = 1000;
+    sjtu::order_statistic_tree tree(n);
+    std::vector<bool> full(n, false);
+    for(int i=0;i<20000;i++){
+        size_t slot = next_random() % n;
+        if(full[slot]) tree.erase(slot);
+        else tree.insert(slot);
+        full[slot] = !full[slot];
+        size_t probe = next_random() % n, want = 0, total = 0;
+        for(size_t j=0;j<n;j++){
+            total += full[j];
+            if(j > probe) want += full[j];
+        }
+        check(tree.count_greater(probe) == want && tree.size() == total);
+    }
+    tree.assign(n, 10);
+    check(tree.size() == 10 && tree.count_greater(4) == 5 && tree.count_greater(9) == 0);
+}
+
+void curve_tester(){
+    std::cout<<c[7]<<std::endl;
+    // skewed accesses over 40000 keys: enough slots to be packed a few times
+    {
+        sjtu::trace_writer out(path);
+        for(int i=0;i<300000;i++){
+            uint64_t r = next_random() % 40000;
+            out.record(sjtu::trace_access, r * r / 40000 * 2654435761ull);
+        }
+    }
+    using cache_type = sjtu::basic_lru<unsigned long long, char, std::hash<unsigned long long>,
+        std::equal_to<unsigned long long>, std::allocator<sjtu::pair<const unsigned long long, char> > >;
+    size_t sizes[] = {1, 10, 500, 5000, 20000, 40000};
+    std::vector<cache_type *> caches;
+    std::vector<uint64_t> misses;
+    for(auto s: sizes){
+        caches.push_back(new cache_type(s));
+        misses.push_back(0);
+    }
+    sjtu::stack_distance stack;
+    sjtu::miss_ratio_curve curve;
+    sjtu::trace_reader in(path);
+    for(sjtu::trace_record r; in.next(r); ){
+        curve.add(stack.reference(r.key));
+        for(size_t i=0;i<caches.size();i++){
+            if(caches[i]->get(r.key) == nullptr){
+                ++misses[i];
+                caches[i]->save(sjtu::pair<const unsigned long long, char>(r.key, 0));
+            }
+        }
+    }
+    check(curve.requests() == 300000 && curve.cold_misses() == stack.distinct());
+    for(size_t i=0;i<caches.size();i++){
+        uint64_t predicted = (uint64_t)(curve.miss_ratio(sizes[i]) * curve.requests() + 0.5);
+        check(predicted == misses[i]);
+        delete caches[i];
+    }
+    std::vector<double> ratio = curve.curve();
+    check(ratio.size() == curve.max_useful_capacity() && ratio.size() <= stack.distinct());
+    check((uint64_t)(ratio.back() * curve.requests() + 0.5) == curve.cold_misses());
+    for(size_t i=1;i<ratio.size();i++) check(ratio[i] <= ratio[i - 1]);
+}
+
+int main(){
+#ifdef _OUTPUT_
+    freopen("23.out","w",stdout);
+#endif
+    round_trip_tester();
+    traced_tester();
+    tree_tester();
+    curve_tester();
+    std::remove(path);
+    std::cout<<c[6];
+    if(Integer::counter == 0){
+        std::cout<<c[0]<<std::endl;
+    }
+    else{
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+    std::cout << c[5] << std::endl;
+}
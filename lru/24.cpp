@@ -0,0 +1,128 @@
+#include "shards.hpp"
+#if defined (_UNORDERED_MAP_)  || (defined (_LIST_)) || (defined (_MAP_)) || (defined (_SET_)) || (defined (_UNORDERED_SET_))||(defined (_GLIBCXX_MAP)) || (defined (_GLIBCXX_UNORDERED_MAP))
+BOOM :)
+#endif
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// sampled miss-ratio curves of a live lru against the exact one
+#define _OUTPUT_
+
+std::string c[]={
+    "   pass!",
+    "   error.",
+    "test: full sample",
+    "test: fixed rate",
+    "test: fixed size",
+    "Congratulations. Your submission has passed all correctness tests. Good job! :)",
+    "test: memcheck",
+    "test: capacity for a target",
+};
+
+using value_type = sjtu::pair<Integer,Matrix<int> >;
+using sampled_lru = sjtu::basic_lru<Integer, Matrix<int>, Hash, Equal, std::allocator<sjtu::pair<const Integer, Matrix<int> > >,
+    sjtu::pow2_hash_policy, sjtu::lru_eviction, sjtu::unit_weigher, sjtu::no_expiry, sjtu::shards_sampler>;
+
+unsigned long long seed = 24;
+
+int next_key(int keys){
+    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+    unsigned long long r = (seed >> 33) % (unsigned long long)keys;
+    return (int)(r * r / (unsigned long long)keys);
+}
+
+void check(bool ok){
+    if(!ok){
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+}
+
+/**
+ * demand-filled skewed accesses through the cache, and the exact curve
+ */
+void drive(sampled_lru &cache, sjtu::miss_ratio_curve &exact, int requests, int keys){
+    sjtu::stack_distance stack;
+    for(int i=0;i<requests;i++){
+        int key = next_key(keys);
+        exact.add(stack.reference((uint64_t)key));
+        if(cache.get(Integer(key)) == nullptr) cache.save(value_type(Integer(key),Matrix<int>(1,1,key)));
+    }
+}
+
+void full_tester(){
+    std::cout<<c[2]<<std::endl;
+    sampled_lru cache(100);
+    cache.sampler() = sjtu::shards_sampler(1.0);
+    sjtu::miss_ratio_curve exact;
+    drive(cache, exact, 50000, 2000);
+    auto &sampler = cache.sampler();
+    check(sampler.rate() == 1.0 && sampler.requests() == 50000 && sampler.sampled_keys() == exact.cold_misses());
+    // one bin per distance up to 31: exact there
+    for(size_t cap=0;cap<32;cap++) check(std::fabs(sampler.miss_ratio(cap) - exact.miss_ratio(cap)) < 1e-9);
+    for(size_t cap=32;cap<=2000;cap+=97) check(std::fabs(sampler.miss_ratio(cap) - exact.miss_ratio(cap)) < 0.01);
+}
+
+void rate_tester(){
+    std::cout<<c[3]<<std::endl;
+    sampled_lru cache(1000);
+    cache.sampler() = sjtu::shards_sampler(0.1);
+    sjtu::miss_ratio_curve exact;
+    drive(cache, exact, 300000, 50000);
+    auto &sampler = cache.sampler();
+    check(sampler.sampled_keys() > 3000 && sampler.sampled_keys() < 7000);
+    size_t caps[] = {500, 1000, 5000, 20000, 50000};
+    for(auto cap: caps) check(std::fabs(sampler.miss_ratio(cap) - exact.miss_ratio(cap)) < 0.03);
+}
+
+void size_tester(){
+    std::cout<<c[4]<<std::endl;
+    sampled_lru cache(1000);
+    cache.sampler() = sjtu::shards_sampler(1.0, 1000);
+    sjtu::miss_ratio_curve exact;
+    drive(cache, exact, 300000, 50000);
+    auto &sampler = cache.sampler();
+    check(sampler.sampled_keys() <= 1000 && sampler.sampled_keys() > 500);
+    check(sampler.rate() < 0.03 && sampler.rate() > 0.01);
+    size_t caps[] = {2000, 5000, 20000, 50000};
+    for(auto cap: caps) check(std::fabs(sampler.miss_ratio(cap) - exact.miss_ratio(cap)) < 0.05);
+    size_t bytes = sampler.bytes();
+    drive(cache, exact, 300000, 50000);
+    check(sampler.sampled_keys() <= 1000 && sampler.bytes() <= bytes * 2);
+}
+
+void target_tester(){
+    std::cout<<c[7]<<std::endl;
+    sampled_lru cache(1000);
+    cache.sampler() = sjtu::shards_sampler(0.5);
+    sjtu::miss_ratio_curve exact;
+    drive(cache, exact, 200000, 20000);
+    auto &sampler = cache.sampler();
+    double targets[] = {0.9, 0.5, 0.3, 0.2};
+    for(auto t: targets){
+        size_t cap = sampler.capacity_for(t);
+        check(cap > 0 && sampler.miss_ratio(cap) <= t && sampler.miss_ratio(cap - 1) > t);
+    }
+    check(sampler.capacity_for(0.0) == 0);
+}
+
+int main(){
+#ifdef _OUTPUT_
+    freopen("24.out","w",stdout);
+#endif
+    full_tester();
+    rate_tester();
+    size_tester();
+    target_tester();
+    std::cout<<c[6];
+    if(Integer::counter == 0){
+        std::cout<<c[0]<<std::endl;
+    }
+    else{
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+    std::cout << c[5] << std::endl;
+}
@@ -0,0 +1,222 @@
+#include "snapshot.hpp"
+#include "expiry.hpp"
+#if defined (_UNORDERED_MAP_)  || (defined (_LIST_)) || (defined (_MAP_)) || (defined (_SET_)) || (defined (_UNORDERED_SET_))||(defined (_GLIBCXX_MAP)) || (defined (_GLIBCXX_UNORDERED_MAP))
+BOOM :)
+#endif
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// binary snapshots and warm restart of linked_hashmap and lru
+#define _OUTPUT_
+
+std::string c[]={
+    "   pass!",
+    "   error.",
+    "test: map round trip",
+    "test: lru round trip",
+    "test: trivially copyable values",
+    "Congratulations. Your submission has passed all correctness tests. Good job! :)",
+    "test: memcheck",
+    "test: broken snapshots",
+    "test: expired entries",
+};
+
+const char *path = "25.snap", *other = "25.bad";
+using value_type = sjtu::pair<Integer,Matrix<int> >;
+using map_type = sjtu::linked_hashmap<Integer, Matrix<int>, Hash, Equal>;
+
+void check(bool ok){
+    if(!ok){
+        std::cout<<c[1]<<std::endl;
+        std::remove(path);
+        std::remove(other);
+        exit(0);
+    }
+}
+
+std::string contents(const char *file){
+    std::string s;
+    std::FILE *f = std::fopen(file, "rb");
+    if(f == nullptr) return s;
+    char buf[4096];
+    for(size_t n; (n = std::fread(buf, 1, sizeof(buf), f)) > 0; ) s.append(buf, n);
+    std::fclose(f);
+    return s;
+}
+
+void put(const char *file, const std::string &s){
+    std::FILE *f = std::fopen(file, "wb");
+    std::fwrite(s.data(), 1, s.size(), f);
+    std::fclose(f);
+}
+
+void map_tester(){
+    std::cout<<c[2]<<std::endl;
+    map_type map;
+    for(int i=0;i<3000;i++){
+        int r = i % 7, col = i % 5;
+        Matrix<int> m(r, col);
+        for(int x=0;x<r;x++) for(int y=0;y<col;y++) m[x][y] = i * 31 + x * 7 + y;
+        map.insert(value_type(Integer(i * 13 % 3001), m));
+    }
+    map.remove(map.find(Integer(13)));
+    map.insert(value_type(Integer(13), Matrix<int>(2,2,-1)));  // now last
+    uint64_t bytes = sjtu::save_snapshot(map, path);
+    check(bytes == contents(path).size() && contents("25.snap.tmp").empty());
+
+    map_type copy;
+    copy.insert(value_type(Integer(-5), Matrix<int>(1,1,5)));
+    sjtu::load_snapshot(copy, path);
+    check(copy.size() == map.size() && copy.find(Integer(-5)) == copy.end());
+    map_type sized;
+    sized.reserve(map.size());
+    check(copy.bucket_count() == sized.bucket_count());
+    auto a = map.begin(), b = copy.begin();
+    int last = 0;
+    for(; a != map.end(); ++a, ++b){
+        check(b != copy.end() && a->first.val == b->first.val && a->second == b->second);
+        last = b->first.val;
+    }
+    check(b == copy.end() && last == 13);
+}
+
+void lru_tester(){
+    std::cout<<c[3]<<std::endl;
+    {
+        sjtu::lru cache(100);
+        for(int i=0;i<150;i++) cache.save(value_type(Integer(i),Matrix<int>(3,3,i)));
+        for(int i=60;i<80;i++) check(cache.get(Integer(i)) != nullptr);
+        sjtu::save_snapshot(cache, path);
+
+        sjtu::lru warm(100);
+        sjtu::load_snapshot(warm, path);
+        check(warm.size() == 100 && warm.weight() == 100);
+        check(warm.get(Integer(49)) == nullptr && *warm.get(Integer(50)) == Matrix<int>(3,3,50));
+        // same recency order: the same snapshot once more
+        std::string first = contents(path);
+        sjtu::lru again(100);
+        sjtu::load_snapshot(again, path);
+        sjtu::save_snapshot(again, path);
+        check(contents(path) == first);
+        // a smaller cache keeps the most recent
+        sjtu::lru small(10);
+        sjtu::load_snapshot(small, path);
+        check(small.size() == 10);
+        for(int i=70;i<80;i++) check(small.get(Integer(i)) != nullptr);
+        // loading replaces what was there, as for linked_hashmap
+        sjtu::lru used(300);
+        for(int i=1000;i<1100;i++) used.save(value_type(Integer(i),Matrix<int>(1,1,i)));
+        sjtu::load_snapshot(used, path);
+        check(used.size() == 100 && used.weight() == 100 && used.get(Integer(1099)) == nullptr);
+        sjtu::save_snapshot(used, path);
+        check(contents(path) == first);
+        // the table is sized for the capacity, not for a bigger snapshot
+        sjtu::lru big(3000);
+        for(int i=0;i<3000;i++) big.save(value_type(Integer(i),Matrix<int>(1,1,i)));
+        sjtu::save_snapshot(big, path);
+        sjtu::lru tiny(10), fresh(10);
+        sjtu::load_snapshot(tiny, path);
+        check(tiny.size() == 10 && tiny.stats().table.buckets == fresh.stats().table.buckets);
+    }
+}
+
+void trivial_tester(){
+    std::cout<<c[4]<<std::endl;
+    sjtu::linked_hashmap<long long, double> map, copy;
+    for(long long i=0;i<100000;i++) map.insert(sjtu::pair<const long long, double>(i * i, i / 3.0));
+    uint64_t bytes = sjtu::save_snapshot(map, path);
+    check(bytes == 16 + 100000 * 16);
+    sjtu::load_snapshot(copy, path);
+    auto b = copy.begin();
+    for(auto a = map.begin(); a != map.end(); ++a, ++b) check(a->first == b->first && a->second == b->second);
+}
+
+void broken_tester(){
+    std::cout<<c[7]<<std::endl;
+    map_type map;
+    for(int i=0;i<100;i++) map.insert(value_type(Integer(i), Matrix<int>(4,4,i)));
+    sjtu::save_snapshot(map, path);
+    std::string good = contents(path);
+    int thrown = 0;
+    std::string bad[] = {good.substr(0, good.size() - 3), good.substr(0, 12), "SJSNAP02" + good.substr(8), ""};
+    for(auto &s: bad){
+        put(other, s);
+        map_type copy;
+        try{
+            sjtu::load_snapshot(copy, other);
+        }catch(const sjtu::runtime_error &){
+            ++thrown;
+        }
+    }
+    std::remove(other);
+    try{
+        map_type copy;
+        sjtu::load_snapshot(copy, other);
+    }catch(const sjtu::runtime_error &){
+        ++thrown;
+    }
+    check(thrown == 5);
+    // a truncated snapshot: what was read up to the end is in, nothing of before
+    put(other, good.substr(0, good.size() / 2));
+    map_type part;
+    part.insert(value_type(Integer(-5), Matrix<int>(1,1,5)));
+    sjtu::lru partLru(1000);
+    partLru.save(value_type(Integer(-5), Matrix<int>(1,1,5)));
+    thrown = 0;
+    try{
+        sjtu::load_snapshot(part, other);
+    }catch(const sjtu::runtime_error &){
+        ++thrown;
+    }
+    try{
+        sjtu::load_snapshot(partLru, other);
+    }catch(const sjtu::runtime_error &){
+        ++thrown;
+    }
+    check(thrown == 2 && part.find(Integer(-5)) == part.end() && partLru.lookup(Integer(-5)) == nullptr);
+    check(part.size() > 0 && part.size() < 100 && partLru.size() == part.size());
+    int i = 0;
+    for(auto it = part.begin(); it != part.end(); ++it, ++i){
+        check(it->first.val == i && it->second == Matrix<int>(4,4,i) && *partLru.get(Integer(i)) == Matrix<int>(4,4,i));
+    }
+    std::remove(other);
+}
+
+void expired_tester(){
+    std::cout<<c[8]<<std::endl;
+    using ttl_lru = sjtu::basic_lru<Integer, Matrix<int>, Hash, Equal, std::allocator<sjtu::pair<const Integer, Matrix<int> > >,
+        sjtu::pow2_hash_policy, sjtu::lru_eviction, sjtu::unit_weigher, sjtu::wheel_expiry<sjtu::manual_clock> >;
+    ttl_lru cache(20);
+    cache.expiry().expire_after_write(100);
+    for(int i=0;i<10;i++) cache.save(value_type(Integer(i),Matrix<int>(1,1,i)));
+    cache.expiry().clock.advance(60);
+    for(int i=10;i<20;i++) cache.save(value_type(Integer(i),Matrix<int>(1,1,i)));
+    cache.expiry().clock.advance(40);
+    sjtu::save_snapshot(cache, path);
+    ttl_lru warm(20);
+    sjtu::load_snapshot(warm, path);
+    check(warm.size() == 10 && warm.get(Integer(9)) == nullptr && warm.get(Integer(10)) != nullptr);
+}
+
+int main(){
+#ifdef _OUTPUT_
+    freopen("25.out","w",stdout);
+#endif
+    map_tester();
+    lru_tester();
+    trivial_tester();
+    broken_tester();
+    expired_tester();
+    std::remove(path);
+    std::cout<<c[6];
+    if(Integer::counter == 0){
+        std::cout<<c[0]<<std::endl;
+    }
+    else{
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+    std::cout << c[5] << std::endl;
+}
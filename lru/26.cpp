@@ -0,0 +1,193 @@
+#include "frozen.hpp"
+#if defined (_UNORDERED_MAP_)  || (defined (_LIST_)) || (defined (_MAP_)) || (defined (_SET_)) || (defined (_UNORDERED_SET_))||(defined (_GLIBCXX_MAP)) || (defined (_GLIBCXX_UNORDERED_MAP))
+BOOM :)
+#endif
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// frozen, memory-mapped linked_hashmap files
+#define _OUTPUT_
+
+std::string c[]={
+    "   pass!",
+    "   error.",
+    "test: freeze and find",
+    "test: list order",
+    "test: trivially copyable keys",
+    "Congratulations. Your submission has passed all correctness tests. Good job! :)",
+    "test: memcheck",
+    "test: bad files",
+};
+
+const char *path = "26.frozen", *other = "26.bad";
+using value_type = sjtu::pair<Integer,Matrix<int> >;
+using map_type = sjtu::linked_hashmap<Integer, Matrix<int>, Hash, Equal>;
+
+void check(bool ok){
+    if(!ok){
+        std::cout<<c[1]<<std::endl;
+        std::remove(path);
+        std::remove(other);
+        exit(0);
+    }
+}
+
+Matrix<int> value_of(int i){
+    Matrix<int> m(i % 6, i % 4);
+    for(int x=0;x<i%6;x++) for(int y=0;y<i%4;y++) m[x][y] = i * 17 + x * 5 + y;
+    return m;
+}
+
+void find_tester(){
+    std::cout<<c[2]<<std::endl;
+    map_type map;
+    for(int i=0;i<5000;i++) map.insert(value_type(Integer(i * 7 - 9000), value_of(i)));
+    uint64_t bytes = sjtu::freeze(map, path);
+    sjtu::frozen_map<> frozen(path), twice(path);
+    check(frozen.size() == 5000 && frozen.bytes() == bytes && twice.size() == 5000);
+    for(int i=0;i<5000;i++){
+        auto m = frozen.find(Integer(i * 7 - 9000));
+        check(m && m == value_of(i) && m.matrix() == value_of(i));
+        check(twice.find(Integer(i * 7 - 9000)).RowSize() == size_t(i % 6));
+    }
+    for(int i=0;i<5000;i++) check(!frozen.find(Integer(i * 7 - 8999)) && frozen.count(Integer(i * 7 - 8998)) == 0);
+    auto m = frozen.find(Integer(5 * 7 - 9000));
+    check(m.RowSize() == 5 && m.ColSize() == 1 && m[4][0] == 5 * 17 + 20);
+
+    map_type none;
+    sjtu::freeze(none, path);
+    sjtu::frozen_map<> empty(path);
+    check(empty.empty() && !empty.find(Integer(0)));
+}
+
+void order_tester(){
+    std::cout<<c[3]<<std::endl;
+    map_type map;
+    for(int i=0;i<100;i++) map.insert(value_type(Integer(i), value_of(i)));
+    for(int i=0;i<100;i+=3) map.remove(map.find(Integer(i)));
+    map.insert(value_type(Integer(0), value_of(0)));
+    sjtu::freeze(map, path);
+    sjtu::frozen_map<> frozen(path);
+    auto it = map.begin();
+    int n = 0;
+    frozen.for_each([&](const Integer &key, const sjtu::frozen_matrix<int> &m){
+        check(it != map.end() && key.val == it->first.val && m == it->second);
+        ++it, ++n;
+    });
+    check(it == map.end() && n == 67);
+}
+
+void trivial_tester(){
+    std::cout<<c[4]<<std::endl;
+    sjtu::linked_hashmap<long long, Matrix<double> > map;
+    for(long long i=0;i<1000;i++) map.insert(sjtu::pair<const long long, Matrix<double> >(i << 33, Matrix<double>(2, 3, i / 4.0)));
+    sjtu::freeze(map, path);
+    sjtu::frozen_map<long long, double, std::hash<long long>, std::equal_to<long long> > frozen(path);
+    for(long long i=0;i<1000;i++){
+        auto m = frozen.find(i << 33);
+        check(m && m[1][2] == i / 4.0);
+        check(!frozen.find(i << 32 | 1));
+    }
+}
+
+void bad_tester(){
+    std::cout<<c[7]<<std::endl;
+    int thrown = 0;
+    auto attempt = [&](const char *file){
+        try{
+            sjtu::frozen_map<> frozen(file);
+        }catch(const sjtu::runtime_error &){
+            ++thrown;
+        }
+    };
+    map_type map;
+    for(int i=0;i<10;i++) map.insert(value_type(Integer(i), value_of(i)));
+    sjtu::freeze(map, path);
+    // wrong element type
+    try{
+        sjtu::frozen_map<Integer, double> frozen(path);
+    }catch(const sjtu::runtime_error &){
+        ++thrown;
+    }
+    std::FILE *in = std::fopen(path, "rb");
+    std::string bytes;
+    char buf[4096];
+    for(size_t n; (n = std::fread(buf, 1, sizeof(buf), in)) > 0; ) bytes.append(buf, n);
+    std::fclose(in);
+    std::string bad[] = {bytes.substr(0, bytes.size() - 8), "SJFROZ02" + bytes.substr(8), bytes.substr(0, 20)};
+    for(auto &s: bad){
+        std::FILE *out = std::fopen(other, "wb");
+        std::fwrite(s.data(), 1, s.size(), out);
+        std::fclose(out);
+        attempt(other);
+    }
+    std::remove(other);
+    attempt(other);
+    check(thrown == 5);
+
+    // a slot or a record pointing past the end opens, but is refused when read
+    auto word = [&](size_t at){
+        uint64_t w;
+        std::memcpy(&w, bytes.data() + at, 8);
+        return w;
+    };
+    auto reads = [&](const std::string &s){
+        std::FILE *out = std::fopen(other, "wb");
+        std::fwrite(s.data(), 1, s.size(), out);
+        std::fclose(out);
+        sjtu::frozen_map<> frozen(other);
+        int refused = 0;
+        try{
+            frozen.for_each([](const Integer &, const sjtu::frozen_matrix<int> &){});
+        }catch(const sjtu::runtime_error &){
+            ++refused;
+        }
+        for(int i=0;i<10;i++){
+            try{
+                frozen.find(Integer(i));
+            }catch(const sjtu::runtime_error &){
+                ++refused;
+            }
+        }
+        return refused;
+    };
+    size_t slots = word(24), slotOffset = word(32), heap = word(48);
+    size_t slotBytes = sizeof(sjtu::frozen_slot<Integer>);
+    size_t used = slotOffset;
+    while(word(used + 8) == 0) used += slotBytes;
+    check(used < slotOffset + slots * slotBytes);
+    std::string past = bytes, huge = bytes;
+    uint64_t end = bytes.size(), rows = uint64_t(1) << 40;
+    std::memcpy(&past[used + 8], &end, 8);
+    check(reads(past) == 2);
+    // the first record is key 0's: 0 x 0, now 2^40 x 0 and then 2^40 x 1
+    std::memcpy(&huge[heap], &rows, 8);
+    check(reads(huge) == 2);
+    uint64_t one = 1;
+    std::memcpy(&huge[heap + 8], &one, 8);
+    check(reads(huge) == 2);
+    check(reads(bytes) == 0);
+    std::remove(other);
+}
+
+int main(){
+#ifdef _OUTPUT_
+    freopen("26.out","w",stdout);
+#endif
+    find_tester();
+    order_tester();
+    trivial_tester();
+    bad_tester();
+    std::remove(path);
+    std::cout<<c[6];
+    if(Integer::counter == 0){
+        std::cout<<c[0]<<std::endl;
+    }
+    else{
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+    std::cout << c[5] << std::endl;
+}
@@ -0,0 +1,189 @@
+#include "shared-lru.hpp"
+#if defined (_UNORDERED_MAP_)  || (defined (_LIST_)) || (defined (_MAP_)) || (defined (_SET_)) || (defined (_UNORDERED_SET_))||(defined (_GLIBCXX_MAP)) || (defined (_GLIBCXX_UNORDERED_MAP))
+BOOM :)
+#endif
+#include <iostream>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// an lru in shared memory, used from several processes
+#define _OUTPUT_
+
+std::string c[]={
+    "   pass!",
+    "   error.",
+    "test: one process",
+    "test: shared between processes",
+    "test: recovery from a dead lock holder",
+    "Congratulations. Your submission has passed all correctness tests. Good job! :)",
+    "test: memcheck",
+    "test: value memory",
+};
+
+std::string name = "/sjtu-test27-" + std::to_string(getpid());
+
+void check(bool ok){
+    if(!ok){
+        std::cout<<c[1]<<std::endl;
+        sjtu::shared_lru<>::unlink(name.c_str());
+        exit(0);
+    }
+}
+
+/**
+ * run f in a child process; true if it exited with 0
+ */
+template<class F>
+bool in_child(F f){
+    std::cout.flush();
+    pid_t pid = fork();
+    if(pid == 0){
+        _exit(f() ? 0 : 1);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+void local_tester(){
+    std::cout<<c[2]<<std::endl;
+    // no room at all is refused, and leaves no segment behind
+    for(size_t shards: {1, 4}){
+        bool thrown = false;
+        try{
+            sjtu::shared_lru<> cache(name.c_str(), 0, 1 << 20, shards);
+        }catch(const sjtu::runtime_error &){
+            thrown = true;
+        }
+        check(thrown);
+    }
+    {
+        sjtu::shared_lru<> cache(name.c_str(), 40, 1 << 20, 1);
+        for(int i=0;i<40;i++) check(cache.save(Integer(i), Matrix<int>(2,3,i)));
+        check(cache.size() == 40);
+        Matrix<int> m;
+        check(cache.get(Integer(7), m) && m == Matrix<int>(2,3,7));
+        check(!cache.get(Integer(40), m) && m == Matrix<int>(2,3,7));
+        // a bigger value for a present key
+        check(cache.save(Integer(7), Matrix<int>(10,10,-7)) && cache.get(Integer(7), m) && m == Matrix<int>(10,10,-7));
+        check(cache.remove(Integer(7)) && !cache.remove(Integer(7)) && cache.size() == 39);
+        // 0 was used last, so 1 and 2 go first
+        check(cache.get(Integer(0), m));
+        for(int i=100;i<103;i++) check(cache.save(Integer(i), Matrix<int>(1,1,i)));
+        check(cache.size() == 40 && !cache.get(Integer(1), m) && !cache.get(Integer(2), m));
+        check(cache.get(Integer(0), m) && cache.get(Integer(3), m) && m == Matrix<int>(2,3,3));
+        bool visited = cache.visit(Integer(102), [](const sjtu::frozen_matrix<int> &v){
+            check(v.RowSize() == 1 && v.ColSize() == 1 && v[0][0] == 102);
+        });
+        check(visited);
+        sjtu::shared_lru<>::unlink(name.c_str());
+    }
+    {
+        // 4 shards of 25: never more than 100 in all
+        sjtu::shared_lru<> cache(name.c_str(), 100, 1 << 20, 4);
+        for(int i=0;i<1000;i++) check(cache.save(Integer(i), Matrix<int>(1,1,i)));
+        size_t n = cache.size();
+        check(n <= 100 && n >= 60);
+        Matrix<int> m;
+        check(cache.get(Integer(999), m) && m[0][0] == 999 && !cache.get(Integer(0), m));
+        sjtu::shared_lru<>::unlink(name.c_str());
+    }
+}
+
+void process_tester(){
+    std::cout<<c[3]<<std::endl;
+    sjtu::shared_lru<> cache(name.c_str(), 1000, 4 << 20, 8);
+    // children write disjoint halves, then read each other's
+    check(in_child([]{
+        sjtu::shared_lru<> mine(name.c_str());
+        for(int i=0;i<500;i+=2) if(!mine.save(Integer(i), Matrix<int>(3,3,i))) return false;
+        return true;
+    }));
+    check(in_child([]{
+        sjtu::shared_lru<> mine(name.c_str());
+        Matrix<int> m;
+        for(int i=0;i<500;i+=2) if(!mine.get(Integer(i), m) || !(m == Matrix<int>(3,3,i))) return false;
+        for(int i=1;i<500;i+=2) if(!mine.save(Integer(i), Matrix<int>(1,2,i))) return false;
+        return true;
+    }));
+    Matrix<int> m;
+    for(int i=0;i<500;i++) check(cache.get(Integer(i), m) && m.RowSize() == size_t(i % 2 == 0 ? 3 : 1) && m[0][0] == i);
+    check(cache.size() == 500);
+    // a segment of another value type is refused
+    bool thrown = false;
+    try{
+        sjtu::shared_lru<Integer, double> other(name.c_str());
+    }catch(const sjtu::runtime_error &){
+        thrown = true;
+    }
+    check(thrown);
+    sjtu::shared_lru<>::unlink(name.c_str());
+}
+
+void recovery_tester(){
+    std::cout<<c[4]<<std::endl;
+    sjtu::shared_lru<> cache(name.c_str(), 100, 1 << 20, 2);
+    for(int i=0;i<50;i++) cache.save(Integer(i), Matrix<int>(1,1,i));
+    // the child dies inside visit(), holding the lock of key 3's shard
+    check(!in_child([]{
+        sjtu::shared_lru<> mine(name.c_str());
+        mine.visit(Integer(3), [](const sjtu::frozen_matrix<int> &){ _exit(3); });
+        return true;
+    }));
+    Matrix<int> m;
+    check(!cache.get(Integer(3), m) && cache.recovered() == 1);
+    check(cache.save(Integer(3), Matrix<int>(1,1,3)) && cache.get(Integer(3), m) && m[0][0] == 3);
+    size_t left = cache.size();
+    check(left > 1 && left < 50);
+    sjtu::shared_lru<>::unlink(name.c_str());
+}
+
+void memory_tester(){
+    std::cout<<c[7]<<std::endl;
+    // far more values than the arena holds: eviction makes the room
+    sjtu::shared_lru<> cache(name.c_str(), 20000, 1 << 20, 1);
+    for(int i=0;i<3000;i++) check(cache.save(Integer(i), Matrix<int>(8,8,i)));
+    size_t n = cache.size();
+    check(n > 1000 && n < 3000);
+    Matrix<int> m;
+    check(cache.get(Integer(2999), m) && m == Matrix<int>(8,8,2999) && !cache.get(Integer(0), m));
+    // too large for any shard: refused, and nothing is evicted for it
+    check(!cache.save(Integer(-1), Matrix<int>(1000,1000,1)) && cache.size() == n);
+    // nor is an old value lost to a failed update
+    check(!cache.save(Integer(2999), Matrix<int>(1000,1000,1)) && cache.size() == n);
+    check(cache.get(Integer(2999), m) && m == Matrix<int>(8,8,2999));
+    // freed blocks merge, so a bigger value costs a few entries, not all
+    check(cache.save(Integer(-2), Matrix<int>(12,12,-2)) && cache.size() > n - 10);
+    check(cache.get(Integer(-2), m) && m == Matrix<int>(12,12,-2));
+    check(cache.get(Integer(2998), m) && m == Matrix<int>(8,8,2998));
+    // an update either takes the new value or keeps the old one
+    size_t before = cache.size();
+    if(cache.save(Integer(2998), Matrix<int>(300,300,7))){
+        check(cache.get(Integer(2998), m) && m == Matrix<int>(300,300,7));
+    }else{
+        check(cache.size() == before && cache.get(Integer(2998), m) && m == Matrix<int>(8,8,2998));
+    }
+    for(int i=0;i<3000;i++) check(cache.save(Integer(i), Matrix<int>(8,8,i)));
+    check(cache.size() > 1000 && cache.get(Integer(2999), m) && m == Matrix<int>(8,8,2999));
+    sjtu::shared_lru<>::unlink(name.c_str());
+}
+
+int main(){
+#ifdef _OUTPUT_
+    freopen("27.out","w",stdout);
+#endif
+    local_tester();
+    process_tester();
+    recovery_tester();
+    memory_tester();
+    std::cout<<c[6];
+    if(Integer::counter == 0){
+        std::cout<<c[0]<<std::endl;
+    }
+    else{
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+    std::cout << c[5] << std::endl;
+}
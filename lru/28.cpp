@@ -0,0 +1,191 @@
+#include "cache-server.hpp"
+#if defined (_UNORDERED_MAP_)  || (defined (_LIST_)) || (defined (_MAP_)) || (defined (_SET_)) || (defined (_UNORDERED_SET_))||(defined (_GLIBCXX_MAP)) || (defined (_GLIBCXX_UNORDERED_MAP))
+BOOM :)
+#endif
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+// the lru served over unix domain sockets
+#define _OUTPUT_
+
+std::string c[]={
+    "   pass!",
+    "   error.",
+    "test: get, set and delete",
+    "test: pipelining",
+    "test: large values",
+    "test: eviction by bytes",
+    "test: bad requests",
+    "Congratulations. Your submission has passed all correctness tests. Good job! :)",
+    "test: memcheck",
+};
+
+std::string path = "/tmp/sjtu-test28-" + std::to_string(getpid());
+
+void check(bool ok){
+    if(!ok){
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+}
+
+std::string value_of(int i, size_t n){
+    std::string v(n, char('a' + i % 26));
+    if(n >= 4) v.replace(0, 4, std::to_string(i % 10000));
+    return v;
+}
+
+void basic_tester(){
+    std::cout<<c[2]<<std::endl;
+    sjtu::cache_server server(path, 3, 3 << 20);
+    sjtu::cache_client client(path, 3);
+    std::string v;
+    check(!client.get("absent", v) && !client.remove("absent"));
+    for(int i=0;i<100;i++) check(client.set("key" + std::to_string(i), value_of(i, i)));
+    for(int i=0;i<100;i++) check(client.get("key" + std::to_string(i), v) && v == value_of(i, i));
+    check(client.set("key7", "again") && client.get("key7", v) && v == "again");
+    check(client.remove("key7") && !client.get("key7", v) && !client.remove("key7"));
+    // an empty key and value are fine
+    check(client.set("", "") && client.get("", v) && v.empty());
+    // a second client sees the same entries
+    sjtu::cache_client other(path, 3);
+    check(other.get("key99", v) && v == value_of(99, 99));
+}
+
+void pipeline_tester(){
+    std::cout<<c[3]<<std::endl;
+    sjtu::cache_server server(path, 4, 8 << 20);
+    sjtu::cache_client client(path, 4);
+    // set, get and delete of many keys, all in flight at once
+    for(int i=0;i<5000;i++){
+        client.send_set(std::to_string(i), value_of(i, 20));
+        client.send_get(std::to_string(i));
+        if(i % 3 == 0) client.send_remove(std::to_string(i));
+        client.send_get(std::to_string(i));
+    }
+    check(client.in_flight() == 5000 * 3 + 1667);
+    for(int i=0;i<5000;i++){
+        check(client.receive().status == sjtu::cache_ok);
+        sjtu::cache_reply r = client.receive();
+        check(r.status == sjtu::cache_ok && r.value == value_of(i, 20));
+        if(i % 3 == 0) check(client.receive().status == sjtu::cache_ok);
+        r = client.receive();
+        check(i % 3 == 0 ? r.status == sjtu::cache_miss : r.value == value_of(i, 20));
+    }
+    check(client.in_flight() == 0);
+    bool thrown = false;
+    try{
+        client.receive();
+    }catch(const sjtu::runtime_error &){
+        thrown = true;
+    }
+    check(thrown);
+}
+
+void large_tester(){
+    std::cout<<c[4]<<std::endl;
+    sjtu::cache_server server(path, 2, 64 << 20);
+    sjtu::cache_client client(path, 2);
+    // far more than a socket buffer, each way
+    std::string big = value_of(5, 8 << 20), v;
+    check(client.set("big", big) && client.get("big", v) && v == big);
+    for(int i=0;i<4;i++) client.send_get("big");
+    // replaced while the replies may still be on their way
+    client.send_set("big", "small");
+    for(int i=0;i<4;i++) check(client.receive().value == big);
+    check(client.receive().status == sjtu::cache_ok && client.get("big", v) && v == "small");
+    // heavier than a whole shard
+    client.send_set("huge", std::string(40 << 20, 'x'));
+    check(client.receive().status == sjtu::cache_too_large && !client.get("huge", v));
+}
+
+void eviction_tester(){
+    std::cout<<c[5]<<std::endl;
+    sjtu::cache_server server(path, 1, 64 << 10);
+    sjtu::cache_client client(path, 1);
+    for(int i=0;i<2000;i++) client.send_set(std::to_string(i), value_of(i, 100));
+    for(int i=0;i<2000;i++) check(client.receive().status == sjtu::cache_ok);
+    std::string v;
+    check(!client.get("0", v) && client.get("1999", v) && v == value_of(1999, 100));
+    int kept = 0;
+    for(int i=0;i<2000;i++) kept += client.get(std::to_string(i), v);
+    check(kept > 100 && kept < 1000);
+}
+
+/**
+ * a raw connection to shard i
+*/
+int connect_to(size_t i){
+    std::string name = sjtu::cache_server::socket_path(path, i);
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, name.c_str(), name.size() + 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    check(fd >= 0 && connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0);
+    return fd;
+}
+
+void bad_tester(){
+    std::cout<<c[6]<<std::endl;
+    {
+        sjtu::cache_server server(path, 2, 1 << 20);
+        std::string key = "k";
+        while(sjtu::cache_shard_of(key, 2) != 1) key += "k";
+        // a get of a key of shard 1 sent to shard 0
+        int fd = connect_to(0);
+        char request[8] = {char(sjtu::cache_get), 0};
+        uint16_t length = uint16_t(key.size());
+        std::memcpy(request + 2, &length, 2);
+        check(write(fd, request, 8) == 8 && write(fd, key.data(), key.size()) == ssize_t(key.size()));
+        char reply[8];
+        check(read(fd, reply, 8) == 8 && reply[0] == char(sjtu::cache_wrong_shard));
+        // an unknown op closes the connection
+        request[0] = 9;
+        check(write(fd, request, 8) == 8 && read(fd, reply, 8) == 0);
+        close(fd);
+        // a client that left halfway through a request
+        fd = connect_to(1);
+        check(write(fd, request, 5) == 5);
+        close(fd);
+        sjtu::cache_client client(path, 2);
+        check(client.set(key, "fine"));
+        // a client of no shards at all
+        bool thrown = false;
+        try{
+            sjtu::cache_client none(path, 0);
+        }catch(const sjtu::runtime_error &){
+            thrown = true;
+        }
+        check(thrown);
+    }
+    // stopping removes the sockets
+    check(access(sjtu::cache_server::socket_path(path, 0).c_str(), F_OK) != 0);
+    bool thrown = false;
+    try{
+        sjtu::cache_client client(path, 2);
+    }catch(const sjtu::runtime_error &){
+        thrown = true;
+    }
+    check(thrown);
+}
+
+int main(){
+#ifdef _OUTPUT_
+    freopen("28.out","w",stdout);
+#endif
+    basic_tester();
+    pipeline_tester();
+    large_tester();
+    eviction_tester();
+    bad_tester();
+    std::cout<<c[8];
+    if(Integer::counter == 0){
+        std::cout<<c[0]<<std::endl;
+    }
+    else{
+        std::cout<<c[1]<<std::endl;
+        exit(0);
+    }
+    std::cout << c[7] << std::endl;
+}
@@ -0,0 +1,154 @@
+#ifndef SJTU_ALLOCATOR_HPP
+#define SJTU_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+namespace sjtu {
+
+/**
+ * size-class slab pool for container nodes.
+ * requests up to max_block bytes are rounded up to a multiple of
+ * granule and carved out of 64KB slabs; freed blocks go to the free
+ * list of their class and are handed out again before the slab is
+ * touched, so insert/remove churn never reaches malloc.
+ * larger requests are forwarded to the upstream resource.
+ * slabs are only returned by release() or the destructor.
+ * it is a std::pmr::memory_resource, so it also works behind
+ * std::pmr::polymorphic_allocator; pool_allocator skips the virtual call.
+ * not thread safe.
+*/
+class node_pool final : public std::pmr::memory_resource {
+public:
+	static const size_t granule = 16;
+	static const size_t classes = 32;
+	static const size_t max_block = granule * classes;
+	static const size_t slab_bytes = 64 * 1024;
+
+	explicit node_pool(std::pmr::memory_resource *up = std::pmr::new_delete_resource()): upstream(up) {}
+	node_pool(const node_pool &other) = delete;
+	node_pool & operator=(const node_pool &other) = delete;
+	~node_pool() {
+		release();
+	}
+
+	void *allocate_block(size_t bytes, size_t align) {
+		if (bytes > max_block || align > granule) {return upstream->allocate(bytes, align); }
+		size_t c = size_class(bytes);
+		if (free_list[c] != nullptr) {
+			free_block *block = free_list[c];
+			free_list[c] = block->next;
+			return block;
+		}
+		size_t block_bytes = (c + 1) * granule;
+		if (cursor[c] == nullptr || size_t(limit[c] - cursor[c]) < block_bytes) {refill(c); }
+		void *block = cursor[c];
+		cursor[c] += block_bytes;
+		return block;
+	}
+	void deallocate_block(void *p, size_t bytes, size_t align) {
+		if (p == nullptr) {return; }
+		if (bytes > max_block || align > granule) {
+			upstream->deallocate(p, bytes, align);
+			return;
+		}
+		size_t c = size_class(bytes);
+		free_block *block = static_cast<free_block *>(p);
+		block->next = free_list[c];
+		free_list[c] = block;
+	}
+	/**
+	 * give every slab back to upstream; all blocks become invalid
+	*/
+	void release() {
+		while (slabs != nullptr) {
+			slab *nxt = slabs->next;
+			upstream->deallocate(slabs, slab_bytes, granule);
+			slabs = nxt;
+		}
+		for (size_t c = 0; c < classes; ++c) {
+			free_list[c] = nullptr;
+			cursor[c] = limit[c] = nullptr;
+		}
+		slab_count = 0;
+	}
+	size_t slabs_in_use() const {
+		return slab_count;
+	}
+
+private:
+	struct free_block {free_block *next; };
+	struct alignas(granule) slab {slab *next; };
+
+	std::pmr::memory_resource *upstream;
+	free_block *free_list[classes] = {};
+	char *cursor[classes] = {}, *limit[classes] = {};  // bump region of each class
+	slab *slabs = nullptr;
+	size_t slab_count = 0;
+
+	static size_t size_class(size_t bytes) {
+		return bytes == 0 ? 0 : (bytes - 1) / granule;
+	}
+	void refill(size_t c) {
+		slab *s = static_cast<slab *>(upstream->allocate(slab_bytes, granule));
+		s->next = slabs;
+		slabs = s;
+		++slab_count;
+		cursor[c] = reinterpret_cast<char *>(s) + sizeof(slab);
+		limit[c] = reinterpret_cast<char *>(s) + slab_bytes;
+	}
+
+	void *do_allocate(size_t bytes, size_t align) override {
+		return allocate_block(bytes, align);
+	}
+	void do_deallocate(void *p, size_t bytes, size_t align) override {
+		deallocate_block(p, bytes, align);
+	}
+	bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+		return this == &other;
+	}
+};
+
+/**
+ * the pool used by default-constructed pool_allocators, one for the
+ * whole process: use it from one thread only (concurrent_lru gives
+ * each shard a pool of its own instead)
+*/
+inline node_pool &default_node_pool() {
+	static node_pool pool;
+	return pool;
+}
+
+/**
+ * allocator over a node_pool, for the Alloc parameter of the containers
+*/
+template<class T> class pool_allocator {
+public:
+	using value_type = T;
+	node_pool *pool;
+
+	pool_allocator() noexcept: pool(&default_node_pool()) {}
+	pool_allocator(node_pool &p) noexcept: pool(&p) {}
+	template<class U>
+	pool_allocator(const pool_allocator<U> &other) noexcept: pool(other.pool) {}
+
+	T *allocate(size_t n) {
+		return static_cast<T *>(pool->allocate_block(n * sizeof(T), alignof(T)));
+	}
+	void deallocate(T *p, size_t n) {
+		pool->deallocate_block(p, n * sizeof(T), alignof(T));
+	}
+	template<class U>
+	bool operator==(const pool_allocator<U> &rhs) const {
+		return pool == rhs.pool;
+	}
+	template<class U>
+	bool operator!=(const pool_allocator<U> &rhs) const {
+		return pool != rhs.pool;
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,564 @@
+#ifndef SJTU_CACHE_SERVER_HPP
+#define SJTU_CACHE_SERVER_HPP
+
+#include "lru.hpp"
+#include <cerrno>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace sjtu {
+
+/**
+ * a memcached-like cache of byte strings over Unix domain sockets.
+ * cache_server runs one shard per core: a thread pinned to the core,
+ * with its own basic_lru (a byte budget), socket "path.i" and epoll
+ * loop, sharing nothing with the others.  clients send every key to
+ * its shard, cache_shard_of(key, shards), as cache_client does.
+ * on a connection any number of requests may be in flight (pipelining);
+ * they are answered in order.  numbers are in native byte order:
+ *   request  op (1 byte, cache_op), 0, key length (2 bytes), value
+ *            length (4 bytes, 0 unless set), key, value
+ *   reply    status (1 byte, cache_status), 0, 0, 0, value length
+ *            (4 bytes), value (the hits of get only)
+ * a request the server cannot parse closes the connection.
+ * values are kept as shared buffers, and replies are written with
+ * writev straight from them (a value replaced or evicted meanwhile
+ * stays alive until its reply is out).
+*/
+
+enum cache_op : uint8_t{
+	cache_get = 1,
+	cache_set = 2,
+	cache_delete = 3,
+};
+enum cache_status : uint8_t{
+	cache_ok = 0,
+	cache_miss = 1,  // get or delete of an absent key
+	cache_too_large = 2,  // set of an entry heavier than the shard
+	cache_wrong_shard = 3,  // the key belongs to another shard
+};
+
+const size_t cache_max_key = 65535;
+const size_t cache_max_value = size_t(64) << 20;
+
+/**
+ * the shard of a key: fnv-1a of its bytes, so every client agrees
+*/
+inline size_t cache_shard_of(const char *key, size_t n, size_t shards) {
+	uint64_t h = 14695981039346656037ull;
+	for (size_t i = 0; i < n; ++i) {
+		h ^= (unsigned char)key[i];
+		h *= 1099511628211ull;
+	}
+	return size_t(h % shards);
+}
+inline size_t cache_shard_of(const std::string &key, size_t shards) {
+	return cache_shard_of(key.data(), key.size(), shards);
+}
+
+template<> struct heap_size<std::string>{
+	size_t operator()(const std::string &s) const {return s.capacity() > 15 ? s.capacity() + 1 : 0; }
+};
+template<> struct heap_size<std::shared_ptr<const std::string> >{
+	size_t operator()(const std::shared_ptr<const std::string> &p) const {
+		// the control block with the string in it, and the buffer
+		return p ? 2 * sizeof(void *) + sizeof(std::string) + heap_size<std::string>()(*p) : 0;
+	}
+};
+
+class cache_server{
+public:
+	using value_ref = std::shared_ptr<const std::string>;
+	using table = basic_lru<std::string, value_ref, std::hash<std::string>, std::equal_to<std::string>,
+		std::allocator<pair<const std::string, value_ref> >, pow2_hash_policy, lru_eviction, byte_weigher>;
+
+	/**
+	 * listen on path.0 .. path.(shards - 1), replacing stale sockets,
+	 * with `bytes` split evenly over the shards, and start serving.
+	 * throws runtime_error if a socket cannot be made
+	*/
+	explicit cache_server(const std::string &path, size_t shards = std::thread::hardware_concurrency(),
+		size_t bytes = size_t(64) << 20) {
+		if (shards == 0) {shards = 1; }
+		for (size_t i = 0; i < shards; ++i) {
+			parts.emplace_back(new shard(socket_path(path, i), i, shards, bytes / shards));
+		}
+		unsigned cores = std::thread::hardware_concurrency();
+		for (size_t i = 0; i < shards; ++i) {
+			threads.emplace_back([this, i] {parts[i]->run(); });
+			if (cores == 0) {continue; }
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(i % cores, &set);
+			::pthread_setaffinity_np(threads.back().native_handle(), sizeof(set), &set);
+		}
+	}
+	cache_server(const cache_server &other) = delete;
+	cache_server & operator=(const cache_server &other) = delete;
+	~cache_server() {
+		stop();
+	}
+	/**
+	 * stop every shard and wait for it; connections are closed and the
+	 * sockets removed
+	*/
+	void stop() {
+		for (auto &p: parts) {p->wake(); }
+		for (auto &t: threads) {t.join(); }
+		threads.clear();
+		parts.clear();
+	}
+	size_t shards() const {
+		return parts.size();
+	}
+	static std::string socket_path(const std::string &path, size_t i) {
+		return path + "." + std::to_string(i);
+	}
+
+private:
+	struct reply{
+		char head[8];
+		value_ref value;
+		size_t sent;  // bytes of head and value written so far
+
+		size_t size() const {
+			return 8 + (value ? value->size() : 0);
+		}
+	};
+	struct connection{
+		int fd;
+		size_t slot;  // in shard::conns
+		std::vector<char> in;
+		size_t begin = 0, end = 0;  // bytes read but not handled yet
+		std::deque<reply> out;
+		size_t pending = 0;  // bytes of out not written yet
+		uint32_t events = EPOLLIN;
+	};
+
+	/**
+	 * one core's share: requests of a connection are handled as soon as
+	 * they are read, their replies queued and written by writev when a
+	 * read has been handled; while more than maxPending bytes of replies
+	 * wait for a slow reader, its requests are left unread
+	*/
+	class shard{
+	public:
+		static const size_t maxPending = size_t(4) << 20;
+
+		shard(const std::string &path, size_t index, size_t count, size_t bytes)
+			: path(path), index(index), count(count), cache(bytes) {
+			sockaddr_un addr = {};
+			addr.sun_family = AF_UNIX;
+			if (path.size() >= sizeof(addr.sun_path)) {throw runtime_error(); }
+			std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+			listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+			loop = ::epoll_create1(EPOLL_CLOEXEC);
+			waker = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			::unlink(path.c_str());
+			if (listener < 0 || loop < 0 || waker < 0 || ::bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0
+				|| ::listen(listener, SOMAXCONN) != 0 || !watch(listener, EPOLL_CTL_ADD, EPOLLIN, &listener)
+				|| !watch(waker, EPOLL_CTL_ADD, EPOLLIN, &waker)) {
+				close_all();
+				throw runtime_error();
+			}
+		}
+		shard(const shard &other) = delete;
+		~shard() {
+			for (auto &c: conns) {::close(c->fd); }
+			close_all();
+		}
+
+		void wake() {
+			uint64_t one = 1;
+			if (::write(waker, &one, sizeof(one)) < 0) {return; }
+		}
+		void run() {
+			epoll_event events[64];
+			for (;;) {
+				int n = ::epoll_wait(loop, events, 64, -1);
+				if (n < 0 && errno == EINTR) {continue; }
+				if (n < 0) {return; }
+				for (int i = 0; i < n; ++i) {
+					void *tag = events[i].data.ptr;
+					if (tag == &waker) {return; }
+					if (tag == &listener) {
+						accept_all();
+						continue;
+					}
+					connection *c = static_cast<connection *>(tag);
+					bool ok = true;
+					if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {ok = receive(*c); }
+					if (ok && (events[i].events & EPOLLOUT)) {ok = serve(*c); }
+					if (!ok) {drop(*c); }
+				}
+			}
+		}
+
+	private:
+		std::string path;
+		size_t index, count;
+		table cache;
+		int listener = -1, loop = -1, waker = -1;
+		std::vector<std::unique_ptr<connection> > conns;
+
+		void close_all() {
+			if (listener >= 0) {
+				::close(listener);
+				::unlink(path.c_str());
+			}
+			if (loop >= 0) {::close(loop); }
+			if (waker >= 0) {::close(waker); }
+		}
+		bool watch(int fd, int op, uint32_t events, void *tag) {
+			epoll_event ev = {};
+			ev.events = events;
+			ev.data.ptr = tag;
+			return ::epoll_ctl(loop, op, fd, &ev) == 0;
+		}
+		void accept_all() {
+			for (;;) {
+				int fd = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+				if (fd < 0) {return; }
+				std::unique_ptr<connection> c(new connection);
+				c->fd = fd;
+				c->slot = conns.size();
+				c->in.resize(64 << 10);
+				if (!watch(fd, EPOLL_CTL_ADD, EPOLLIN, c.get())) {
+					::close(fd);
+					continue;
+				}
+				conns.push_back(std::move(c));
+			}
+		}
+		void drop(connection &c) {
+			::epoll_ctl(loop, EPOLL_CTL_DEL, c.fd, nullptr);
+			::close(c.fd);
+			size_t slot = c.slot;
+			std::swap(conns[slot], conns.back());
+			conns[slot]->slot = slot;
+			conns.pop_back();
+		}
+
+		/**
+		 * read what the socket has, then serve; false to close
+		*/
+		bool receive(connection &c) {
+			if (c.end == c.in.size()) {make_room(c, c.begin != 0 ? 0 : c.in.size() * 2); }
+			ssize_t r = ::read(c.fd, c.in.data() + c.end, c.in.size() - c.end);
+			if (r == 0) {return false; }
+			if (r < 0) {return errno == EAGAIN || errno == EINTR; }
+			c.end += size_t(r);
+			return serve(c);
+		}
+		/**
+		 * move the unhandled bytes to the front, and grow the buffer to
+		 * hold at least n of them
+		*/
+		static void make_room(connection &c, size_t n) {
+			std::memmove(c.in.data(), c.in.data() + c.begin, c.end - c.begin);
+			c.end -= c.begin;
+			c.begin = 0;
+			if (c.in.size() < n) {c.in.resize(n); }
+		}
+		/**
+		 * handle the complete requests read so far and write replies
+		 * until the socket is full; false to close
+		*/
+		bool serve(connection &c) {
+			for (;;) {
+				bool more = false;
+				while (c.end - c.begin >= 8 && !(more = c.pending > maxPending)) {
+					const char *at = c.in.data() + c.begin;
+					uint8_t op = uint8_t(at[0]);
+					uint16_t keyLength;
+					uint32_t valueLength;
+					std::memcpy(&keyLength, at + 2, 2);
+					std::memcpy(&valueLength, at + 4, 4);
+					if (op < cache_get || op > cache_delete || at[1] != 0 || valueLength > cache_max_value
+						|| (op != cache_set && valueLength != 0)) {return false; }
+					size_t need = 8 + size_t(keyLength) + valueLength;
+					if (c.end - c.begin < need) {
+						if (c.in.size() < need) {make_room(c, need); }
+						break;
+					}
+					handle(c, op, at + 8, keyLength, at + 8 + keyLength, valueLength);
+					c.begin += need;
+				}
+				if (c.begin == c.end) {c.begin = c.end = 0; }
+				if (!flush(c)) {return false; }
+				if (!more || c.pending > maxPending) {break; }
+			}
+			uint32_t events = (c.pending > maxPending ? 0u : uint32_t(EPOLLIN)) | (c.out.empty() ? 0u : uint32_t(EPOLLOUT));
+			if (events != c.events) {
+				c.events = events;
+				if (!watch(c.fd, EPOLL_CTL_MOD, events, &c)) {return false; }
+			}
+			return true;
+		}
+		void handle(connection &c, uint8_t op, const char *key, size_t keyLength, const char *value, size_t valueLength) {
+			if (cache_shard_of(key, keyLength, count) != index) {
+				answer(c, cache_wrong_shard, nullptr);
+				return;
+			}
+			std::string k(key, keyLength);
+			if (op == cache_get) {
+				value_ref *v = cache.get(k);
+				answer(c, v != nullptr ? cache_ok : cache_miss, v != nullptr ? *v : nullptr);
+			} else if (op == cache_set) {
+				value_ref v = std::make_shared<const std::string>(value, valueLength);
+				bool saved = cache.save(pair<const std::string, value_ref>(std::move(k), std::move(v)));
+				answer(c, saved ? cache_ok : cache_too_large, nullptr);
+			} else {
+				answer(c, cache.remove(k) ? cache_ok : cache_miss, nullptr);
+			}
+		}
+		static void answer(connection &c, cache_status status, const value_ref &value) {
+			c.out.emplace_back();
+			reply &r = c.out.back();
+			uint32_t length = value ? uint32_t(value->size()) : 0;
+			std::memset(r.head, 0, 4);
+			r.head[0] = char(status);
+			std::memcpy(r.head + 4, &length, 4);
+			r.value = value;
+			r.sent = 0;
+			c.pending += r.size();
+		}
+		/**
+		 * writev the queued replies, headers and values in place, until
+		 * they are out or the socket is full; false on an error
+		*/
+		static bool flush(connection &c) {
+			while (!c.out.empty()) {
+				iovec iov[64];
+				int n = 0;
+				for (auto it = c.out.begin(); it != c.out.end() && n + 2 <= 64; ++it) {
+					size_t sent = it->sent;
+					if (sent < 8) {
+						iov[n].iov_base = it->head + sent;
+						iov[n++].iov_len = 8 - sent;
+						sent = 8;
+					}
+					size_t length = it->size();
+					if (sent < length) {
+						iov[n].iov_base = const_cast<char *>(it->value->data()) + (sent - 8);
+						iov[n++].iov_len = length - sent;
+					}
+				}
+				ssize_t w = ::writev(c.fd, iov, n);
+				if (w < 0 && errno == EINTR) {continue; }
+				if (w < 0) {return errno == EAGAIN; }
+				size_t written = size_t(w);
+				c.pending -= written;
+				while (written != 0) {
+					reply &r = c.out.front();
+					size_t left = r.size() - r.sent;
+					if (written < left) {
+						r.sent += written;
+						break;
+					}
+					written -= left;
+					c.out.pop_front();
+				}
+			}
+			return true;
+		}
+	};
+
+	std::vector<std::unique_ptr<shard> > parts;
+	std::vector<std::thread> threads;
+};
+
+struct cache_reply{
+	cache_status status;
+	std::string value;
+};
+
+/**
+ * a connection to each shard of a cache_server.  send_*() only queue
+ * a request; receive() sends what is queued and returns the reply to
+ * the oldest request in flight, so a caller may pipeline any number.
+ * get / set / remove do one request at a time.
+ * not for several threads at once (use a client per thread)
+*/
+class cache_client{
+public:
+	/**
+	 * throws runtime_error if a shard cannot be reached, or for 0 shards
+	*/
+	cache_client(const std::string &path, size_t shards): links(shards) {
+		if (shards == 0) {throw runtime_error(); }
+		for (size_t i = 0; i < shards; ++i) {
+			std::string name = cache_server::socket_path(path, i);
+			sockaddr_un addr = {};
+			addr.sun_family = AF_UNIX;
+			int fd = -1;
+			if (name.size() < sizeof(addr.sun_path)) {
+				std::memcpy(addr.sun_path, name.c_str(), name.size() + 1);
+				fd = links[i].fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+			}
+			if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0
+				|| ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK) != 0) {
+				close_all();
+				throw runtime_error();
+			}
+		}
+	}
+	cache_client(const cache_client &other) = delete;
+	cache_client & operator=(const cache_client &other) = delete;
+	~cache_client() {
+		close_all();
+	}
+
+	void send_get(const std::string &key) {
+		queue(cache_get, key, nullptr, 0);
+	}
+	void send_set(const std::string &key, const std::string &value) {
+		queue(cache_set, key, value.data(), value.size());
+	}
+	void send_remove(const std::string &key) {
+		queue(cache_delete, key, nullptr, 0);
+	}
+	/**
+	 * requests sent or queued whose reply has not been received
+	*/
+	size_t in_flight() const {
+		return order.size();
+	}
+	/**
+	 * throws runtime_error if nothing is in flight or a server went away
+	*/
+	cache_reply receive() {
+		if (order.empty()) {throw runtime_error(); }
+		link &l = links[order.front()];
+		cache_reply r;
+		while (!parse(l, r)) {wait(); }
+		order.pop_front();
+		--l.waiting;
+		return r;
+	}
+	/**
+	 * the value of key, false if it is absent
+	*/
+	bool get(const std::string &key, std::string &value) {
+		send_get(key);
+		cache_reply r = receive();
+		if (r.status != cache_ok) {return false; }
+		value = std::move(r.value);
+		return true;
+	}
+	bool set(const std::string &key, const std::string &value) {
+		send_set(key, value);
+		return receive().status == cache_ok;
+	}
+	/**
+	 * false if key was absent
+	*/
+	bool remove(const std::string &key) {
+		send_remove(key);
+		return receive().status == cache_ok;
+	}
+
+private:
+	struct link{
+		int fd = -1;
+		std::string out;
+		size_t sent = 0;
+		std::string in;
+		size_t begin = 0;
+		size_t waiting = 0;  // requests in flight
+	};
+	std::vector<link> links;
+	std::deque<uint32_t> order;  // the shard of each request in flight, oldest first
+
+	void close_all() {
+		for (auto &l: links) {
+			if (l.fd >= 0) {::close(l.fd); }
+		}
+	}
+
+	void queue(cache_op op, const std::string &key, const char *value, size_t length) {
+		if (key.size() > cache_max_key || length > cache_max_value) {throw runtime_error(); }
+		size_t s = cache_shard_of(key, links.size());
+		link &l = links[s];
+		char head[8] = {char(op), 0};
+		uint16_t keyLength = uint16_t(key.size());
+		uint32_t valueLength = uint32_t(length);
+		std::memcpy(head + 2, &keyLength, 2);
+		std::memcpy(head + 4, &valueLength, 4);
+		l.out.append(head, 8);
+		l.out.append(key);
+		if (length != 0) {l.out.append(value, length); }
+		++l.waiting;
+		order.push_back(uint32_t(s));
+	}
+	/**
+	 * take the next reply out of l.in if it is all there
+	*/
+	static bool parse(link &l, cache_reply &r) {
+		if (l.in.size() - l.begin < 8) {return false; }
+		uint32_t length;
+		std::memcpy(&length, l.in.data() + l.begin + 4, 4);
+		if (l.in.size() - l.begin < 8 + size_t(length)) {return false; }
+		r.status = cache_status(l.in[l.begin]);
+		r.value.assign(l.in, l.begin + 8, length);
+		l.begin += 8 + size_t(length);
+		if (l.begin == l.in.size() || (l.begin > (64 << 10) && l.begin * 2 > l.in.size())) {
+			l.in.erase(0, l.begin);
+			l.begin = 0;
+		}
+		return true;
+	}
+	/**
+	 * block until some link can take output or has replies, and move
+	 * what it can; every link is served so that no server is left
+	 * waiting for its replies to be read
+	*/
+	void wait() {
+		std::vector<pollfd> fds(links.size());
+		for (size_t i = 0; i < links.size(); ++i) {
+			fds[i].fd = links[i].fd;
+			fds[i].events = short((links[i].sent < links[i].out.size() ? POLLOUT : 0) | (links[i].waiting != 0 ? POLLIN : 0));
+			if (fds[i].events == 0) {fds[i].fd = -1; }
+		}
+		if (::poll(fds.data(), fds.size(), -1) < 0) {
+			if (errno == EINTR) {return; }
+			throw runtime_error();
+		}
+		for (size_t i = 0; i < links.size(); ++i) {
+			link &l = links[i];
+			if (fds[i].revents & POLLOUT) {
+				ssize_t w = ::write(l.fd, l.out.data() + l.sent, l.out.size() - l.sent);
+				if (w < 0 && errno != EAGAIN && errno != EINTR) {throw runtime_error(); }
+				if (w > 0) {l.sent += size_t(w); }
+				if (l.sent == l.out.size()) {
+					l.out.clear();
+					l.sent = 0;
+				}
+			}
+			if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+				char buffer[64 << 10];
+				ssize_t r = ::read(l.fd, buffer, sizeof(buffer));
+				if (r == 0 || (r < 0 && errno != EAGAIN && errno != EINTR)) {throw runtime_error(); }
+				if (r > 0) {l.in.append(buffer, size_t(r)); }
+			}
+		}
+	}
+};
+
+}
+
+#endif
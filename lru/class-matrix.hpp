@@ -39,7 +39,10 @@ public:
     Matrix(const Matrix<_Td> &mat)
         : n_rows(mat.n_rows), n_cols(mat.n_cols), data(mat.data) {}
     Matrix(Matrix<_Td> &&mat) noexcept
-        : n_rows(mat.n_rows), n_cols(mat.n_cols), data(mat.data) {}
+        : n_rows(mat.n_rows), n_cols(mat.n_cols), data(std::move(mat.data))
+    {
+        mat.n_rows = mat.n_cols = 0;
+    }
     Matrix<_Td> & operator=(const Matrix<_Td> &rhs)
     {
         this->n_rows = rhs.n_rows;
@@ -47,11 +50,12 @@ public:
         this->data = rhs.data;
         return *this;
     }
-    Matrix<_Td> & operator=(Matrix<_Td> &&rhs)
+    Matrix<_Td> & operator=(Matrix<_Td> &&rhs) noexcept
     {
         this->n_rows = rhs.n_rows;
         this->n_cols = rhs.n_cols;
-        this->data = rhs.data;
+        this->data = std::move(rhs.data);
+        rhs.n_rows = rhs.n_cols = 0;
         return *this;
     }
     inline const size_t & RowSize() const
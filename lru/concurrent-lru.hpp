@@ -0,0 +1,372 @@
+#ifndef SJTU_CONCURRENT_LRU_HPP
+#define SJTU_CONCURRENT_LRU_HPP
+
+#include "lru.hpp"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+namespace sjtu {
+
+/**
+ * lossy striped buffer of recency promotions (the read buffer of
+ * Caffeine): readers append the node they hit without taking any
+ * lock, the owner applies the whole batch later under its write lock.
+ * each stripe is a ring of `ring` slots with a claim counter (tail,
+ * bumped by CAS) and a drain counter (head); a reader picks the
+ * stripe of its thread, so readers rarely share a counter.
+ * when a stripe is full the promotion is dropped and counted; that
+ * only makes the recency order a little less exact.
+ * record() must not overlap drain(): the owner appends under a shared
+ * lock and drains under the exclusive one.
+*/
+template<class Node> class read_buffer{
+public:
+	static const size_t stripes = 4;
+	static const size_t ring = 16;
+
+	read_buffer() {
+		for (auto &s: stripe) {
+			for (auto &slot: s.slots) {slot.store(nullptr, std::memory_order_relaxed); }
+		}
+	}
+	read_buffer(const read_buffer &other) = delete;
+	read_buffer & operator=(const read_buffer &other) = delete;
+
+	/**
+	 * append a promotion; return how many are now pending in the
+	 * stripe used (ring if it was full and the promotion got dropped)
+	*/
+	size_t record(Node *node) {
+		lane &s = stripe[thread_stripe()];
+		size_t t = s.tail.load(std::memory_order_relaxed);
+		while (true) {
+			size_t h = s.head.load(std::memory_order_acquire);
+			if (t - h >= ring) {
+				dropped.fetch_add(1, std::memory_order_relaxed);
+				return ring;
+			}
+			if (s.tail.compare_exchange_weak(t, t + 1, std::memory_order_relaxed)) {
+				s.slots[t % ring].store(node, std::memory_order_release);
+				return t + 1 - h;
+			}
+		}
+	}
+	/**
+	 * hand every pending promotion to apply(node), oldest first in
+	 * each stripe; return how many there were
+	*/
+	template<class F>
+	size_t drain(F &&apply) {
+		size_t total = 0;
+		for (auto &s: stripe) {
+			size_t h = s.head.load(std::memory_order_relaxed);
+			size_t t = s.tail.load(std::memory_order_acquire);
+			for (; h != t; ++h) {
+				Node *node = s.slots[h % ring].exchange(nullptr, std::memory_order_acquire);
+				if (node != nullptr) {
+					apply(node);
+					++total;
+				}
+			}
+			s.head.store(h, std::memory_order_release);
+		}
+		applied += total;
+		if (total > 0) {++drains; }
+		return total;
+	}
+
+	std::atomic<size_t> dropped{0};  // promotions lost to a full stripe
+	size_t applied = 0, drains = 0;  // only touched by drain()
+
+private:
+	struct alignas(64) lane{
+		std::atomic<size_t> head{0}, tail{0};
+		std::atomic<Node *> slots[ring];
+	};
+	lane stripe[stripes];
+
+	static size_t thread_stripe() {
+		static thread_local size_t id = std::hash<std::thread::id>()(std::this_thread::get_id()) % stripes;
+		return id;
+	}
+};
+
+/**
+ * counters of the read buffers, summed over the shards
+*/
+struct read_buffer_stats{
+	size_t applied = 0;  // promotions moved into the recency lists
+	size_t dropped = 0;  // promotions lost because a stripe was full
+	size_t drains = 0;  // batches applied
+};
+
+/**
+ * what a shard allocates with: a copy of Alloc, except that a
+ * pool_allocator gets a node_pool of the shard's own, as a node_pool
+ * is not thread safe and shards under different locks cannot share one
+*/
+template<class Alloc> struct shard_memory{
+	explicit shard_memory(const Alloc &a): alloc(a) {}
+	Alloc alloc;
+};
+template<class U> struct shard_memory<pool_allocator<U> >{
+	explicit shard_memory(const pool_allocator<U> &): alloc(pool) {}
+	node_pool pool;
+	pool_allocator<U> alloc;
+};
+
+/**
+ * thread-safe lru made of independent shards.
+ * every key belongs to exactly one shard (picked from the high bits of
+ * its mixed hash, so the choice is independent of the bucket inside
+ * the shard); a shard is a basic_lru with its own lock and
+ * capacity / shards entries, so get/save lock one shard only and
+ * threads working on different shards never meet.
+ * recency is per shard: the entry evicted is the least recently used
+ * of its shard, not necessarily of the whole cache.
+ *
+ * get only takes the shard lock shared: the hit is recorded in the
+ * read buffer of the shard (or straight on the node, for eviction
+ * modes with shared_hits such as CLOCK), and once a stripe holds
+ * drain_threshold() promotions the reader tries the exclusive lock
+ * and applies the batch; if the lock is busy it just goes on, the
+ * next writer drains anyway.  writers drain before they change the
+ * shard, so the buffer never points at an evicted node.
+ * values are handed out by copy (or visited under the lock), since a
+ * pointer into a shard would outlive the lock.
+ * with a pool_allocator every shard has a node_pool of its own (see
+ * shard_memory); the pool of alloc is not used.
+*/
+template<
+	class Key = Integer,
+	class T = Matrix<int>,
+	class Hash = ::Hash,
+	class Equal = ::Equal,
+	class Alloc = std::allocator<pair<const Key, T> >,
+	class Policy = pow2_hash_policy,
+	template<class> class Eviction = lru_eviction,
+	template<class> class Weigher = unit_weigher,
+	class Expiry = no_expiry
+> class concurrent_lru{
+public:
+	using value_type = pair<const Key, T>;
+	using shard_type = basic_lru<Key, T, Hash, Equal, Alloc, Policy, Eviction, Weigher, Expiry>;
+
+	/**
+	 * capacity is split evenly (rounded up) over `shards` shards
+	*/
+	explicit concurrent_lru(size_t capacity, size_t shards = 16, const Alloc &alloc = Alloc()) {
+		if (shards == 0) {shards = 1; }
+		perShard = (capacity + shards - 1) / shards;
+		for (size_t i = 0; i < shards; ++i) {
+			table.emplace_back(new shard(perShard, alloc));
+		}
+	}
+	concurrent_lru(const concurrent_lru &other) = delete;
+	concurrent_lru & operator=(const concurrent_lru &other) = delete;
+
+	/**
+	 * copy the value into out and mark it as used;
+	 * return false (out untouched) if the key is absent
+	*/
+	bool get(const Key &key, T &out) {
+		shard &s = shard_of(key);
+		size_t pending = 0;
+		{
+			std::shared_lock<std::shared_mutex> guard(s.lock);
+			node_type *node = s.cache.lookup(key);
+			if (node == nullptr) {
+				s.misses.add_shared();
+				return false;
+			}
+			s.hits.add_shared();
+			out = node->item.second;
+			if (shard_type::shared_hits) {
+				s.cache.touch(node);
+			} else {
+				pending = s.reads.record(node);
+			}
+		}
+		if (pending >= drainAt.load(std::memory_order_relaxed) && s.lock.try_lock()) {
+			drain(s);
+			s.lock.unlock();
+		}
+		return true;
+	}
+	/**
+	 * call f(T &) on the value under the exclusive shard lock;
+	 * return false if the key is absent
+	*/
+	template<class F>
+	bool visit(const Key &key, F &&f) {
+		shard &s = shard_of(key);
+		std::lock_guard<std::shared_mutex> guard(s.lock);
+		drain(s);
+		T *value = s.cache.get(key);
+		if (value == nullptr) {return false; }
+		f(*value);
+		return true;
+	}
+	bool save(const value_type &v) {
+		shard &s = shard_of(v.first);
+		std::lock_guard<std::shared_mutex> guard(s.lock);
+		drain(s);
+		return s.cache.save(v);
+	}
+	bool save(value_type &&v) {
+		shard &s = shard_of(v.first);
+		std::lock_guard<std::shared_mutex> guard(s.lock);
+		drain(s);
+		return s.cache.save(std::move(v));
+	}
+	template<class K, class... Args>
+	bool emplace(K &&key, Args &&... args) {
+		shard &s = shard_of(key);
+		std::lock_guard<std::shared_mutex> guard(s.lock);
+		drain(s);
+		return s.cache.emplace(std::forward<K>(key), std::forward<Args>(args)...);
+	}
+
+	/**
+	 * sum over the shards; only a snapshot while others are writing
+	*/
+	size_t size() const {
+		size_t total = 0;
+		for (auto &s: table) {
+			std::shared_lock<std::shared_mutex> guard(s->lock);
+			total += s->cache.size();
+		}
+		return total;
+	}
+	size_t weight() const {
+		size_t total = 0;
+		for (auto &s: table) {
+			std::shared_lock<std::shared_mutex> guard(s->lock);
+			total += s->cache.weight();
+		}
+		return total;
+	}
+	size_t shard_count() const {
+		return table.size();
+	}
+	size_t shard_capacity() const {
+		return perShard;
+	}
+	/**
+	 * pending promotions in a stripe that make a reader try to drain,
+	 * 1 (every hit) .. read_buffer::ring (only full stripes)
+	*/
+	size_t drain_threshold() const {
+		return drainAt.load(std::memory_order_relaxed);
+	}
+	void drain_threshold(size_t n) {
+		if (n < 1) {n = 1; }
+		if (n > buffer_type::ring) {n = buffer_type::ring; }
+		drainAt.store(n, std::memory_order_relaxed);
+	}
+	/**
+	 * apply every buffered promotion now
+	*/
+	void flush() {
+		for (auto &s: table) {
+			std::lock_guard<std::shared_mutex> guard(s->lock);
+			drain(*s);
+		}
+	}
+	read_buffer_stats read_stats() const {
+		read_buffer_stats total;
+		for (auto &s: table) {
+			std::lock_guard<std::shared_mutex> guard(s->lock);
+			total.applied += s->reads.applied;
+			total.dropped += s->reads.dropped.load(std::memory_order_relaxed);
+			total.drains += s->reads.drains;
+		}
+		return total;
+	}
+	/**
+	 * counters and tables summed over the shards (see basic_lru::stats)
+	*/
+	lru_stats stats() const {
+		lru_stats total;
+		for (auto &s: table) {
+			std::lock_guard<std::shared_mutex> guard(s->lock);
+			lru_stats st = s->cache.stats();
+			st.hits += s->hits.get();
+			st.misses += s->misses.get();
+			total += st;
+		}
+		return total;
+	}
+	/**
+	 * remove the dead entries of every shard; return how many
+	*/
+	size_t cleanup() {
+		size_t dead = 0;
+		for (auto &s: table) {
+			std::lock_guard<std::shared_mutex> guard(s->lock);
+			drain(*s);
+			dead += s->cache.cleanup();
+		}
+		return dead;
+	}
+	/**
+	 * table setup, applied to every shard
+	*/
+	void incremental_rehash(bool on) {
+		for (auto &s: table) {
+			std::lock_guard<std::shared_mutex> guard(s->lock);
+			s->cache.incremental_rehash(on);
+		}
+	}
+	void reserve_capacity() {
+		for (auto &s: table) {
+			std::lock_guard<std::shared_mutex> guard(s->lock);
+			s->cache.reserve(perShard);
+		}
+	}
+	/**
+	 * shard by shard, each in lru order
+	*/
+	void print() {
+		for (auto &s: table) {
+			std::lock_guard<std::shared_mutex> guard(s->lock);
+			drain(*s);
+			s->cache.print();
+		}
+	}
+
+private:
+	using node_type = typename shard_type::node_type;
+	using buffer_type = read_buffer<node_type>;
+	// one cache line at least, so neighbouring locks do not false-share
+	struct alignas(64) shard{
+		mutable std::shared_mutex lock;
+		shard_memory<Alloc> memory;  // before cache, which allocates from it
+		shard_type cache;
+		buffer_type reads;
+		stat_counter hits, misses;  // of get(), bumped under the shared lock
+		shard(size_t capacity, const Alloc &alloc): memory(alloc), cache(capacity, memory.alloc) {}
+	};
+	std::vector<std::unique_ptr<shard> > table;
+	size_t perShard;
+	std::atomic<size_t> drainAt{buffer_type::ring};
+
+	shard &shard_of(const Key &key) {
+		size_t h = pow2_hash_policy::mix(Hash()(key));
+		return *table[size_t(((unsigned __int128)h * table.size()) >> 64)];
+	}
+	/**
+	 * exclusive lock held
+	*/
+	void drain(shard &s) {
+		s.reads.drain([&](node_type *node) {s.cache.touch(node); });
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,497 @@
+#ifndef SJTU_EVICTION_HPP
+#define SJTU_EVICTION_HPP
+
+#include "lru.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace sjtu {
+
+/**
+ * more eviction modes for basic_lru (see lru_eviction in lru.hpp for
+ * the interface).  they all keep the entries in the one list of the
+ * linked_hashmap; a segmented mode splits that list in two at
+ * `boundary` (first node of the back segment, nullptr if it is
+ * empty) and tells the segments apart by the node's mark.
+ * segment limits are fractions of the current entry count, so they
+ * also hold when the capacity is a weight.
+ *
+ * fifo_eviction   insertion order, a hit changes nothing
+ * slru_eviction   segmented lru: new entries go to probation (front),
+ *                 a hit there promotes to protected (back, 80%);
+ *                 protected overflow is demoted to probation's MRU end
+ * two_queue_eviction  2Q: new entries go to the A1in fifo (front, 25%),
+ *                 keys evicted from it are remembered in the A1out
+ *                 ghost list (50%); a key coming back from A1out goes
+ *                 straight to the Am lru (back)
+ * arc_eviction    ARC: a recency list T1 (front) and a frequency list
+ *                 T2 (back) whose split adapts to hits in their
+ *                 ghost lists B1 and B2
+ * tinylfu_eviction  W-TinyLFU: a small lru window in front of an slru
+ *                 main space; an entry leaving the window only gets
+ *                 into main if a frequency_sketch says it is used
+ *                 more often than main's victim
+*/
+template<class Map> struct fifo_eviction{
+	using Node = typename Map::Node;
+	static const bool shared_hits = true;
+	explicit fifo_eviction(size_t) {}
+	void inserted(Map &, Node *) {}
+	void removing(Map &, Node *) {}
+	void hit(Map &, Node *) {}
+	Node *victim(Map &map) {
+		return map.list.head;
+	}
+	size_t bytes() const {
+		return 0;
+	}
+};
+
+template<class Map> struct slru_eviction{
+	using Node = typename Map::Node;
+	using LIT = typename Map::LIT;
+	static const bool shared_hits = false;
+	static const unsigned char protect = 1;
+	Node *boundary = nullptr;  // protected LRU end
+	size_t protectedCount = 0;
+
+	explicit slru_eviction(size_t) {}
+	void inserted(Map &map, Node *node) {
+		node->mark.store(0, std::memory_order_relaxed);
+		map.list.move_before(LIT(node), LIT(boundary));
+	}
+	void hit(Map &map, Node *node) {
+		if (node->mark.load(std::memory_order_relaxed) == protect) {
+			if (node == boundary && node->next != nullptr) {boundary = node->next; }
+			map.list.move_to_tail(LIT(node));
+			return;
+		}
+		node->mark.store(protect, std::memory_order_relaxed);
+		++protectedCount;
+		map.list.move_to_tail(LIT(node));
+		if (boundary == nullptr) {boundary = node; }
+		// the protected LRU entry stays in place and becomes probation MRU
+		while (protectedCount > map.size() * 4 / 5 && boundary != nullptr) {
+			boundary->mark.store(0, std::memory_order_relaxed);
+			--protectedCount;
+			boundary = boundary->next;
+		}
+	}
+	Node *victim(Map &map) {
+		return map.list.head;  // probation LRU, or protected LRU if probation is empty
+	}
+	void removing(Map &, Node *node) {
+		if (node == boundary) {boundary = node->next; }
+		if (node->mark.load(std::memory_order_relaxed) == protect) {--protectedCount; }
+	}
+	size_t bytes() const {
+		return 0;
+	}
+};
+
+/**
+ * keys of recently evicted entries, oldest first, for the adaptive
+ * modes; a ghost holds the key and its hash but never the value
+ * (the hash is kept whatever cache_hash_code says: ghosts are probed
+ * on every miss and most probes fail on it).
+ * it is a double_list of small nodes with a chain_index over them.
+*/
+template<class Key, class Hash = std::hash<Key>, class Equal = std::equal_to<Key> >
+class ghost_list{
+public:
+	struct ghost_key{
+		Key first;
+		explicit ghost_key(const Key &k): first(k) {}
+	};
+	struct Node: hash_slot<true>{
+		ghost_key item;
+		Node *prev = nullptr, *next = nullptr;
+		Node *chain = nullptr;
+		explicit Node(const Key &k): item(k) {}
+	};
+
+	explicit ghost_list(size_t buckets = 16): index(buckets) {}
+	ghost_list(const ghost_list &other) = delete;
+	ghost_list & operator=(const ghost_list &other) = delete;
+	~ghost_list() {
+		clear();
+	}
+
+	size_t size() const {
+		return index.curL;
+	}
+	bool contains(const Key &key) const {
+		return index.find(key) != nullptr;
+	}
+	/**
+	 * forget key; return whether it was there
+	*/
+	bool erase(const Key &key) {
+		Node *node = index.find(key);
+		if (node == nullptr) {return false; }
+		index.unlink(node);
+		list.erase(typename list_type::iterator(node));
+		return true;
+	}
+	/**
+	 * remember key as the newest ghost (key must not be there yet)
+	*/
+	void push(const Key &key) {
+		list.emplace_tail(key);
+		index.link(list.tail);
+	}
+	/**
+	 * forget the oldest ghost
+	*/
+	void pop() {
+		if (list.head == nullptr) {return; }
+		index.unlink(list.head);
+		list.delete_head();
+	}
+	/**
+	 * drop the oldest ghosts until at most n are left
+	*/
+	void trim(size_t n) {
+		while (size() > n) {pop(); }
+	}
+	void clear() {
+		index.clear();
+		list.clear();
+	}
+	/**
+	 * memory held by the ghosts: nodes plus bucket array
+	*/
+	size_t bytes() const {
+		return size() * sizeof(Node) + index.size * sizeof(Node *);
+	}
+
+private:
+	using list_type = double_list<ghost_key, Node>;
+	list_type list;
+	chain_index<Node, Key, Hash, Equal> index;
+};
+
+template<class Map> struct two_queue_eviction{
+	using Node = typename Map::Node;
+	using LIT = typename Map::LIT;
+	using ghost_type = ghost_list<typename Map::key_type, typename Map::hasher, typename Map::key_equal>;
+	static const bool shared_hits = false;
+	static const unsigned char frequent = 1;  // mark of Am entries
+	Node *boundary = nullptr;  // Am LRU end
+	size_t inCount = 0;  // entries in A1in
+	ghost_type out;  // A1out
+
+	explicit two_queue_eviction(size_t) {}
+	void inserted(Map &map, Node *node) {
+		if (out.erase(node->item.first)) {
+			node->mark.store(frequent, std::memory_order_relaxed);
+			if (boundary == nullptr) {boundary = node; }
+			return;
+		}
+		node->mark.store(0, std::memory_order_relaxed);
+		++inCount;
+		map.list.move_before(LIT(node), LIT(boundary));
+	}
+	void hit(Map &map, Node *node) {
+		// A1in is a fifo: a hit there changes nothing
+		if (node->mark.load(std::memory_order_relaxed) != frequent) {return; }
+		if (node == boundary && node->next != nullptr) {boundary = node->next; }
+		map.list.move_to_tail(LIT(node));
+	}
+	Node *victim(Map &map) {
+		Node *node = map.list.head;
+		if (inCount > 0 && (inCount > map.size() / 4 || boundary == nullptr)) {
+			out.push(node->item.first);
+			out.trim(map.size() / 2);
+			return node;
+		}
+		return boundary != nullptr ? boundary : node;
+	}
+	void removing(Map &, Node *node) {
+		if (node == boundary) {boundary = node->next; }
+		if (node->mark.load(std::memory_order_relaxed) != frequent) {--inCount; }
+	}
+	size_t bytes() const {
+		return out.bytes();
+	}
+};
+
+/**
+ * the list is [T1 | T2]: entries seen once, then entries seen at least
+ * twice (mark 1), boundary is the first T2 node.  B1 / B2 remember the
+ * keys evicted from T1 / T2.  a new key found in B1 means T1 was too
+ * small, so the target size p of T1 grows (by |B2| / |B1|, at least 1);
+ * found in B2, p shrinks the same way; either way the key goes to T2.
+ * victim() takes the T1 lru entry while T1 is over p, else the T2 one.
+ * c, the size ARC balances against, is the current entry count, and
+ * the ghosts are kept to |T1| + |B1| <= c and at most 2c keys in all.
+ * unlike the paper p is adapted when the key is inserted, after the
+ * victim was chosen for it, and the "key is in B2" tie-break of the
+ * victim choice is left out: victim() does not know the key yet.
+*/
+template<class Map> struct arc_eviction{
+	using Node = typename Map::Node;
+	using LIT = typename Map::LIT;
+	using ghost_type = ghost_list<typename Map::key_type, typename Map::hasher, typename Map::key_equal>;
+	static const bool shared_hits = false;
+	static const unsigned char frequent = 1;  // mark of T2 entries
+	Node *boundary = nullptr;  // T2 lru end
+	size_t recentCount = 0;  // |T1|
+	size_t p = 0;  // target |T1|
+	ghost_type b1, b2;
+
+	explicit arc_eviction(size_t) {}
+	/**
+	 * the current target size of T1
+	*/
+	size_t target() const {
+		return p;
+	}
+	void inserted(Map &map, Node *node) {
+		const auto &key = node->item.first;
+		size_t c = map.size();
+		bool seen = true;
+		if (b1.contains(key)) {
+			size_t step = b2.size() > b1.size() ? b2.size() / b1.size() : 1;
+			p = p + step < c ? p + step : c;
+			b1.erase(key);
+		} else if (b2.contains(key)) {
+			size_t step = b1.size() > b2.size() ? b1.size() / b2.size() : 1;
+			p = p > step ? p - step : 0;
+			b2.erase(key);
+		} else {
+			seen = false;
+		}
+		if (seen) {
+			node->mark.store(frequent, std::memory_order_relaxed);
+			if (boundary == nullptr) {boundary = node; }
+		} else {
+			node->mark.store(0, std::memory_order_relaxed);
+			++recentCount;
+			map.list.move_before(LIT(node), LIT(boundary));
+		}
+		// the ghosts of the victims chosen for this key are in by now
+		b1.trim(c - recentCount);
+		b2.trim(c - b1.size());
+	}
+	void hit(Map &map, Node *node) {
+		if (node->mark.load(std::memory_order_relaxed) != frequent) {
+			node->mark.store(frequent, std::memory_order_relaxed);
+			--recentCount;
+		} else if (node == boundary) {
+			if (node->next == nullptr) {return; }
+			boundary = node->next;
+		}
+		map.list.move_to_tail(LIT(node));
+		if (boundary == nullptr) {boundary = node; }
+	}
+	Node *victim(Map &map) {
+		if (recentCount > 0 && (recentCount > p || boundary == nullptr)) {
+			b1.push(map.list.head->item.first);
+			return map.list.head;
+		}
+		b2.push(boundary->item.first);
+		return boundary;
+	}
+	void removing(Map &, Node *node) {
+		if (node == boundary) {boundary = node->next; }
+		if (node->mark.load(std::memory_order_relaxed) != frequent) {--recentCount; }
+	}
+	size_t bytes() const {
+		return b1.bytes() + b2.bytes();
+	}
+};
+
+/**
+ * approximate access counts of hashed keys: a count-min sketch of
+ * 4-bit counters, 4 rows deep, blocked so that all the rows of a key
+ * are in one 64-byte block (one cache line per increment / estimate).
+ * a block is 8 words of 16 counters; row i of a key uses one of the
+ * words 2i, 2i+1.  counters saturate at 15, and after 10 increments
+ * per tracked key every counter is halved, so old popularity fades.
+ * it is sized at 16 counters (8 bytes) per key it has to track and
+ * grows with the number of keys.
+*/
+class frequency_sketch{
+public:
+	explicit frequency_sketch(size_t keys = 0) {
+		ensure(keys);
+	}
+
+	/**
+	 * make room to track `keys` keys.
+	 * growing keeps every estimate: a key's block only gains a high
+	 * bit, so each old block is copied to both blocks it splits into
+	 * (the extra collisions fade with aging)
+	*/
+	void ensure(size_t keys) {
+		size_t blocks = table.empty() ? 1 : table.size();
+		while (blocks * keys_per_block < keys) {blocks <<= 1; }
+		if (blocks == table.size()) {return; }
+		size_t old = table.size();
+		table.resize(blocks);
+		for (size_t i = old; old != 0 && i < blocks; ++i) {table[i] = table[i & (old - 1)]; }
+		mask = blocks - 1;
+		sampleSize = 10 * blocks * keys_per_block;
+	}
+	void increment(size_t hash) {
+		size_t h = pow2_hash_policy::mix(hash);
+		block &b = table[h & mask];
+		size_t bits = h >> 32;
+		bool added = false;
+		for (size_t i = 0; i < 4; ++i, bits >>= 8) {
+			uint64_t &word = b.word[2 * i + (bits & 1)];
+			size_t shift = ((bits >> 1) & 15) * 4;
+			if (((word >> shift) & 15) != 15) {
+				word += uint64_t(1) << shift;
+				added = true;
+			}
+		}
+		if (added && ++additions == sampleSize) {age(); }
+	}
+	/**
+	 * an upper bound of how often hash was incremented lately (0..15)
+	*/
+	unsigned estimate(size_t hash) const {
+		size_t h = pow2_hash_policy::mix(hash);
+		const block &b = table[h & mask];
+		size_t bits = h >> 32;
+		unsigned freq = 15;
+		for (size_t i = 0; i < 4; ++i, bits >>= 8) {
+			unsigned c = unsigned(b.word[2 * i + (bits & 1)] >> (((bits >> 1) & 15) * 4)) & 15;
+			if (c < freq) {freq = c; }
+		}
+		return freq;
+	}
+	/**
+	 * halve every counter
+	*/
+	void age() {
+		for (auto &b: table) {
+			for (auto &word: b.word) {word = (word >> 1) & 0x7777777777777777ull; }
+		}
+		additions /= 2;
+	}
+	size_t bytes() const {
+		return table.size() * sizeof(block);
+	}
+
+private:
+	static const size_t keys_per_block = 8;
+	struct alignas(64) block{
+		uint64_t word[8] = {};
+	};
+	std::vector<block> table;
+	size_t mask = 0;
+	size_t additions = 0, sampleSize = 0;
+};
+
+/**
+ * the list is [probation | protected | window], from the head; a
+ * node's mark tells its segment and start[] holds the first (least
+ * recent) node of each, nullptr when it is empty.
+ * the window takes window_percent() of the entries (at least one, so
+ * with 0 it is plain TinyLFU admission), protected 80% of the rest.
+ * every insert and hit counts in the sketch; when the window is full
+ * its lru entry and the probation lru entry compete, the one with the
+ * lower estimate is evicted (the window one on a tie) and a winning
+ * window entry moves to probation.
+*/
+template<class Map> struct tinylfu_eviction{
+	using Node = typename Map::Node;
+	using LIT = typename Map::LIT;
+	static const bool shared_hits = false;
+	static const unsigned char probation = 0, protect = 1, window = 2;
+	Node *start[3] = {nullptr, nullptr, nullptr};
+	size_t count[3] = {0, 0, 0};
+	frequency_sketch sketch;
+
+	explicit tinylfu_eviction(size_t) {}
+	size_t window_percent() const {
+		return windowPercent;
+	}
+	void window_percent(size_t p) {
+		windowPercent = p > 100 ? 100 : p;
+	}
+
+	void inserted(Map &map, Node *node) {
+		sketch.ensure(map.size());
+		sketch.increment(hash(node));
+		append(map, node, window);
+		// only while filling up: later victim() keeps the window in bounds
+		while (count[window] > window_limit(map)) {
+			Node *oldest = start[window];
+			leave(oldest);
+			append(map, oldest, probation);
+		}
+	}
+	void hit(Map &map, Node *node) {
+		sketch.increment(hash(node));
+		unsigned char seg = node->mark.load(std::memory_order_relaxed);
+		leave(node);
+		append(map, node, seg == window ? window : protect);
+		while (count[protect] > (map.size() - count[window]) * 4 / 5) {
+			Node *oldest = start[protect];
+			leave(oldest);
+			append(map, oldest, probation);
+		}
+	}
+	Node *victim(Map &map) {
+		Node *main = start[probation] != nullptr ? start[probation] : start[protect];
+		Node *candidate = start[window];
+		if (main == nullptr) {return candidate; }
+		if (candidate == nullptr || count[window] < window_limit(map)) {return main; }
+		if (sketch.estimate(hash(candidate)) > sketch.estimate(hash(main))) {
+			leave(candidate);
+			append(map, candidate, probation);
+			return main;
+		}
+		return candidate;
+	}
+	void removing(Map &, Node *node) {
+		leave(node);
+	}
+	size_t bytes() const {
+		return sketch.bytes();
+	}
+
+private:
+	size_t windowPercent = 1;
+
+	size_t window_limit(const Map &map) const {
+		size_t n = map.size() * windowPercent / 100;
+		return n > 0 ? n : 1;
+	}
+	static size_t hash(const Node *node) {
+		return node->hash_of(typename Map::hasher(), node->item.first);
+	}
+	/**
+	 * take node out of the books of its segment (it stays in the list)
+	*/
+	void leave(Node *node) {
+		unsigned char seg = node->mark.load(std::memory_order_relaxed);
+		--count[seg];
+		if (start[seg] == node) {
+			Node *nxt = node->next;
+			start[seg] = nxt != nullptr && nxt->mark.load(std::memory_order_relaxed) == seg ? nxt : nullptr;
+		}
+	}
+	/**
+	 * move node to the most recent end of segment seg
+	*/
+	void append(Map &map, Node *node, unsigned char seg) {
+		Node *where = nullptr;
+		for (unsigned char s = seg + 1; s <= window && where == nullptr; ++s) {where = start[s]; }
+		map.list.move_before(LIT(node), LIT(where));
+		node->mark.store(seg, std::memory_order_relaxed);
+		++count[seg];
+		if (start[seg] == nullptr) {start[seg] = node; }
+	}
+};
+
+using arc_lru = basic_lru<Integer, Matrix<int>, ::Hash, ::Equal, std::allocator<pair<const Integer, Matrix<int> > >,
+	pow2_hash_policy, arc_eviction>;
+
+}
+
+#endif
@@ -0,0 +1,215 @@
+#ifndef SJTU_EXPIRY_HPP
+#define SJTU_EXPIRY_HPP
+
+#include "lru.hpp"
+#include <chrono>
+#include <cstdint>
+
+namespace sjtu {
+
+/**
+ * clocks of wheel_expiry: now() in ticks.
+ * steady_millis   milliseconds of std::chrono::steady_clock
+ * manual_clock    time only moves when told to, for tests
+*/
+struct steady_millis{
+	uint64_t now() const {
+		return uint64_t(std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+};
+struct manual_clock{
+	uint64_t time = 0;
+	uint64_t now() const {
+		return time;
+	}
+	void advance(uint64_t ticks) {
+		time += ticks;
+	}
+};
+
+/**
+ * the timer links wheel_expiry puts in every node
+*/
+struct timer_hook{
+	timer_hook *timerPrev = nullptr, *timerNext = nullptr;  // nullptr: not on the wheel
+	uint64_t deadline = 0;  // 0: never dies
+};
+
+/**
+ * Expiry of basic_lru: an entry dies ttl ticks after it was written
+ * (expire_after_write) or last written or read (expire_after_access).
+ *
+ * deadlines are kept in a hierarchical timer wheel: `levels` wheels of
+ * 64 slots, a slot of level L spanning 64^L ticks, so the levels cover
+ * 64, 4096, 262144 and 16.7M ticks ahead (4.6 hours of milliseconds);
+ * later deadlines wait in the last slot of the top level.
+ * a node sits in the slot its deadline falls in, at the lowest level
+ * that reaches that far, on a circular list through its timer_hook,
+ * so scheduling and unlinking are O(1).
+ * advance() turns every slot whose start the clock has passed: dead
+ * nodes are handed out, the others move down to a finer level.  a node
+ * moves at most once per level, so expiry is O(1) amortized per entry,
+ * and a jump of the clock turns at most 64 slots per level.
+ * the wheel links point into itself: it can be neither copied nor moved.
+*/
+template<class Clock = steady_millis> class wheel_expiry{
+public:
+	using hook = timer_hook;
+	static const bool shared_access = false;  // a read may move the node on the wheel
+	static const size_t levels = 4;
+	static const size_t bits = 6;
+	static const size_t slots = size_t(1) << bits;
+	Clock clock;
+
+	wheel_expiry() {
+		for (auto &wheel: wheels) {
+			for (auto &slot: wheel) {reset(&slot); }
+		}
+		reset(&due);
+		last = clock.now();
+	}
+	wheel_expiry(const wheel_expiry &other) = delete;
+	wheel_expiry & operator=(const wheel_expiry &other) = delete;
+
+	/**
+	 * entries written from now on die ticks after that (0: never)
+	*/
+	void expire_after_write(uint64_t ticks) {
+		ttl = ticks;
+		onAccess = false;
+	}
+	/**
+	 * entries written or read from now on die ticks after that
+	*/
+	void expire_after_access(uint64_t ticks) {
+		ttl = ticks;
+		onAccess = true;
+	}
+	/**
+	 * number of nodes on the wheel
+	*/
+	size_t scheduled() const {
+		return count;
+	}
+
+	void written(hook *node) {
+		if (ttl != 0) {expire_in(node, ttl); }
+		else {unlink(node); }
+	}
+	void accessed(hook *node) {
+		if (onAccess && ttl != 0) {expire_in(node, ttl); }
+	}
+	bool expired(const hook *node) const {
+		return node->deadline != 0 && node->deadline <= clock.now();
+	}
+	void removing(hook *node) {
+		unlink(node);
+	}
+	/**
+	 * give node the deadline now + ticks (0: never dies)
+	*/
+	void expire_in(hook *node, uint64_t ticks) {
+		if (ticks == 0) {
+			unlink(node);
+			return;
+		}
+		unlink(node);
+		node->deadline = clock.now() + ticks;
+		schedule(node);
+	}
+	/**
+	 * bring the wheel to the clock and call f(node) on every dead node,
+	 * which must take it off (removing); return how many there were
+	*/
+	template<class F>
+	size_t advance(F &&f) {
+		uint64_t now = clock.now(), before = last;
+		if (now < before) {now = before; }
+		last = now;
+		size_t dead = turn(&due, now, f);
+		for (size_t level = 0; level < levels; ++level) {
+			uint64_t from = before >> (bits * level), to = now >> (bits * level);
+			if (from == to) {break; }
+			uint64_t steps = to - from < slots ? to - from : slots;
+			for (uint64_t s = 1; s <= steps; ++s) {
+				dead += turn(&wheels[level][(from + s) & (slots - 1)], now, f);
+			}
+		}
+		return dead;
+	}
+
+private:
+	hook wheels[levels][slots];
+	hook due;  // deadline already passed when scheduled
+	uint64_t last;  // time the wheel was last advanced to
+	uint64_t ttl = 0;
+	bool onAccess = false;
+	size_t count = 0;
+
+	static void reset(hook *head) {
+		head->timerPrev = head->timerNext = head;
+	}
+	void unlink(hook *node) {
+		if (node->timerNext == nullptr) {
+			node->deadline = 0;
+			return;
+		}
+		node->timerPrev->timerNext = node->timerNext;
+		node->timerNext->timerPrev = node->timerPrev;
+		node->timerPrev = node->timerNext = nullptr;
+		node->deadline = 0;
+		--count;
+	}
+	/**
+	 * put node (not on the wheel) in the slot of its deadline, seen from last
+	*/
+	void schedule(hook *node) {
+		hook *head = &due;
+		if (node->deadline > last) {
+			uint64_t delta = node->deadline - last;
+			size_t level = 0;
+			while (level + 1 < levels && delta >= (uint64_t(1) << (bits * (level + 1)))) {++level; }
+			uint64_t slot = node->deadline >> (bits * level);
+			uint64_t farthest = (last >> (bits * level)) + slots - 1;
+			head = &wheels[level][(slot < farthest ? slot : farthest) & (slots - 1)];
+		}
+		node->timerPrev = head->timerPrev;
+		node->timerNext = head;
+		head->timerPrev->timerNext = node;
+		head->timerPrev = node;
+		++count;
+	}
+	/**
+	 * empty the slot: dead nodes go to f, the others are scheduled again
+	*/
+	template<class F>
+	size_t turn(hook *head, uint64_t now, F &f) {
+		if (head->timerNext == head) {return 0; }
+		// detach the slot first, rescheduled nodes may land in it again
+		hook batch;
+		batch.timerNext = head->timerNext;
+		batch.timerPrev = head->timerPrev;
+		batch.timerNext->timerPrev = batch.timerPrev->timerNext = &batch;
+		reset(head);
+		size_t dead = 0;
+		while (batch.timerNext != &batch) {
+			hook *node = batch.timerNext;
+			node->timerPrev->timerNext = node->timerNext;
+			node->timerNext->timerPrev = node->timerPrev;
+			node->timerPrev = node->timerNext = nullptr;
+			--count;
+			if (node->deadline <= now) {
+				f(node);
+				++dead;
+			} else {
+				schedule(node);
+			}
+		}
+		return dead;
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,306 @@
+#ifndef SJTU_FROZEN_HPP
+#define SJTU_FROZEN_HPP
+
+#include "lru.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sjtu {
+
+/**
+ * read-only "frozen" linked_hashmap<Key, Matrix<E>>: freeze() writes
+ * the map to a file that frozen_map maps into memory and queries in
+ * place, with no parsing and no allocation, so opening is O(1) and the
+ * pages are shared by every process that maps the file.
+ * the file only holds offsets from its start, never pointers:
+ *   header   magic "SJFROZ01", sizes, section offsets
+ *   slots    open addressing table, a power of two >= 2 * count,
+ *            linear probing; a slot is the mixed hash, the offset of
+ *            the value (0: empty) and the key
+ *   order    slot of each entry in list order, for iteration
+ *   heap     the values one after another: rows, cols, then the
+ *            elements row by row, 8-byte aligned
+ * numbers are stored as they are in memory and keys hashed with Hash,
+ * so a file is for the same build on the same kind of machine.
+*/
+
+/**
+ * how a key is stored in a frozen file (fixed size, no pointers):
+ * trivially copyable keys as they are, Integer as its int
+*/
+template<class Key> struct frozen_key{
+	static_assert(std::is_trivially_copyable<Key>::value, "specialise sjtu::frozen_key for this type");
+	using type = Key;
+	static type store(const Key &k) {return k; }
+	static const Key &load(const type &k) {return k; }
+};
+template<> struct frozen_key<Integer>{
+	using type = int;
+	static type store(const Integer &k) {return k.val; }
+	static Integer load(const type &k) {return Integer(k); }
+};
+
+template<class Key> struct frozen_slot{
+	uint64_t hash;
+	uint64_t value;  // offset of the value record, 0 if the slot is empty
+	typename frozen_key<Key>::type key;
+};
+
+struct frozen_header{
+	char magic[8];
+	uint32_t key_bytes, elem_bytes;  // sizeof the stored key / element
+	uint64_t count, slots;
+	uint64_t slot_offset, order_offset, heap_offset, file_bytes;
+};
+
+/**
+ * a matrix inside a frozen file
+*/
+template<class E> class frozen_matrix{
+public:
+	frozen_matrix(): elems(nullptr), rows(0), cols(0) {}
+	explicit frozen_matrix(const char *record)
+		: elems(reinterpret_cast<const E *>(record + 2 * sizeof(uint64_t))),
+		  rows(reinterpret_cast<const uint64_t *>(record)[0]), cols(reinterpret_cast<const uint64_t *>(record)[1]) {}
+
+	/**
+	 * false for the result of a failed find
+	*/
+	explicit operator bool() const {
+		return elems != nullptr;
+	}
+	size_t RowSize() const {
+		return rows;
+	}
+	size_t ColSize() const {
+		return cols;
+	}
+	const E *operator[](size_t row) const {
+		return elems + row * cols;
+	}
+	/**
+	 * copy out as an ordinary Matrix
+	*/
+	Matrix<E> matrix() const {
+		Matrix<E> m(rows, cols);
+		for (size_t i = 0; i < rows; ++i) {
+			for (size_t j = 0; j < cols; ++j) {m[i][j] = (*this)[i][j]; }
+		}
+		return m;
+	}
+	bool operator==(const Matrix<E> &m) const {
+		if (m.RowSize() != rows || m.ColSize() != cols) {return false; }
+		for (size_t i = 0; i < rows; ++i) {
+			for (size_t j = 0; j < cols; ++j) {
+				if (!((*this)[i][j] == m[i][j])) {return false; }
+			}
+		}
+		return true;
+	}
+
+private:
+	const E *elems;
+	size_t rows, cols;
+};
+
+/**
+ * write map to path as a frozen file, in its list order; written next
+ * to it and renamed over it at the end.  return the file size
+*/
+template<class Key, class E, class Hash, class Equal, class Alloc, class Policy, class Hook>
+uint64_t freeze(const linked_hashmap<Key, Matrix<E>, Hash, Equal, Alloc, Policy, Hook> &map, const char *path) {
+	static_assert(std::is_trivially_copyable<E>::value && alignof(E) <= 8, "frozen elements are copied as bytes");
+	using slot = frozen_slot<Key>;
+	auto align = [](uint64_t n) {return (n + 7) & ~uint64_t(7); };
+
+	uint64_t count = 0;
+	for (auto it = map.cbegin(); it != map.cend(); ++it) {++count; }
+	uint64_t slots = 8;
+	while (slots < count * 2) {slots <<= 1; }
+
+	frozen_header head;
+	std::memcpy(head.magic, "SJFROZ01", 8);
+	head.key_bytes = sizeof(typename frozen_key<Key>::type);
+	head.elem_bytes = sizeof(E);
+	head.count = count;
+	head.slots = slots;
+	head.slot_offset = align(sizeof(frozen_header));
+	head.order_offset = head.slot_offset + slots * sizeof(slot);
+	head.heap_offset = align(head.order_offset + count * sizeof(uint64_t));
+
+	std::vector<slot> table(slots);
+	std::memset(static_cast<void *>(table.data()), 0, slots * sizeof(slot));
+	std::vector<uint64_t> order;
+	order.reserve(count);
+	uint64_t at = head.heap_offset;
+	for (auto it = map.cbegin(); it != map.cend(); ++it) {
+		uint64_t h = pow2_hash_policy::mix(Hash()(it->first));
+		uint64_t i = h & (slots - 1);
+		while (table[i].value != 0) {i = (i + 1) & (slots - 1); }
+		table[i].hash = h;
+		table[i].value = at;
+		table[i].key = frozen_key<Key>::store(it->first);
+		order.push_back(i);
+		at += align(2 * sizeof(uint64_t) + it->second.RowSize() * it->second.ColSize() * sizeof(E));
+	}
+	head.file_bytes = at;
+
+	std::string temp = std::string(path) + ".tmp";
+	std::FILE *file = std::fopen(temp.c_str(), "wb");
+	if (file == nullptr) {throw runtime_error(); }
+	static const char zeros[8] = {};
+	auto put = [file](const void *data, size_t n) {
+		if (n != 0 && std::fwrite(data, 1, n, file) != n) {throw runtime_error(); }
+	};
+	try {
+		put(&head, sizeof(head));
+		put(zeros, head.slot_offset - sizeof(head));
+		put(table.data(), slots * sizeof(slot));
+		put(order.data(), count * sizeof(uint64_t));
+		put(zeros, head.heap_offset - head.order_offset - count * sizeof(uint64_t));
+		for (auto it = map.cbegin(); it != map.cend(); ++it) {
+			const auto &m = it->second;
+			uint64_t shape[2] = {m.RowSize(), m.ColSize()};
+			put(shape, sizeof(shape));
+			for (size_t r = 0; r < shape[0] && shape[1] != 0; ++r) {put(&m[r][0], shape[1] * sizeof(E)); }
+			size_t bytes = sizeof(shape) + shape[0] * shape[1] * sizeof(E);
+			put(zeros, align(bytes) - bytes);
+		}
+		if (std::fclose(file) != 0) {
+			file = nullptr;
+			throw runtime_error();
+		}
+		file = nullptr;
+		if (std::rename(temp.c_str(), path) != 0) {throw runtime_error(); }
+	} catch (...) {
+		if (file != nullptr) {std::fclose(file); }
+		std::remove(temp.c_str());
+		throw;
+	}
+	return head.file_bytes;
+}
+
+/**
+ * a frozen file mapped read-only; find() returns views into the
+ * mapping, valid as long as the frozen_map is
+*/
+template<
+	class Key = Integer,
+	class E = int,
+	class Hash = ::Hash,
+	class Equal = ::Equal
+> class frozen_map{
+	using slot = frozen_slot<Key>;
+public:
+	/**
+	 * map path; throws runtime_error if it is not a frozen file of
+	 * this Key and E (only the header and the size are checked here,
+	 * each value record when it is read)
+	*/
+	explicit frozen_map(const char *path) {
+		int fd = ::open(path, O_RDONLY);
+		if (fd < 0) {throw runtime_error(); }
+		struct stat st;
+		if (::fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(frozen_header)) {
+			::close(fd);
+			throw runtime_error();
+		}
+		length = size_t(st.st_size);
+		void *p = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (p == MAP_FAILED) {throw runtime_error(); }
+		base = static_cast<const char *>(p);
+		head = reinterpret_cast<const frozen_header *>(base);
+		if (std::memcmp(head->magic, "SJFROZ01", 8) != 0 || head->key_bytes != sizeof(typename frozen_key<Key>::type)
+			|| head->elem_bytes != sizeof(E) || head->file_bytes != length || head->slots == 0
+			|| (head->slots & (head->slots - 1)) != 0 || head->slots > length / sizeof(slot) || head->count > head->slots
+			|| head->slot_offset % 8 != 0 || head->slot_offset > length - head->slots * sizeof(slot)
+			|| head->order_offset % 8 != 0 || head->order_offset > length - head->count * sizeof(uint64_t)
+			|| head->heap_offset < sizeof(frozen_header) || head->heap_offset > length) {
+			::munmap(p, length);
+			throw runtime_error();
+		}
+		table = reinterpret_cast<const slot *>(base + head->slot_offset);
+		order = reinterpret_cast<const uint64_t *>(base + head->order_offset);
+		mask = head->slots - 1;
+	}
+	frozen_map(const frozen_map &other) = delete;
+	frozen_map & operator=(const frozen_map &other) = delete;
+	~frozen_map() {
+		::munmap(const_cast<char *>(base), length);
+	}
+
+	size_t size() const {
+		return head->count;
+	}
+	bool empty() const {
+		return head->count == 0;
+	}
+	/**
+	 * the value of key, or an empty frozen_matrix (false) if absent;
+	 * throws runtime_error if its record is not inside the file
+	*/
+	frozen_matrix<E> find(const Key &key) const {
+		uint64_t h = pow2_hash_policy::mix(Hash()(key));
+		for (uint64_t i = h & mask, n = 0; n <= mask && table[i].value != 0; i = (i + 1) & mask, ++n) {
+			if (table[i].hash == h && Equal()(frozen_key<Key>::load(table[i].key), key)) {
+				return record(table[i].value);
+			}
+		}
+		return frozen_matrix<E>();
+	}
+	size_t count(const Key &key) const {
+		return find(key) ? 1 : 0;
+	}
+	/**
+	 * call f(key, frozen_matrix) on every entry in the order of the map
+	 * that was frozen; throws runtime_error, as find, on a bad record
+	*/
+	template<class F>
+	void for_each(F &&f) const {
+		for (uint64_t n = 0; n < head->count; ++n) {
+			if (order[n] > mask) {throw runtime_error(); }
+			const slot &s = table[order[n]];
+			f(frozen_key<Key>::load(s.key), record(s.value));
+		}
+	}
+	/**
+	 * bytes mapped (shared with every other process mapping the file)
+	*/
+	size_t bytes() const {
+		return length;
+	}
+
+private:
+	/**
+	 * the value record at offset value, checked to lie in the heap with
+	 * all its elements, so a corrupt file cannot make a view past the
+	 * mapping
+	*/
+	frozen_matrix<E> record(uint64_t value) const {
+		const uint64_t shapeBytes = 2 * sizeof(uint64_t);
+		if (value < head->heap_offset || value % 8 != 0 || value > length - shapeBytes) {throw runtime_error(); }
+		const uint64_t *shape = reinterpret_cast<const uint64_t *>(base + value);
+		uint64_t room = (length - value - shapeBytes) / sizeof(E);
+		if (shape[0] > length || (shape[1] != 0 && shape[0] > room / shape[1])) {throw runtime_error(); }
+		return frozen_matrix<E>(base + value);
+	}
+
+	const char *base;
+	size_t length;
+	const frozen_header *head;
+	const slot *table;
+	const uint64_t *order;
+	uint64_t mask;
+};
+
+}
+
+#endif
@@ -5,13 +5,24 @@
 #include "exceptions.hpp"
 #include "class-integer.hpp"
 #include "class-matrix.hpp"
+#include "allocator.hpp"
+#include "stats.hpp"
 #include <iostream>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <atomic>
+#include <cstdint>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#include <immintrin.h>
+#define SJTU_X86_GROUPS
+#endif
 void innerflag() {
 	std::cout << "MAPOK" << std::endl;
 }
 class Hash {
 public:
-	unsigned int operator () (Integer lhs) const {
+	size_t operator () (Integer lhs) const {
 		int val = lhs.val;
 		return std::hash<int>()(val);
 	}
@@ -24,29 +35,44 @@ public:
 };
 
 namespace sjtu {
-template<class T> class double_list{
-private:
-	struct Node{
-		T item;
-		Node *prev = nullptr, *next = nullptr;
-		Node(const T& x): item(x) {}
-		~Node() {
-			prev = nullptr, next = nullptr;
-		}
-	};
+template<class T> struct list_node{
+	T item;
+	list_node *prev = nullptr, *next = nullptr;
+	template<class... Args>
+	explicit list_node(Args &&... args): item(std::forward<Args>(args)...) {}
+	~list_node() {
+		prev = nullptr, next = nullptr;
+	}
+};
+/**
+ * Node can be replaced by any type that has `item`, `prev`, `next`
+ * and a constructor forwarding its arguments to `item`, so that
+ * other containers can hang
+ * their own links on the list nodes (see linked_hashmap).
+ * nodes come from Alloc rebound to Node (kept as an empty base).
+*/
+template<
+	class T,
+	class Node = list_node<T>,
+	class Alloc = std::allocator<T>
+> class double_list: private std::allocator_traits<Alloc>::template rebind_alloc<Node>{
+	using node_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<Node>;
+	using node_traits = std::allocator_traits<node_allocator>;
 public:
+	using allocator_type = Alloc;
 	Node *head = nullptr, *tail = nullptr;
 	
-	double_list(){
+	explicit double_list(const Alloc &alloc = Alloc()): node_allocator(alloc) {
 	}
-	double_list(const double_list<T> &other) {
+	double_list(const double_list &other)
+		: node_allocator(node_traits::select_on_container_copy_construction(other.node_alloc())) {
 		Node *cur = other.head;
 		while (cur) {
 			insert_tail(cur->item);
 			cur = cur->next;
 		}
 	}
-	double_list & operator=(const double_list<T> & other) {
+	double_list & operator=(const double_list & other) {
 		if (this == &other) {return *this; }
 		clear();
 		Node *cur = other.head;
@@ -60,12 +86,16 @@ public:
 		clear();
 	}
 
+	allocator_type get_allocator() const {
+		return allocator_type(node_alloc());
+	}
+
 	void clear() {
 		//std::cout << "list_clear" << std::endl;
 		Node *cur = head, *nxt;
 		while (cur) {
 			nxt = cur->next;
-			delete cur;
+			destroy_node(cur);
 			cur = nxt;
 		}
 		head = nullptr;
@@ -233,7 +263,7 @@ public:
 		if (pos.it == tail) {
 			tail = pre;
 		}
-		delete pos.it;
+		destroy_node(pos.it);
 		//innerflag();
 		return iterator(nxt);
 	}
@@ -260,12 +290,44 @@ public:
 		pos.it->prev = tail;
 		tail = pos.it;
 	}
+	/**
+	 * relink pos right in front of where (to the tail if where
+	 * points to nothing)
+	*/
+	void move_before(iterator pos, iterator where) {
+		if (where.it == nullptr) {
+			move_to_tail(pos);
+			return;
+		}
+		if (pos.it == nullptr || pos.it == where.it || pos.it->next == where.it) {return; }
+		// unlink
+		if (pos.it->prev != nullptr) {pos.it->prev->next = pos.it->next; }
+		else {head = pos.it->next; }
+		if (pos.it->next != nullptr) {pos.it->next->prev = pos.it->prev; }
+		else {tail = pos.it->prev; }
+		// link in front of where
+		pos.it->prev = where.it->prev;
+		pos.it->next = where.it;
+		if (where.it->prev != nullptr) {where.it->prev->next = pos.it; }
+		else {head = pos.it; }
+		where.it->prev = pos.it;
+	}
 
 	/**
 	 * the following are operations of double list
 	*/
 	void insert_head(const T &val){
-		Node* new_node = new Node(val);
+		emplace_head(val);
+	}
+	void insert_head(T &&val){
+		emplace_head(std::move(val));
+	}
+	/**
+	 * construct the item in place from args
+	*/
+	template<class... Args>
+	void emplace_head(Args &&... args){
+		Node* new_node = create_node(std::forward<Args>(args)...);
 		if (head == nullptr) {
 			head = new_node;
 			tail = head;
@@ -276,8 +338,15 @@ public:
 		head = new_node;
 	}
 	void insert_tail(const T &val){
+		emplace_tail(val);
+	}
+	void insert_tail(T &&val){
+		emplace_tail(std::move(val));
+	}
+	template<class... Args>
+	void emplace_tail(Args &&... args){
 		//std::cout << "insert_tail" << std::endl;
-		Node* new_node = new Node(val);
+		Node* new_node = create_node(std::forward<Args>(args)...);
 		if (head == nullptr) {
 			head = new_node;
 			tail = head;
@@ -290,7 +359,7 @@ public:
 	void delete_head(){
 		if (head == nullptr) {throw container_is_empty(); }
 		Node* new_head = head->next;
-		delete head;
+		destroy_node(head);
 		head = new_head;
 		if (head != nullptr) {
 			head->prev = nullptr;
@@ -301,7 +370,7 @@ public:
 	void delete_tail(){
 		if (head == nullptr) {throw container_is_empty(); }
 		Node* new_tail = tail->prev;
-		delete tail;
+		destroy_node(tail);
 		tail = new_tail;
 		if (tail != nullptr) {
 			tail->next = nullptr;
@@ -322,32 +391,492 @@ public:
 			std::cout << it.it->item.first << " " <<it.it->item.second<< std::endl;
 		}
 	}
+
+private:
+	const node_allocator &node_alloc() const {return *this; }
+	node_allocator &node_alloc() {return *this; }
+	template<class... Args>
+	Node *create_node(Args &&... args) {
+		Node *node = node_traits::allocate(node_alloc(), 1);
+		try {
+			node_traits::construct(node_alloc(), node, std::forward<Args>(args)...);
+		} catch (...) {
+			node_traits::deallocate(node_alloc(), node, 1);
+			throw;
+		}
+		return node;
+	}
+	void destroy_node(Node *node) {
+		node_traits::destroy(node_alloc(), node);
+		node_traits::deallocate(node_alloc(), node, 1);
+	}
+};
+
+/**
+ * hash policies: how a (64-bit) hash picks one of n buckets.
+ * a policy provides
+ *   round(n)  the valid bucket count closest above n
+ *   grow(n)   the bucket count after n when the table expands
+ *   splits    whether growing sends old bucket i only to new buckets
+ *             i and i + n (lets incremental rehash skip clearing)
+ *   bucketer  built from a bucket count, bucketer(h) is the bucket
+ *
+ * mod_hash_policy     h % n, any n (the original behaviour)
+ * pow2_hash_policy    power-of-two n, wyhash-style mixing then a mask
+ * fibonacci_hash_policy  power-of-two n, top bits of h * 2^64/phi
+ * prime_hash_policy   prime n, modulo by reciprocal multiplication
+*/
+struct mod_hash_policy{
+	static const bool splits = true;
+	static size_t round(size_t n) {return n > 0 ? n : 1; }
+	static size_t grow(size_t n) {return n * 2; }
+	struct bucketer{
+		size_t n;
+		explicit bucketer(size_t count = 1): n(count) {}
+		size_t operator()(size_t h) const {return h % n; }
+	};
+};
+
+struct pow2_hash_policy{
+	static const bool splits = true;
+	static size_t round(size_t n) {
+		size_t r = 1;
+		while (r < n) {r <<= 1; }
+		return r;
+	}
+	static size_t grow(size_t n) {return n * 2; }
+	/**
+	 * 64x64->128 multiply folded back to 64 bits; every output bit
+	 * depends on every input bit, so masking the low bits is safe
+	 * even for identity hashes of patterned keys
+	*/
+	static size_t mix(size_t h) {
+		unsigned __int128 r = (unsigned __int128)(h ^ 0xa0761d6478bd642full) * 0xe7037ed1a0b428dbull;
+		return size_t(r) ^ size_t(r >> 64);
+	}
+	struct bucketer{
+		size_t mask;
+		explicit bucketer(size_t count = 1): mask(count - 1) {}
+		size_t operator()(size_t h) const {return mix(h) & mask; }
+	};
+};
+
+struct fibonacci_hash_policy{
+	static const bool splits = false;  // bucket i grows into 2i and 2i + 1
+	static size_t round(size_t n) {
+		size_t r = 2;
+		while (r < n) {r <<= 1; }
+		return r;
+	}
+	static size_t grow(size_t n) {return n * 2; }
+	struct bucketer{
+		unsigned int shift;
+		explicit bucketer(size_t count = 2): shift(64) {
+			for (size_t c = count; c > 1; c >>= 1) {--shift; }
+		}
+		size_t operator()(size_t h) const {return size_t(h * 0x9E3779B97F4A7C15ull >> shift); }
+	};
+};
+
+struct prime_hash_policy{
+	static const bool splits = false;
+	static size_t round(size_t n) {
+		static const size_t primes[] = {
+			5, 11, 23, 53, 97, 193, 389, 769, 1543, 3079, 6151, 12289, 24593,
+			49157, 98317, 196613, 393241, 786433, 1572869, 3145739, 6291469,
+			12582917, 25165843, 50331653, 100663319, 201326611, 402653189,
+			805306457, 1610612741
+		};
+		for (size_t p: primes) {
+			if (p >= n) {return p; }
+		}
+		return primes[sizeof(primes) / sizeof(primes[0]) - 1];
+	}
+	static size_t grow(size_t n) {return round(n * 2); }
+	/**
+	 * Lemire's fastmod: a % d == ((M * a) mod 2^64) * d >> 64 with
+	 * M = 2^64 / d + 1, exact for 32-bit a and d
+	*/
+	struct bucketer{
+		unsigned long long m;
+		unsigned int d;
+		explicit bucketer(size_t count = 5): m(~0ull / count + 1), d((unsigned int)count) {}
+		size_t operator()(size_t h) const {
+			unsigned int a = (unsigned int)(h ^ (h >> 32));
+			return size_t(((unsigned __int128)(m * a) * d) >> 64);
+		}
+	};
+};
+
+/**
+ * whether nodes keep the full hash of their key.
+ * on by default for non-scalar keys (strings, user types), whose Hash
+ * and Equal may be costly; specialise it to opt a key type in or out.
+*/
+template<class Key, class Hash> struct cache_hash_code{
+	static const bool value = !std::is_scalar<Key>::value;
+};
+template<> struct cache_hash_code<Integer, ::Hash>{
+	static const bool value = false;  // an int compare is cheaper than the extra word
+};
+
+/**
+ * base of the index nodes holding the cached hash, if any.
+ * same_hash() rejects most non-equal keys without calling Equal and
+ * hash_of() lets a rehash reuse the stored value; the uncached
+ * version is empty and falls back to Equal / Hash.
+*/
+template<bool Cached> struct hash_slot{
+	size_t hash = 0;
+	void keep_hash(size_t h) {hash = h; }
+	bool same_hash(size_t h) const {return hash == h; }
+	template<class H, class K> size_t hash_of(const H &, const K &) const {return hash; }
+};
+template<> struct hash_slot<false>{
+	void keep_hash(size_t) {}
+	bool same_hash(size_t) const {return true; }
+	template<class H, class K> size_t hash_of(const H &h, const K &key) const {return h(key); }
+};
+
+/**
+ * intrusive chained hash index.
+ * the nodes are owned by someone else and linked through their own
+ * `chain` pointer; the index only keeps the bucket heads, so linking,
+ * unlinking and expanding never allocate a node and never move one
+ * (pointers to nodes stay valid across a resize).
+ * Node must have `item.first` (the key) and `Node *chain`, and derive
+ * from hash_slot; Policy maps hashes to buckets (see the hash policies
+ * above).
+ *
+ * with incremental rehash on, growing only allocates the new table;
+ * the old one stays live and every link/unlink migrates the next
+ * migrateBy old buckets: migrateStep, or more when a low max load
+ * leaves fewer inserts until the next resize, so the old table is
+ * always drained by then and no single insert pays for the whole
+ * table.  while both tables are live, find/unlink check the old
+ * bucket first: old[i] == moved() means bucket i has been migrated.
+ * with a splitting policy only then are new buckets i and i + oldSize
+ * in use (a key of old bucket i can only land in one of them), so the
+ * new table is cleared piecewise; otherwise it is cleared up front.
+*/
+template<
+	class Node,
+	class Key,
+	class Hash = std::hash<Key>,
+	class Equal = std::equal_to<Key>,
+	class Alloc = std::allocator<Node*>,
+	class Policy = pow2_hash_policy
+> class chain_index{
+	using bucketer = typename Policy::bucketer;
+	using bucket_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<Node*>;
+	using bucket_traits = std::allocator_traits<bucket_allocator>;
+public:
+	Node **buckets = nullptr;  // current table
+	Node **old = nullptr;  // table being drained, nullptr if not resizing
+	size_t size, curL;  // capacity and current load
+	size_t oldSize = 0, migrated = 0;  // size of old and next old bucket to migrate
+	size_t migrateBy = 0;  // old buckets migrated per link/unlink
+	bool incremental = false;
+	double maxLoad = 0.5;  // grow once curL exceeds maxLoad * size
+	bucketer at, oldAt;  // bucket of a hash in buckets / in old
+	bucket_allocator alloc;
+	static const size_t migrateStep = 4;
+	mutable stat_counter finds, probes;
+	stat_counter resizes, resizeNs;
+// --------------------------
+
+	explicit chain_index(size_t s = 1024, const Alloc &a = Alloc()): size(Policy::round(s)), curL(0), at(size), alloc(a) {
+		buckets = allocate(size);
+		for (size_t i = 0; i < size; ++i) {buckets[i] = nullptr; }
+	}
+	chain_index(const chain_index &other) = delete;
+	chain_index & operator=(const chain_index &other) = delete;
+	~chain_index() {
+		deallocate(buckets, size);
+		if (old != nullptr) {deallocate(old, oldSize); }
+	}
+
+	/**
+	 * forget every node (they are not freed)
+	*/
+	void clear() {
+		if (old != nullptr) {
+			deallocate(old, oldSize);
+			old = nullptr;
+		}
+		for (size_t i = 0; i < size; ++i) {buckets[i] = nullptr; }
+		curL = 0;
+	}
+	/**
+	 * return the node with the key, or nullptr
+	*/
+	Node *find(const Key &key) const {
+		Equal equal;
+		size_t h = Hash()(key);
+		size_t seen = 0;
+		Node *cur = head(h);
+		for (; cur != nullptr; cur = cur->chain) {
+			++seen;
+			if (cur->same_hash(h) && equal(cur->item.first, key)) {break; }
+		}
+		finds.add();
+		probes.add(seen);
+		return cur;
+	}
+	/**
+	 * link a node whose key is not in the index yet
+	*/
+	void link(Node *node) {
+		if (++curL > size_t(maxLoad * size)) {
+			if (incremental) {
+				start_resize();
+			} else {
+				expand();
+			}
+		}
+		size_t h = Hash()(node->item.first);
+		node->keep_hash(h);
+		Node *&first = head(h);
+		node->chain = first;
+		first = node;
+		migrate(migrateBy);
+	}
+	void unlink(Node *node) {
+		Node **cur = &head(hash_of(node));
+		while (*cur != nullptr && *cur != node) {cur = &(*cur)->chain; }
+		if (*cur == nullptr) {return; }
+		*cur = node->chain;
+		node->chain = nullptr;
+		--curL;
+		migrate(migrateBy);
+	}
+	/**
+	 * double the bucket array and relink every node into it at once
+	*/
+	void expand() {
+		finish_resize();
+		stat_timer timer(resizeNs);
+		resizes.add();
+		relink(Policy::grow(size));
+	}
+	/**
+	 * use at least n buckets (more if the current load needs them);
+	 * existing nodes are relinked, nothing is allocated but the table
+	*/
+	void rehash(size_t n) {
+		finish_resize();
+		stat_timer timer(resizeNs);
+		resizes.add();
+		size_t need = size_t(curL / maxLoad) + 1;
+		relink(n > need ? n : need);
+	}
+	/**
+	 * make room for n elements without any further resize
+	*/
+	void reserve(size_t n) {
+		if (size_t(n / maxLoad) >= size) {rehash(size_t(n / maxLoad) + 1); }
+	}
+	double max_load_factor() const {
+		return maxLoad;
+	}
+	/**
+	 * throws runtime_error unless ml > 0 (so not for nan); kept within
+	 * [1/64, 64] so that the bucket counts it implies stay finite
+	*/
+	void max_load_factor(double ml) {
+		if (!(ml > 0)) {throw runtime_error(); }
+		maxLoad = ml < 1.0 / 64 ? 1.0 / 64 : ml > 64 ? 64 : ml;
+		if (curL > size_t(maxLoad * size)) {rehash(0); }
+	}
+	double load_factor() const {
+		return double(curL) / size;
+	}
+	/**
+	 * switch incremental rehash on or off;
+	 * switching it off completes a resize in progress
+	*/
+	void set_incremental(bool on) {
+		if (!on) {finish_resize(); }
+		incremental = on;
+	}
+	bool resizing() const {
+		return old != nullptr;
+	}
+	/**
+	 * shape and counters of the index (node_bytes left to the owner)
+	*/
+	table_stats stats() const {
+		table_stats st;
+		st.elements = curL;
+		st.buckets = size;
+		for (size_t b = 0; b < oldSize && old != nullptr; ++b) {
+			if (old[b] != moved()) {count_chain(old[b], st); }
+		}
+		for (size_t b = 0; b < size; ++b) {
+			if (ready(b)) {count_chain(buckets[b], st); }
+		}
+		st.finds = finds.get();
+		st.probes = probes.get();
+		st.resizes = resizes.get();
+		st.resize_ns = resizeNs.get();
+		st.bucket_bytes = (size + (old != nullptr ? oldSize : 0)) * sizeof(Node *);
+		return st;
+	}
+
+	/**
+	 * iteration: old table (unmigrated buckets) first, then the new one
+	*/
+	Node *first() const {
+		return old != nullptr ? scan(true, 0) : scan(false, 0);
+	}
+	Node *next(const Node *node) const {
+		if (node->chain != nullptr) {return node->chain; }
+		size_t h = hash_of(node);
+		if (old != nullptr && old[oldAt(h)] != moved()) {return scan(true, oldAt(h) + 1); }
+		return scan(false, at(h) + 1);
+	}
+
+private:
+	static size_t hash_of(const Node *node) {
+		return node->hash_of(Hash(), node->item.first);
+	}
+	static Node *moved() {
+		return reinterpret_cast<Node *>(alignof(Node));
+	}
+	static void count_chain(const Node *cur, table_stats &st) {
+		size_t len = 0;
+		for (; cur != nullptr; cur = cur->chain) {++len; }
+		if (len == 0) {return; }
+		++st.chains;
+		st.chain_total += len;
+		if (len > st.max_chain) {st.max_chain = len; }
+	}
+	Node **allocate(size_t n) {
+		return bucket_traits::allocate(alloc, n);
+	}
+	void deallocate(Node **table, size_t n) {
+		bucket_traits::deallocate(alloc, table, n);
+	}
+	void relink(size_t new_size) {
+		new_size = Policy::round(new_size);
+		bucketer new_at(new_size);
+		Node **new_buckets = allocate(new_size);
+		for (size_t i = 0; i < new_size; ++i) {new_buckets[i] = nullptr; }
+		for (size_t i = 0; i < size; ++i) {
+			for (Node *cur = buckets[i], *nxt; cur != nullptr; cur = nxt) {
+				nxt = cur->chain;
+				Node *&first = new_buckets[new_at(hash_of(cur))];
+				cur->chain = first;
+				first = cur;
+			}
+		}
+		deallocate(buckets, size);
+		buckets = new_buckets;
+		size = new_size;
+		at = new_at;
+	}
+	Node *&head(size_t h) const {
+		if (old != nullptr && old[oldAt(h)] != moved()) {return old[oldAt(h)]; }
+		return buckets[at(h)];
+	}
+	bool ready(size_t b) const {
+		return old == nullptr || !Policy::splits || old[b % oldSize] == moved();
+	}
+	Node *scan(bool inOld, size_t b) const {
+		if (inOld) {
+			for (; b < oldSize; ++b) {
+				if (old[b] != moved() && old[b] != nullptr) {return old[b]; }
+			}
+			b = 0;
+		}
+		for (; b < size; ++b) {
+			if (ready(b) && buckets[b] != nullptr) {return buckets[b]; }
+		}
+		return nullptr;
+	}
+	/**
+	 * keep the current table as `old` and start filling a new one;
+	 * with a splitting policy the new table is left uninitialised and
+	 * each pair of buckets is cleared when its old bucket migrates
+	*/
+	void start_resize() {
+		finish_resize();
+		stat_timer timer(resizeNs);
+		resizes.add();
+		old = buckets;
+		oldSize = size;
+		oldAt = at;
+		size = Policy::grow(size);
+		at = bucketer(size);
+		buckets = allocate(size);
+		if (!Policy::splits) {
+			for (size_t i = 0; i < size; ++i) {buckets[i] = nullptr; }
+		}
+		migrated = 0;
+		// done within the inserts left before the load reaches the next limit
+		size_t limit = size_t(maxLoad * size);
+		size_t room = limit > curL ? limit - curL : 1;
+		migrateBy = oldSize / room + 1 > migrateStep ? oldSize / room + 1 : migrateStep;
+	}
+	void migrate_bucket(size_t b) {
+		if (Policy::splits) {
+			buckets[b] = nullptr;
+			buckets[b + oldSize] = nullptr;
+		}
+		for (Node *cur = old[b], *nxt; cur != nullptr; cur = nxt) {
+			nxt = cur->chain;
+			Node *&first = buckets[at(hash_of(cur))];
+			cur->chain = first;
+			first = cur;
+		}
+		old[b] = moved();
+	}
+	void migrate(size_t steps) {
+		if (old == nullptr) {return; }
+		for (; steps > 0 && migrated < oldSize; --steps) {migrate_bucket(migrated++); }
+		if (migrated == oldSize) {
+			deallocate(old, oldSize);
+			old = nullptr;
+		}
+	}
+	void finish_resize() {
+		migrate(oldSize);
+	}
 };
 
 template<
 	class Key,
 	class T,
 	class Hash = std::hash<Key>, 
-	class Equal = std::equal_to<Key>
+	class Equal = std::equal_to<Key>,
+	class Alloc = std::allocator<pair<const Key, T> >,
+	class Policy = pow2_hash_policy
 > class hashmap{
 public:
 	using value_type = pair<const Key, T>;
+	using allocator_type = Alloc;
+	struct Node: hash_slot<cache_hash_code<Key, Hash>::value>{
+		value_type item;
+		Node *chain = nullptr;  // next node in the same bucket
+		template<class... Args>
+		explicit Node(Args &&... args): item(std::forward<Args>(args)...) {}
+	};
+	using node_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<Node>;
+	using node_traits = std::allocator_traits<node_allocator>;
+	using index_type = chain_index<Node, Key, Hash, Equal, Alloc, Policy>;
 
-	std::vector<double_list<value_type>* > vec;
-	size_t size, curL;  // capacity and current load
-	static double loadFactor;
+	node_allocator alloc;
+	index_type index;
 // --------------------------
 
-	hashmap(size_t s = 1024): size(s), curL(0) {
-		vec.resize(size, nullptr);
+	explicit hashmap(size_t s = 1024, const Alloc &a = Alloc()): alloc(a), index(s, a) {
 	}
-	hashmap(const hashmap &other): size(other.size), curL(other.curL) {
-		vec.resize(other.vec.size(), nullptr);
-		for (size_t i = 0; i < other.vec.size(); ++i) {
-			if (other.vec[i]) {
-				vec[i] = new double_list<value_type>(*other.vec[i]);
-			}
-		}
+	hashmap(const hashmap &other)
+		: alloc(node_traits::select_on_container_copy_construction(other.alloc)),
+		  index(other.index.size, Alloc(alloc)) {
+		index.set_incremental(other.index.incremental);
+		index.maxLoad = other.index.maxLoad;
+		copy_from(other);
 	}
 	~hashmap(){
 		clear();
@@ -357,57 +886,49 @@ public:
 		if (this == &other) {return *this; }
 		clear();
 		//innerflag();
-		vec.resize(other.vec.size(), nullptr);
-		for (size_t i = 0; i < other.vec.size(); ++i) {
-			if (other.vec[i]) {
-				vec[i] = new double_list<value_type>(*other.vec[i]);
-			}
-		}
-		size = other.size;
-		curL = other.curL;
+		index.maxLoad = other.index.maxLoad;
+		copy_from(other);
 		return *this;
 	}
 
 	class iterator{
 	public:
-		// using VI = typename std::vector<double_list<value_type>* >::iterator;  // to iterate vec
-		using EI = typename double_list<value_type>::iterator;  // to iterate element in each vec-->list
-		using CVI = typename std::vector<double_list<value_type>* >::const_iterator;
-		CVI vecIt, vecEnd;
-		EI eleIt;
-		void moveNextList() {
-			while (vecIt != vecEnd && eleIt == (*vecIt)->end()) {
-				++vecIt;
-				if (vecIt != vecEnd) {
-					eleIt = (*vecIt)->begin();
-				}
-			}
-		}
+		const index_type *idx = nullptr;
+		Node *node = nullptr;
 	public:
-		iterator(const CVI v1, const CVI ve, const EI e): vecIt(v1), vecEnd(ve), eleIt(e) {
-			moveNextList();
+		iterator(const index_type *i = nullptr, Node *n = nullptr): idx(i), node(n) {
 		}
-		iterator(const iterator &t): vecIt(t.vecIt), vecEnd(t.vecEnd), eleIt(t.eleIt) {
+		iterator(const iterator &t): idx(t.idx), node(t.node) {
 		}
 		~iterator(){}
 
+		iterator operator++(int) {
+			iterator cur = *this;
+			++*this;
+			return cur;
+		}
+		iterator &operator++() {
+			if (node == nullptr) {throw index_out_of_bound(); }
+			node = idx->next(node);
+			return *this;
+		}
         /**
 		 * if point to nothing
 		 * throw 
 		*/
 		value_type &operator*() const {
-			if (eleIt == nullptr) {throw invalid_iterator(); }
-			return *eleIt;
+			if (node == nullptr) {throw invalid_iterator(); }
+			return node->item;
 		}
 
         /**
 		 * other operation
 		*/
 		value_type *operator->() const noexcept {
-			return &(*eleIt);
+			return &(node->item);
 		}
 		bool operator==(const iterator &rhs) const {
-			return vecIt == rhs.vecIt && (vecIt == vecEnd || eleIt == rhs.eleIt);
+			return node == rhs.node;
     	}
 		bool operator!=(const iterator &rhs) const {
 			return !(*this == rhs);
@@ -415,69 +936,74 @@ public:
 	};
 
 	void print() {
-		for (auto v: vec) {
-			if (v != nullptr) {
-				//std::cout << "notNULL" << std::endl;
-				v->print();
-			}
+		for (iterator it = begin(); it != end(); ++it) {
+			std::cout << it->first << " " << it->second << std::endl;
 		}
 	}
 
 	void clear(){
 		//std::cout << "hashmap_clear" << std::endl;
-		int cnt = 0;
-		for (auto& v: vec) {
-			//std::cout << ++cnt << std::endl;
-			delete v;
-			v = nullptr;
+		for (Node *cur = index.first(), *nxt; cur != nullptr; cur = nxt) {
+			nxt = index.next(cur);
+			destroy_node(cur);
 		}
-		curL = 0;
+		index.clear();
 	}
 	/**
 	 * you need to expand the hashmap dynamically
 	*/
 	void expand(){
-		//std::cout << "hashmap_expand" << std::endl;
-		size_t new_size = size * 2;
-		std::vector<double_list<value_type>* > new_vec(new_size, nullptr);
-		// rehash
-		Hash hash;
-		for (auto cur: vec) {  // cur(dbly_lst<value_type>*)
-			for (auto node = cur?cur->head:nullptr; node != nullptr; node = node->next) {
-				size_t index = hash(node->item.first) % new_size;
-				if (new_vec[index] == nullptr) {new_vec[index] = new double_list<value_type>(); }
-				new_vec[index]->insert_tail(node->item);
-				//innerflag();
-			}
-			delete cur;
-			cur = nullptr;
-		}
-		vec = std::move(new_vec);
-		size = new_size;
+		index.expand();
+	}
+	/**
+	 * spread resizes over the following inserts/removes instead of
+	 * rehashing everything inside one insert (see chain_index)
+	*/
+	void incremental_rehash(bool on) {
+		index.set_incremental(on);
+	}
+	/**
+	 * capacity control, see chain_index
+	*/
+	void reserve(size_t n) {
+		index.reserve(n);
+	}
+	void rehash(size_t buckets) {
+		index.rehash(buckets);
+	}
+	double max_load_factor() const {
+		return index.max_load_factor();
+	}
+	void max_load_factor(double ml) {
+		index.max_load_factor(ml);
+	}
+	double load_factor() const {
+		return index.load_factor();
+	}
+	size_t bucket_count() const {
+		return index.size;
+	}
+	table_stats stats() const {
+		table_stats st = index.stats();
+		st.node_bytes = index.curL * sizeof(Node);
+		return st;
 	}
 
+	iterator begin() const{
+		return iterator(&index, index.first());
+	}
     /**
      * the iterator point at nothing
     */
 	iterator end() const{
-		//std::cout << "hashmap_end" << std::endl;
-		return iterator(vec.end(), vec.end(), vec.size()>0?(vec.back()?vec.back()->end():nullptr):nullptr);
+		return iterator(&index, nullptr);
 	}
 	/**
 	 * find, return a pointer point to the value
 	 * not find, return the end (point to nothing)
 	*/
 	iterator find(const Key &key)const{
-		//std::cout << "hashmap_find" << std::endl;
-		Hash hash;
-		size_t index = hash(key) % size;
-		for (auto curp = vec[index]?vec[index]->head:nullptr; curp != nullptr; curp = curp->next) {  // current pair (dbly_lst<value_type>*)
-			//innerflag();
-			Equal equal;
-			if (equal(curp->item.first, key)) {return iterator(vec.begin() + index, vec.end(), typename double_list<value_type>::iterator(curp)); }
-		}
-		//innerflag();
-		return end();
+		return iterator(&index, index.find(key));
 	}
 	/**
 	 * already have a value_pair with the same key
@@ -486,64 +1012,598 @@ public:
 	 * -> insert the value_pair, return true
 	*/
 	sjtu::pair<iterator,bool> insert(const value_type &value_pair){
-		//std::cout << "hashmap_insert" << std::endl;
-		//std::cout << curL << std::endl;
+		return insert_or_assign(value_pair.first, value_pair.second);
+	}
+	sjtu::pair<iterator,bool> insert(value_type &&value_pair){
+		return insert_or_assign(value_pair.first, std::move(value_pair.second));
+	}
+	/**
+	 * like insert, but the value is assigned from / built out of obj
+	 * directly, without a value_type in between
+	*/
+	template<class M>
+	sjtu::pair<iterator,bool> insert_or_assign(const Key &key, M &&obj){
+		return assign(key, std::forward<M>(obj));
+	}
+	template<class M>
+	sjtu::pair<iterator,bool> insert_or_assign(Key &&key, M &&obj){
+		return assign(std::move(key), std::forward<M>(obj));
+	}
+	/**
+	 * if the key is absent, build the value in place from args and
+	 * return true; otherwise leave everything (args too) untouched
+	 * and return false
+	*/
+	template<class... Args>
+	sjtu::pair<iterator,bool> try_emplace(const Key &key, Args &&... args){
+		return emplace_key(key, std::forward<Args>(args)...);
+	}
+	template<class... Args>
+	sjtu::pair<iterator,bool> try_emplace(Key &&key, Args &&... args){
+		return emplace_key(std::move(key), std::forward<Args>(args)...);
+	}
+	/**
+	 * build a value_type from args in its node; if the key is already
+	 * there the new node is dropped and the old value kept
+	*/
+	template<class... Args>
+	sjtu::pair<iterator,bool> emplace(Args &&... args){
+		Node *node = create_node(std::forward<Args>(args)...);
+		Node *found = index.find(node->item.first);
+		if (found != nullptr) {
+			destroy_node(node);
+			return sjtu::pair<iterator, bool>(iterator(&index, found), false);
+		}
+		index.link(node);
+		return sjtu::pair<iterator, bool>(iterator(&index, node), true);
+	}
+	/**
+	 * the value_pair exists, remove and return true
+	 * otherwise, return false
+	*/
+	bool remove(const Key &key){
+		Node *node = index.find(key);
+		if (node == nullptr) {return false; }
+		index.unlink(node);
+		destroy_node(node);
+		return true;
+	}
 
-		Hash hash;
-		iterator f(find(value_pair.first));
-		//innerflag();
-		if (f != end()) {
+	allocator_type get_allocator() const {
+		return allocator_type(alloc);
+	}
+
+private:
+	template<class K, class M>
+	sjtu::pair<iterator,bool> assign(K &&key, M &&obj) {
+		Node *node = index.find(key);
+		if (node != nullptr) {
 			// update
-			f.eleIt.it->item.second = value_pair.second;
-			return sjtu::pair<iterator, bool>(f, false);
+			node->item.second = std::forward<M>(obj);
+			return sjtu::pair<iterator, bool>(iterator(&index, node), false);
 		}
 		// insert
-		if (++curL > size_t(loadFactor * size)) {expand(); }
-		size_t index = hash(value_pair.first) % size;
-		if (vec[index] == nullptr) {
-			vec[index] = new double_list<value_type>();
+		node = create_node(std::forward<K>(key), std::forward<M>(obj));
+		index.link(node);
+		return sjtu::pair<iterator, bool>(iterator(&index, node), true);
+	}
+	template<class K, class... Args>
+	sjtu::pair<iterator,bool> emplace_key(K &&key, Args &&... args) {
+		Node *node = index.find(key);
+		if (node != nullptr) {return sjtu::pair<iterator, bool>(iterator(&index, node), false); }
+		node = create_node(std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+			std::forward_as_tuple(std::forward<Args>(args)...));
+		index.link(node);
+		return sjtu::pair<iterator, bool>(iterator(&index, node), true);
+	}
+	void copy_from(const hashmap &other) {
+		for (Node *cur = other.index.first(); cur != nullptr; cur = other.index.next(cur)) {
+			index.link(create_node(cur->item));
+		}
+	}
+	template<class... Args>
+	Node *create_node(Args &&... args) {
+		Node *node = node_traits::allocate(alloc, 1);
+		try {
+			node_traits::construct(alloc, node, std::forward<Args>(args)...);
+		} catch (...) {
+			node_traits::deallocate(alloc, node, 1);
+			throw;
+		}
+		return node;
+	}
+	void destroy_node(Node *node) {
+		node_traits::destroy(alloc, node);
+		node_traits::deallocate(alloc, node, 1);
+	}
+};
+
+/**
+ * group scan kernels for the control bytes of flat_hashmap.
+ * scan() sets bit i of match when ctrl[i] == tag and bit i of empty
+ * when ctrl[i] is ctrl_empty, for every i in [0, width).
+ * the best one is picked once at runtime from cpuid, so the same
+ * binary runs on any x86-64 box (and falls back to scalar elsewhere).
+*/
+const unsigned char ctrl_empty = 0x80;
+const unsigned int ctrl_clone = 32;  // widest group, mirrored after the last slot
+
+struct scalar_group{
+	static const unsigned int width = 16;
+	static void scan(const unsigned char *ctrl, unsigned char tag, unsigned int &match, unsigned int &empty) {
+		match = 0, empty = 0;
+		for (unsigned int i = 0; i < width; ++i) {
+			match |= (unsigned int)(ctrl[i] == tag) << i;
+			empty |= (unsigned int)(ctrl[i] == ctrl_empty) << i;
+		}
+	}
+};
+#ifdef SJTU_X86_GROUPS
+struct sse2_group{
+	static const unsigned int width = 16;
+	static void scan(const unsigned char *ctrl, unsigned char tag, unsigned int &match, unsigned int &empty) {
+		__m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl));
+		match = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(char(tag))));
+		empty = (unsigned int)_mm_movemask_epi8(group);  // only ctrl_empty has the top bit
+	}
+};
+struct avx2_group{
+	static const unsigned int width = 32;
+	__attribute__((target("avx2")))
+	static void scan(const unsigned char *ctrl, unsigned char tag, unsigned int &match, unsigned int &empty) {
+		__m256i group = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ctrl));
+		match = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(group, _mm256_set1_epi8(char(tag))));
+		empty = (unsigned int)_mm256_movemask_epi8(group);
+	}
+};
+#endif
+
+enum class group_kernel {scalar, sse2, avx2};
+
+inline group_kernel detect_group_kernel() {
+#ifdef SJTU_X86_GROUPS
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {return group_kernel::avx2; }
+	return group_kernel::sse2;
+#else
+	return group_kernel::scalar;
+#endif
+}
+inline group_kernel probe_kernel() {
+	static const group_kernel kernel = detect_group_kernel();
+	return kernel;
+}
+
+/**
+ * open-addressing counterpart of hashmap (Robin Hood linear probing).
+ * all elements live in one flat slot array, dist[i] keeps the probe
+ * distance of slot i plus one (0 means the slot is empty).
+ * remove shifts the rest of the probe run one step back, so no
+ * tombstones are ever left behind.
+ * ctrl[i] holds 7 bits of the hash of slot i (or ctrl_empty); lookups
+ * compare a whole group of them at once and only call Equal on tag
+ * matches, so a miss usually costs a single cache line.
+ * with cache_hash_code the full hash is kept in `hashes` as well, to
+ * filter tag collisions and to resize without calling Hash.
+ * find/insert/remove/iterator behave like hashmap's, except that
+ * insert and remove may move other elements (iterators invalidated).
+*/
+template<
+	class Key,
+	class T,
+	class Hash = std::hash<Key>,
+	class Equal = std::equal_to<Key>
+> class flat_hashmap{
+public:
+	using value_type = pair<const Key, T>;
+
+	value_type *slots = nullptr;
+	unsigned int *dist = nullptr;  // probe distance + 1, 0 for empty
+	unsigned char *ctrl = nullptr;  // hash tag or ctrl_empty, size + ctrl_clone bytes
+	unsigned long long *hashes = nullptr;  // mixed hash of every slot, only if cached
+	size_t size, curL;  // capacity (power of two) and current load
+	unsigned int shift;  // 64 - log2(size), for fibonacci hashing
+	group_kernel kernel;
+	double maxLoad = 0.875;  // grow once curL exceeds maxLoad * size
+	static const bool cached = cache_hash_code<Key, Hash>::value;
+	mutable stat_counter finds, probes;  // probes: ctrl groups scanned
+	stat_counter resizes, resizeNs;
+// --------------------------
+
+	flat_hashmap(size_t s = 1024): size(ctrl_clone), curL(0), kernel(probe_kernel()) {
+		while (size < s) {size <<= 1; }
+		allocate();
+	}
+	flat_hashmap(const flat_hashmap &other): size(other.size), curL(0), kernel(other.kernel), maxLoad(other.maxLoad) {
+		allocate();
+		copy_from(other);
+	}
+	~flat_hashmap(){
+		clear();
+		release();
+	}
+	flat_hashmap & operator=(const flat_hashmap &other){
+		if (this == &other) {return *this; }
+		clear();
+		release();
+		size = other.size;
+		maxLoad = other.maxLoad;
+		allocate();
+		copy_from(other);
+		return *this;
+	}
+
+	class iterator{
+	public:
+		const flat_hashmap *map = nullptr;
+		size_t pos = 0;
+		void moveNextSlot() {
+			while (map != nullptr && pos < map->size && map->dist[pos] == 0) {++pos; }
+		}
+	public:
+		iterator(const flat_hashmap *m = nullptr, size_t p = 0): map(m), pos(p) {
+			moveNextSlot();
+		}
+		iterator(const iterator &t): map(t.map), pos(t.pos) {}
+		~iterator(){}
+
+		iterator operator++(int) {
+			iterator cur = *this;
+			++*this;
+			return cur;
+		}
+		iterator &operator++() {
+			if (map == nullptr || pos >= map->size) {throw index_out_of_bound(); }
+			++pos;
+			moveNextSlot();
+			return *this;
+		}
+        /**
+		 * if point to nothing
+		 * throw 
+		*/
+		value_type &operator*() const {
+			if (map == nullptr || pos >= map->size) {throw invalid_iterator(); }
+			return map->slots[pos];
+		}
+		value_type *operator->() const noexcept {
+			return map->slots + pos;
+		}
+		bool operator==(const iterator &rhs) const {
+			return map == rhs.map && pos == rhs.pos;
+		}
+		bool operator!=(const iterator &rhs) const {
+			return !(*this == rhs);
+		}
+	};
+
+	void print() {
+		for (size_t i = 0; i < size; ++i) {
+			if (dist[i] != 0) {
+				std::cout << slots[i].first << " " << slots[i].second << std::endl;
+			}
+		}
+	}
+
+	void clear(){
+		for (size_t i = 0; i < size; ++i) {
+			if (dist[i] != 0) {
+				slots[i].~value_type();
+				dist[i] = 0;
+			}
 		}
-		vec[index]->insert_tail(value_pair);
-		return sjtu::pair<iterator, bool>(iterator(vec.begin() + index, vec.end(), vec[index]->back()), true);
+		std::memset(ctrl, ctrl_empty, size + ctrl_clone);
+		curL = 0;
+	}
+	/**
+	 * double the slot array and re-place every element
+	*/
+	void expand(){
+		resize(size * 2);
+	}
+	/**
+	 * use at least n slots (rounded up to a power of two, and more if
+	 * the current load needs them)
+	*/
+	void rehash(size_t n) {
+		size_t new_size = ctrl_clone;
+		while (new_size < n || curL > size_t(maxLoad * new_size)) {new_size <<= 1; }
+		resize(new_size);
+	}
+	/**
+	 * make room for n elements without any further resize
+	*/
+	void reserve(size_t n) {
+		if (n > size_t(maxLoad * size)) {rehash(size_t(n / maxLoad) + 1); }
+	}
+	double max_load_factor() const {
+		return maxLoad;
+	}
+	/**
+	 * throws runtime_error unless ml > 0 (so not for nan); kept within
+	 * [1/64, 0.99], as at least one empty slot must remain
+	*/
+	void max_load_factor(double ml) {
+		if (!(ml > 0)) {throw runtime_error(); }
+		maxLoad = ml < 1.0 / 64 ? 1.0 / 64 : ml < 0.99 ? ml : 0.99;
+		if (curL > size_t(maxLoad * size)) {rehash(0); }
+	}
+	double load_factor() const {
+		return double(curL) / size;
+	}
+	size_t bucket_count() const {
+		return size;
+	}
+	/**
+	 * a chain here is a probe run: element i is found after dist[i]
+	 * slots, so chains are elements and chain lengths probe lengths
+	*/
+	table_stats stats() const {
+		table_stats st;
+		st.elements = st.chains = curL;
+		st.buckets = size;
+		for (size_t i = 0; i < size; ++i) {
+			st.chain_total += dist[i];
+			if (dist[i] > st.max_chain) {st.max_chain = dist[i]; }
+		}
+		st.finds = finds.get();
+		st.probes = probes.get();
+		st.resizes = resizes.get();
+		st.resize_ns = resizeNs.get();
+		st.node_bytes = size * sizeof(value_type);
+		st.bucket_bytes = size * sizeof(unsigned int) + size + ctrl_clone + (cached ? size * sizeof(unsigned long long) : 0);
+		return st;
+	}
+
+	iterator end() const{
+		return iterator(this, size);
+	}
+	iterator find(const Key &key)const{
+		return iterator(this, locate(key));
+	}
+	/**
+	 * already have a value_pair with the same key
+	 * -> just update the value, return false
+	 * not find a value_pair with the same key
+	 * -> insert the value_pair, return true
+	*/
+	sjtu::pair<iterator,bool> insert(const value_type &value_pair){
+		return insert_or_assign(value_pair.first, value_pair.second);
+	}
+	sjtu::pair<iterator,bool> insert(value_type &&value_pair){
+		return insert_or_assign(value_pair.first, std::move(value_pair.second));
+	}
+	/**
+	 * see hashmap; the element is built once and then moved into its
+	 * slot (and around later, as Robin Hood placement requires)
+	*/
+	template<class M>
+	sjtu::pair<iterator,bool> insert_or_assign(const Key &key, M &&obj){
+		size_t index = locate(key);
+		if (index != size) {
+			slots[index].second = std::forward<M>(obj);
+			return sjtu::pair<iterator, bool>(iterator(this, index), false);
+		}
+		if (++curL > size_t(maxLoad * size)) {expand(); }
+		index = place(value_type(key, std::forward<M>(obj)), mix(key));
+		return sjtu::pair<iterator, bool>(iterator(this, index), true);
+	}
+	template<class... Args>
+	sjtu::pair<iterator,bool> try_emplace(const Key &key, Args &&... args){
+		size_t index = locate(key);
+		if (index != size) {return sjtu::pair<iterator, bool>(iterator(this, index), false); }
+		if (++curL > size_t(maxLoad * size)) {expand(); }
+		index = place(value_type(std::piecewise_construct, std::forward_as_tuple(key),
+			std::forward_as_tuple(std::forward<Args>(args)...)), mix(key));
+		return sjtu::pair<iterator, bool>(iterator(this, index), true);
 	}
 	/**
 	 * the value_pair exists, remove and return true
 	 * otherwise, return false
 	*/
 	bool remove(const Key &key){
-		iterator f(find(key));
-		if (f == end()) {return false; }
-		size_t index = std::distance(vec.cbegin(), f.vecIt);
-		if (vec[index] == nullptr) {return false; }
-
-		vec[index]->erase(f.eleIt);
-		if (vec[index]->empty()) {
-			delete vec[index];
-			vec[index] = nullptr;
-		}
-		
+		size_t index = locate(key);
+		if (index == size) {return false; }
+		slots[index].~value_type();
+		// backward shift: pull the rest of the run one slot closer to home
+		size_t next = (index + 1) & (size - 1);
+		while (dist[next] > 1) {
+			new (slots + index) value_type(std::move(slots[next]));
+			slots[next].~value_type();
+			dist[index] = dist[next] - 1;
+			set_ctrl(index, ctrl[next]);
+			if (cached) {hashes[index] = hashes[next]; }
+			index = next;
+			next = (next + 1) & (size - 1);
+		}
+		dist[index] = 0;
+		set_ctrl(index, ctrl_empty);
 		--curL;
-		curL = curL < 0? 0: curL;
 		return true;
 	}
+
+private:
+	void resize(size_t new_size) {
+		stat_timer timer(resizeNs);
+		resizes.add();
+		value_type *old_slots = slots;
+		unsigned int *old_dist = dist;
+		unsigned char *old_ctrl = ctrl;
+		unsigned long long *old_hashes = hashes;
+		size_t old_size = size;
+		size = new_size;
+		allocate();
+		for (size_t i = 0; i < old_size; ++i) {
+			if (old_dist[i] != 0) {
+				place(std::move(old_slots[i]), cached ? old_hashes[i] : mix(old_slots[i].first));
+				old_slots[i].~value_type();
+			}
+		}
+		::operator delete(old_slots);
+		delete [] old_dist;
+		delete [] old_ctrl;
+		delete [] old_hashes;
+	}
+	void allocate() {
+		shift = 64;
+		for (size_t s = size; s > 1; s >>= 1) {--shift; }
+		slots = static_cast<value_type*>(::operator new(size * sizeof(value_type)));
+		dist = new unsigned int[size]();
+		ctrl = new unsigned char[size + ctrl_clone];
+		std::memset(ctrl, ctrl_empty, size + ctrl_clone);
+		if (cached) {hashes = new unsigned long long[size]; }
+	}
+	void release() {
+		::operator delete(slots);
+		delete [] dist;
+		delete [] ctrl;
+		delete [] hashes;
+		slots = nullptr;
+		dist = nullptr;
+		ctrl = nullptr;
+		hashes = nullptr;
+	}
+	void copy_from(const flat_hashmap &other) {
+		for (size_t i = 0; i < size; ++i) {
+			if (other.dist[i] != 0) {
+				new (slots + i) value_type(other.slots[i]);
+			}
+			dist[i] = other.dist[i];
+		}
+		std::memcpy(ctrl, other.ctrl, size + ctrl_clone);
+		if (cached) {std::memcpy(hashes, other.hashes, size * sizeof(unsigned long long)); }
+		curL = other.curL;
+	}
+	/**
+	 * the top log2(size) bits pick the home slot, the 7 bits right
+	 * below them are the tag kept in ctrl
+	*/
+	unsigned long long mix(const Key &key) const {
+		Hash hash;
+		return (unsigned long long)hash(key) * 0x9E3779B97F4A7C15ull;
+	}
+	unsigned char tag_of(unsigned long long h) const {
+		return (unsigned char)((h >> (shift - 7)) & 0x7f);
+	}
+	void set_ctrl(size_t index, unsigned char c) {
+		ctrl[index] = c;
+		if (index < ctrl_clone) {ctrl[size + index] = c; }
+	}
+	/**
+	 * slot index of key, or size if it is absent.
+	 * there is never an empty slot between an element and its home,
+	 * so the scan stops at the first group that contains one.
+	*/
+	template<class Group>
+	size_t probe(const Key &key) const {
+		Equal equal;
+		unsigned long long h = mix(key);
+		size_t index = size_t(h >> shift);
+		unsigned char tag = tag_of(h);
+		unsigned int match, empty;
+		finds.add();
+		while (true) {
+			probes.add();
+			Group::scan(ctrl + index, tag, match, empty);
+			if (empty != 0) {match &= empty ^ (empty - 1); }
+			while (match != 0) {
+				size_t i = (index + __builtin_ctz(match)) & (size - 1);
+				if ((!cached || hashes[i] == h) && equal(slots[i].first, key)) {return i; }
+				match &= match - 1;
+			}
+			if (empty != 0) {return size; }
+			index = (index + Group::width) & (size - 1);
+		}
+	}
+#ifdef SJTU_X86_GROUPS
+	__attribute__((target("avx2"), flatten))
+	size_t probe_avx2(const Key &key) const {
+		return probe<avx2_group>(key);
+	}
+#endif
+	size_t locate(const Key &key) const {
+#ifdef SJTU_X86_GROUPS
+		if (kernel == group_kernel::avx2) {return probe_avx2(key); }
+		return probe<sse2_group>(key);
+#else
+		return probe<scalar_group>(key);
+#endif
+	}
+	/**
+	 * put a key known to be absent, h = mix(key); return where it
+	 * finally landed
+	*/
+	size_t place(value_type &&value, unsigned long long h) {
+		alignas(value_type) unsigned char buf[sizeof(value_type)];
+		value_type *carry = new (buf) value_type(std::move(value));
+		size_t index = size_t(h >> shift), landed = size;
+		unsigned char tag = tag_of(h);
+		unsigned int d = 1;
+		while (dist[index] != 0) {
+			if (dist[index] < d) {
+				// take the slot from the richer element and carry that one on
+				value_type tmp(std::move(slots[index]));
+				slots[index].~value_type();
+				new (slots + index) value_type(std::move(*carry));
+				carry->~value_type();
+				new (carry) value_type(std::move(tmp));
+				std::swap(d, dist[index]);
+				unsigned char resident = ctrl[index];
+				set_ctrl(index, tag);
+				tag = resident;
+				if (cached) {std::swap(h, hashes[index]); }
+				if (landed == size) {landed = index; }
+			}
+			index = (index + 1) & (size - 1);
+			++d;
+		}
+		new (slots + index) value_type(std::move(*carry));
+		carry->~value_type();
+		dist[index] = d;
+		set_ctrl(index, tag);
+		if (cached) {hashes[index] = h; }
+		return landed == size ? index : landed;
+	}
 };
 
-template<class Key, class T, class Hash, class Equal>
-double hashmap<Key, T, Hash, Equal>::loadFactor = 0.5;
 
+/**
+ * the default Hook of linked_hashmap: nodes carry nothing extra
+*/
+struct no_node_hook{};
 
+/**
+ * every entry is a single Node holding the key/value pair, the
+ * recency links of `list` and the bucket link of `index`;
+ * Hook is an extra base of Node for whoever needs its own state on
+ * every entry (basic_lru's lru_node_hook)
+*/
 template<
 	class Key,
 	class T,
 	class Hash = std::hash<Key>, 
-	class Equal = std::equal_to<Key>
-> class linked_hashmap :public hashmap<Key,typename double_list<sjtu::pair<const Key, T>>::iterator ,Hash,Equal>{
+	class Equal = std::equal_to<Key>,
+	class Alloc = std::allocator<pair<const Key, T> >,
+	class Policy = pow2_hash_policy,
+	class Hook = no_node_hook
+> class linked_hashmap{
 	
 public:
 	typedef pair<const Key, T> value_type;
-	double_list<value_type> list;
-	using LIT = typename double_list<value_type>::iterator;
-	using lhash = hashmap<Key,typename double_list<value_type>::iterator ,Hash,Equal>;
+	using key_type = Key;
+	using hasher = Hash;
+	using key_equal = Equal;
+	using allocator_type = Alloc;
+	struct Node: hash_slot<cache_hash_code<Key, Hash>::value>, Hook{
+		value_type item;
+		Node *prev = nullptr, *next = nullptr;  // recency order
+		Node *chain = nullptr;  // next node in the same bucket
+		template<class... Args>
+		explicit Node(Args &&... args): item(std::forward<Args>(args)...) {}
+	};
+	double_list<value_type, Node, Alloc> list;
+	chain_index<Node, Key, Hash, Equal, Alloc, Policy> index;
+	using LIT = typename double_list<value_type, Node, Alloc>::iterator;
 // --------------------------
 	class const_iterator;
 	class iterator{
@@ -626,7 +1686,7 @@ public:
              * elements
              * add whatever you want
             */
-			using CLIT = typename double_list<value_type>::const_iterator;
+			using CLIT = typename double_list<value_type, Node, Alloc>::const_iterator;
 			CLIT listIt;
     // --------------------------   
 		const_iterator(const CLIT &it = CLIT()) : listIt(it) {}
@@ -692,14 +1752,13 @@ public:
 		}
 	};            
  
-	linked_hashmap() {
+	explicit linked_hashmap(const Alloc &alloc = Alloc()): list(alloc), index(1024, alloc) {
 	}
-	linked_hashmap(const linked_hashmap &other): lhash(other), list(other.list) {
-		for (auto it = list.begin(); it != list.end(); ++it) {
-			auto result = lhash::find(it.it->item.first);
-			if (result != lhash::end()) {
-				result->second = it;
-			}
+	linked_hashmap(const linked_hashmap &other): list(other.list), index(other.index.size, list.get_allocator()) {
+		index.set_incremental(other.index.incremental);
+		index.maxLoad = other.index.maxLoad;
+		for (Node *cur = list.head; cur != nullptr; cur = cur->next) {
+			index.link(cur);
 		}
 	}
 	~linked_hashmap() {
@@ -708,13 +1767,10 @@ public:
 	linked_hashmap & operator=(const linked_hashmap &other) {
 		if (this == &other) { return *this; }
 		clear();
-		lhash::operator=(other);
+		index.maxLoad = other.index.maxLoad;
 		list = other.list;
-		for (auto it = list.begin(); it != list.end(); ++it) {
-			auto result = lhash::find(it.it->item.first);
-			if (result != lhash::end()) {
-				result->second = it;
-			}
+		for (Node *cur = list.head; cur != nullptr; cur = cur->next) {
+			index.link(cur);
 		}
 		return *this;
 	}
@@ -725,25 +1781,21 @@ public:
 	 * if the key not found, throw 
 	*/
 	T & at(const Key &key) {
-		auto it = lhash::find(key);
-		if (it == lhash::end()) {
+		Node *node = index.find(key);
+		if (node == nullptr) {
 			throw index_out_of_bound();
 		}
-		return it.eleIt.it->item.second.it->item.second;
+		return node->item.second;
 	}
 	const T & at(const Key &key) const {
-		auto it = lhash::find(key);
-        if (it == lhash::end()) {
+		Node *node = index.find(key);
+        if (node == nullptr) {
             throw index_out_of_bound();
         }
-		return it.eleIt.it->item.second.it->item.second;
+		return node->item.second;
 	}
 	T & operator[](const Key &key) {
-		auto it = lhash::find(key);
-		if (it == lhash::end()) {
-			throw index_out_of_bound();
-		}
-		return it.eleIt.it->item.second.it->item.second;
+		return at(key);
 	}
 	const T & operator[](const Key &key) const {
 		return at(key);
@@ -781,13 +1833,78 @@ public:
 		return list.empty();
 	}
 
+	allocator_type get_allocator() const {
+		return list.get_allocator();
+	}
+	/**
+	 * spread resizes over the following inserts/removes
+	 * (see chain_index)
+	*/
+	void incremental_rehash(bool on) {
+		index.set_incremental(on);
+	}
+	/**
+	 * capacity control, see chain_index
+	*/
+	void reserve(size_t n) {
+		index.reserve(n);
+	}
+	void rehash(size_t buckets) {
+		index.rehash(buckets);
+	}
+	double max_load_factor() const {
+		return index.max_load_factor();
+	}
+	void max_load_factor(double ml) {
+		index.max_load_factor(ml);
+	}
+	double load_factor() const {
+		return index.load_factor();
+	}
+	size_t bucket_count() const {
+		return index.size;
+	}
+	table_stats stats() const {
+		table_stats st = index.stats();
+		st.node_bytes = index.curL * sizeof(Node);
+		return st;
+	}
+
     void clear(){
-		lhash::clear();
+		index.clear();
         list.clear();
 	}
+	/**
+	 * write every entry in list order to a snapshot_writer
+	 * (see snapshot.hpp)
+	*/
+	template<class Out>
+	void write_to(Out &out) const {
+		out.begin(size());
+		for (const Node *node = list.head; node != nullptr; node = node->next) {
+			out.put(node->item.first);
+			out.put(node->item.second);
+		}
+	}
+	/**
+	 * replace the contents by those of a snapshot_reader, in its
+	 * order; the table is sized for all of them first.
+	 * if the reader throws (a truncated or corrupt file), the map holds
+	 * the entries read up to there and none of the old ones
+	*/
+	template<class In>
+	void read_from(In &in) {
+		uint64_t n = in.begin();
+		clear();
+		reserve(n);
+		for (uint64_t i = 0; i < n; ++i) {
+			Key key = in.template get<Key>();
+			try_emplace(std::move(key), in.template get<T>());
+		}
+	}
 
 	size_t size() const {
-		return lhash::curL;
+		return index.curL;
 	}
  	/**
 	 * insert the value_piar
@@ -800,18 +1917,50 @@ public:
 	 * add a new element and return true
 	*/
 	pair<iterator, bool> insert(const value_type &value) {
-		auto result = lhash::find(value.first);
-		bool exist = true;
-		if (result == lhash::end()) {
-			list.insert_tail(value);
-			lhash::insert({value.first, LIT(list.empty()? nullptr: list.back())});
-		} else {
-			result.eleIt.it->item.second.it->item.second = value.second;
-			list.move_to_tail(result.eleIt.it->item.second);
-			//result.eleIt.it->item.second = list.back();
-			exist = false;
-		}
-		return {iterator(list.empty()? nullptr: list.back()), exist};
+		return insert_or_assign(value.first, value.second);
+	}
+	pair<iterator, bool> insert(value_type &&value) {
+		return insert_or_assign(value.first, std::move(value.second));
+	}
+	/**
+	 * insert without a value_type in between: the value is assigned
+	 * from / built out of obj directly
+	*/
+	template<class M>
+	pair<iterator, bool> insert_or_assign(const Key &key, M &&obj) {
+		return assign(key, std::forward<M>(obj));
+	}
+	template<class M>
+	pair<iterator, bool> insert_or_assign(Key &&key, M &&obj) {
+		return assign(std::move(key), std::forward<M>(obj));
+	}
+	/**
+	 * if the key is absent, append a value built in place from args
+	 * and return true; otherwise change nothing (not even the order)
+	 * and return false
+	*/
+	template<class... Args>
+	pair<iterator, bool> try_emplace(const Key &key, Args &&... args) {
+		return emplace_key(key, std::forward<Args>(args)...);
+	}
+	template<class... Args>
+	pair<iterator, bool> try_emplace(Key &&key, Args &&... args) {
+		return emplace_key(std::move(key), std::forward<Args>(args)...);
+	}
+	/**
+	 * append a value_type built from args; if its key is already
+	 * there the new one is dropped and nothing changes
+	*/
+	template<class... Args>
+	pair<iterator, bool> emplace(Args &&... args) {
+		list.emplace_tail(std::forward<Args>(args)...);
+		Node *found = index.find(list.tail->item.first);
+		if (found != nullptr) {
+			list.erase(LIT(list.tail));
+			return {iterator(LIT(found)), false};
+		}
+		index.link(list.tail);
+		return {iterator(list.back()), true};
 	}
  	/**
 	 * erase the value_pair pointed by the iterator
@@ -820,7 +1969,7 @@ public:
 	*/
 	void remove(iterator pos) {
 		if (pos == end()) {throw invalid_iterator(); }
-		lhash::remove(pos->first);
+		index.unlink(pos.listIt.it);
 		list.erase(pos.listIt);
 	}
 	/**
@@ -828,7 +1977,7 @@ public:
 	 * this should only return 0 or 1
 	*/
 	size_t count(const Key &key) const {
-		return lhash::find(key) != lhash::end() ? 1 : 0;
+		return index.find(key) != nullptr ? 1 : 0;
 	}
 	/**
 	 * find the iterator points at the value_pair
@@ -837,46 +1986,473 @@ public:
 	 * point at nothing
 	*/
 	iterator find(const Key &key) {
-		auto it = lhash::find(key);
-		if (it == lhash::end()) {return end(); }
-		return it.eleIt.it->item.second;
+		Node *node = index.find(key);
+		if (node == nullptr) {return end(); }
+		return iterator(LIT(node));
+	}
+
+private:
+	template<class K, class M>
+	pair<iterator, bool> assign(K &&key, M &&obj) {
+		Node *node = index.find(key);
+		bool exist = true;
+		if (node == nullptr) {
+			list.emplace_tail(std::forward<K>(key), std::forward<M>(obj));
+			index.link(list.tail);
+		} else {
+			node->item.second = std::forward<M>(obj);
+			list.move_to_tail(LIT(node));
+			exist = false;
+		}
+		return {iterator(list.empty()? nullptr: list.back()), exist};
+	}
+	template<class K, class... Args>
+	pair<iterator, bool> emplace_key(K &&key, Args &&... args) {
+		Node *node = index.find(key);
+		if (node != nullptr) {return {iterator(LIT(node)), false}; }
+		list.emplace_tail(std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+			std::forward_as_tuple(std::forward<Args>(args)...));
+		index.link(list.tail);
+		return {iterator(list.back()), true};
+	}
+};
+
+/**
+ * how print() writes a key
+*/
+template<class K> void print_key(std::ostream &os, const K &key) {
+	os << key;
+}
+inline void print_key(std::ostream &os, const Integer &key) {
+	os << key.val;
+}
+
+/**
+ * bytes a value owns outside its own sizeof (heap buffers);
+ * specialise it for types whose byte_weigher weight should count them
+*/
+template<class T> struct heap_size{
+	size_t operator()(const T &) const {return 0; }
+};
+template<class T> struct heap_size<Matrix<T> >{
+	size_t operator()(const Matrix<T> &m) const {return m.RowSize() * m.ColSize() * sizeof(T); }
+};
+
+/**
+ * weighers of basic_lru, instantiated with its node type;
+ * weigher(key, value) is what the entry costs out of the capacity.
+ * unit_weigher  1 per entry, the capacity is an entry count
+ * byte_weigher  bytes: the node plus what key and value own on the
+ *               heap (heap_size), the capacity is a byte budget
+*/
+template<class Node> struct unit_weigher{
+	template<class K, class V>
+	size_t operator()(const K &, const V &) const {return 1; }
+};
+template<class Node> struct byte_weigher{
+	template<class K, class V>
+	size_t operator()(const K &key, const V &value) const {
+		return sizeof(Node) + heap_size<K>()(key) + heap_size<V>()(value);
 	}
 };
 
-class lru{
-    using lmap = sjtu::linked_hashmap<Integer,Matrix<int>,Hash,Equal>;
-    using value_type = sjtu::pair<const Integer, Matrix<int> >;
+/**
+ * eviction modes of basic_lru, instantiated with its linked_hashmap,
+ * whose nodes have the `mark` of lru_node_hook for them.
+ * the list of the map is the eviction queue (new entries at the tail);
+ * a mode provides
+ *   inserted(map, node)  node was just added at the tail of the list
+ *   hit(map, node)       a get found node (or save replaced its value)
+ *   victim(map)          the node to evict when the cache is full
+ *   removing(map, node)  node is about to leave the map
+ *   bytes()              memory it holds besides the nodes
+ *   shared_hits          whether hit() may run alongside other readers
+ *
+ * lru_eviction    strict lru: every hit moves the node to the tail
+ * clock_eviction  CLOCK / second chance: a hit only sets the mark bit
+ *                 of the node (one relaxed atomic store, the list is
+ *                 never written on a read); victim() sweeps from the
+ *                 head, giving marked nodes a second round at the
+ *                 tail, and returns the first unmarked one
+*/
+template<class Map> struct lru_eviction{
+	using Node = typename Map::Node;
+	static const bool shared_hits = false;
+	explicit lru_eviction(size_t) {}
+	void inserted(Map &, Node *) {}
+	void removing(Map &, Node *) {}
+	void hit(Map &map, Node *node) {
+		map.list.move_to_tail(typename Map::LIT(node));
+	}
+	Node *victim(Map &map) {
+		return map.list.head;
+	}
+	size_t bytes() const {
+		return 0;
+	}
+};
+
+template<class Map> struct clock_eviction{
+	using Node = typename Map::Node;
+	static const bool shared_hits = true;
+	explicit clock_eviction(size_t) {}
+	void inserted(Map &, Node *) {}
+	void removing(Map &, Node *) {}
+	void hit(Map &, Node *node) {
+		if (node->mark.load(std::memory_order_relaxed) == 0) {node->mark.store(1, std::memory_order_relaxed); }
+	}
+	Node *victim(Map &map) {
+		// every node is cleared at most once, so this ends within one lap
+		while (map.list.head->mark.load(std::memory_order_relaxed) != 0) {
+			map.list.head->mark.store(0, std::memory_order_relaxed);
+			map.list.move_to_tail(typename Map::LIT(map.list.head));
+		}
+		return map.list.head;
+	}
+	size_t bytes() const {
+		return 0;
+	}
+};
+
+/**
+ * the Expiry of basic_lru: entries live until they are evicted.
+ * an Expiry provides
+ *   hook                 extra base of every node (its timer links)
+ *   written(node)        node got a new value
+ *   accessed(node)       a get found node
+ *   expired(node)        whether node is dead (get / lookup miss it)
+ *   removing(node)       node is about to leave the map
+ *   advance(f)           call f(hook *) on every dead node, so that
+ *                        the owner removes it
+ *   expire_in(node, t)   (optional) node dies t ticks from now
+ *   shared_access        whether accessed() may run alongside readers
+ * (see wheel_expiry in expiry.hpp)
+*/
+struct no_expiry{
+	using hook = no_node_hook;
+	static const bool shared_access = true;
+	void written(hook *) {}
+	void accessed(hook *) {}
+	bool expired(const hook *) const {return false; }
+	void removing(hook *) {}
+	template<class F>
+	size_t advance(F &&) {return 0; }
+};
+
+/**
+ * the Hook basic_lru gives its linked_hashmap: the one of its Expiry
+ * plus what the eviction mode and the weigher keep per entry, so a
+ * plain linked_hashmap pays for neither
+*/
+template<class ExpiryHook> struct lru_node_hook: ExpiryHook{
+	std::atomic<unsigned char> mark{0};  // free for the eviction modes
+	unsigned int weight = 0;  // set by the weigher (fits in mark's padding)
+};
+
+/**
+ * the Sampler of basic_lru: nothing watches the keys.
+ * a Sampler provides
+ *   reference(key, hash, request)   key was read (request, a get) or
+ *                                   written (a save / emplace)
+ * (see shards_sampler in shards.hpp)
+*/
+struct no_sampler{
+	template<class K, class H>
+	void reference(const K &, const H &, bool) {}
+};
+
+/**
+ * lru over any key/value; sjtu::lru is the Integer -> Matrix<int>
+ * instance required by the assignment.
+ * Alloc and Policy are handed down to the linked_hashmap, Eviction
+ * picks how hits are recorded and who goes when it is full.
+ * the capacity bounds the total Weigher weight of the entries (their
+ * number by default); an entry is weighed when it is saved and keeps
+ * that weight until it is saved again or evicted, so a value changed
+ * through get() is not re-weighed.
+ * Expiry may give entries a deadline: a dead entry is a miss at once
+ * and gets removed by the next save / emplace or by cleanup().
+ * Sampler sees every key get / save / emplace is called with, e.g. to
+ * estimate the hit ratio the cache would have at other capacities.
+*/
+template<
+	class Key = Integer,
+	class T = Matrix<int>,
+	class Hash = ::Hash,
+	class Equal = ::Equal,
+	class Alloc = std::allocator<pair<const Key, T> >,
+	class Policy = pow2_hash_policy,
+	template<class> class Eviction = lru_eviction,
+	template<class> class Weigher = unit_weigher,
+	class Expiry = no_expiry,
+	class Sampler = no_sampler
+> class basic_lru{
+    using lmap = sjtu::linked_hashmap<Key,T,Hash,Equal,Alloc,Policy,lru_node_hook<typename Expiry::hook> >;
+    using value_type = sjtu::pair<const Key, T >;
+public:
+    using node_type = typename lmap::Node;
+    static const bool shared_hits = Eviction<lmap>::shared_hits && Expiry::shared_access;
+private:
 	lmap cache;
 	const size_t capacity;
+	Eviction<lmap> evict;
+	Weigher<node_type> weigh;
+	Expiry ttl;
+	Sampler sample;
+	size_t used = 0;  // total weight of the entries
+	stat_counter hits, misses, inserts, updates, evictions, expirations;
 public:
-    lru(int size): capacity(size) {
+
+    explicit basic_lru(size_t size, const Alloc &alloc = Alloc()): cache(alloc), capacity(size), evict(capacity) {
+    }
+    ~basic_lru(){
+    }
+    /**
+     * with this on, save() never rehashes the whole table at once
+    */
+    void incremental_rehash(bool on) {
+		cache.incremental_rehash(on);
+    }
+    /**
+     * size the table for `n` entries (e.g. the capacity) up front,
+     * so that save() never has to grow it
+    */
+    void reserve(size_t n) {
+		cache.reserve(n);
+    }
+    void max_load_factor(double ml) {
+		cache.max_load_factor(ml);
+    }
+    size_t size() const {
+		return cache.size();
+    }
+    /**
+     * total weight of the entries, out of capacity()
+    */
+    size_t weight() const {
+		return used;
+    }
+    size_t max_weight() const {
+		return capacity;
     }
-    ~lru(){
+    /**
+     * the eviction mode, for its own knobs and counters
+    */
+    Eviction<lmap> &eviction() {
+		return evict;
+    }
+    const Eviction<lmap> &eviction() const {
+		return evict;
+    }
+    /**
+     * the expiry, for its settings and clock
+    */
+    Expiry &expiry() {
+		return ttl;
+    }
+    const Expiry &expiry() const {
+		return ttl;
+    }
+    /**
+     * the sampler, for its estimates (and to set it up)
+    */
+    Sampler &sampler() {
+		return sample;
+    }
+    const Sampler &sampler() const {
+		return sample;
+    }
+    /**
+     * remove every dead entry now; return how many there were
+    */
+    size_t cleanup() {
+		size_t dead = ttl.advance([this](typename Expiry::hook *node) {discard(static_cast<node_type *>(node)); });
+		expirations.add(dead);
+		return dead;
+    }
+    /**
+     * snapshot of the counters (all 0 without SJTU_STATS) and the table
+    */
+    lru_stats stats() const {
+		lru_stats st;
+		st.hits = hits.get();
+		st.misses = misses.get();
+		st.inserts = inserts.get();
+		st.updates = updates.get();
+		st.evictions = evictions.get();
+		st.expirations = expirations.get();
+		st.weight = used;
+		st.capacity = capacity;
+		st.policy_bytes = evict.bytes();
+		st.table = cache.stats();
+		return st;
+    }
+    /**
+     * give the entry of key its own time to live (in clock ticks)
+     * until it is written (or, expiring after access, read) again;
+     * return false if the key is absent
+    */
+    bool expire_in(const Key &key, uint64_t ticks) {
+		node_type *node = lookup(key);
+		if (node == nullptr) {return false; }
+		ttl.expire_in(node, ticks);
+		return true;
+    }
+    /**
+     * write the live entries to a snapshot_writer (see snapshot.hpp)
+     * in list order, least recently used first under lru_eviction
+    */
+    template<class Out>
+    void write_to(Out &out) const {
+		size_t live = 0;
+		for (const node_type *node = cache.list.head; node != nullptr; node = node->next) {
+			live += !ttl.expired(node);
+		}
+		out.begin(live);
+		for (const node_type *node = cache.list.head; node != nullptr; node = node->next) {
+			if (ttl.expired(node)) {continue; }
+			out.put(node->item.first);
+			out.put(node->item.second);
+		}
+    }
+    /**
+     * replace the contents by the entries of a snapshot_reader, as
+     * linked_hashmap does: the entries there were are removed, then
+     * those of the snapshot emplaced in its order, so the last one ends
+     * up most recent, into a table sized for them first.
+     * the eviction mode and the expiry see them as new entries: marks
+     * and deadlines start afresh (history of other keys, like ghosts,
+     * is kept).  the table is sized for no more than the capacity, as
+     * the rest would be evicted at once; if the reader throws, the
+     * cache holds what was emplaced up to there and none of the old
+     * entries
+    */
+    template<class In>
+    void read_from(In &in) {
+		uint64_t n = in.begin();
+		while (cache.list.head != nullptr) {discard(cache.list.head); }
+		cache.reserve(n < capacity ? size_t(n) : capacity);
+		for (uint64_t i = 0; i < n; ++i) {
+			Key key = in.template get<Key>();
+			emplace(std::move(key), in.template get<T>());
+		}
     }
     /**
      * save the value_pair in the memory
      * delete something in the memory if necessary
+     * an entry heavier than the whole capacity is not saved (false)
     */
-    void save(const value_type &v) {
-		if (cache.size() > 0 && cache.size() >= capacity) {
-			// delete sth.
-			cache.remove(cache.begin());
-        }
-		cache.insert(v);
+    bool save(const value_type &v) {
+		sample.reference(v.first, Hash(), false);
+		size_t w = weigh(v.first, v.second);
+		if (!fits(w)) {return false; }
+		cleanup();
+		node_type *node = make_room(v.first, w);
+		if (node != nullptr) {
+			node->item.second = v.second;
+			charge(node, w);
+			evict.hit(cache, node);
+			updates.add();
+		} else {
+			cache.insert(v);
+			node = cache.list.tail;
+			charge(node, w);
+			evict.inserted(cache, node);
+			inserts.add();
+		}
+		ttl.written(node);
+		return true;
+    }
+    bool save(value_type &&v) {
+		sample.reference(v.first, Hash(), false);
+		size_t w = weigh(v.first, v.second);
+		if (!fits(w)) {return false; }
+		cleanup();
+		node_type *node = make_room(v.first, w);
+		if (node != nullptr) {
+			node->item.second = std::move(v.second);
+			charge(node, w);
+			evict.hit(cache, node);
+			updates.add();
+		} else {
+			cache.insert(std::move(v));
+			node = cache.list.tail;
+			charge(node, w);
+			evict.inserted(cache, node);
+			inserts.add();
+		}
+		ttl.written(node);
+		return true;
+    }
+    /**
+     * save(key, value) without building a value_type first: the value
+     * is built from args, weighed, and moved into the entry once room
+     * is made for it, so eviction sees the same cache as in save()
+     * (never the new entry itself)
+    */
+    template<class K, class... Args>
+    bool emplace(K &&key, Args &&... args) {
+		const Key &k = key;
+		T value(std::forward<Args>(args)...);
+		sample.reference(k, Hash(), false);
+		size_t w = weigh(k, value);
+		if (!fits(w)) {return false; }
+		cleanup();
+		node_type *node = make_room(k, w);
+		if (node != nullptr) {
+			node->item.second = std::move(value);
+			charge(node, w);
+			evict.hit(cache, node);
+			updates.add();
+		} else {
+			node = cache.try_emplace(std::forward<K>(key), std::move(value)).first.listIt.it;
+			charge(node, w);
+			evict.inserted(cache, node);
+			inserts.add();
+		}
+		ttl.written(node);
+		return true;
     }
     /**
      * return a pointer contain the value
     */
-    Matrix<int>* get(const Integer &v) {
-		auto result = cache.find(v);
-		if (result == cache.end()) {
+    T* get(const Key &v) {
+		sample.reference(v, Hash(), true);
+		node_type *node = lookup(v);
+		if (node == nullptr) {
+			misses.add();
 			return nullptr;
 		}
 		// update seq
-		cache.list.move_to_tail(result.listIt);
-		return &(result->second);
+		hits.add();
+		touch(node);
+		return &(node->item.second);
 		// return &(cache.list.back().it->item.second);
     }
+    /**
+     * get() in two halves, for callers that batch the hits:
+     * lookup() finds the entry (value in item.second) without
+     * recording anything, so readers may share it; touch() then
+     * records the hit (needs exclusive access unless shared_hits)
+    */
+    node_type *lookup(const Key &key) const {
+		node_type *node = cache.index.find(key);
+		return node == nullptr || ttl.expired(node) ? nullptr : node;
+    }
+    void touch(node_type *node) {
+		evict.hit(cache, node);
+		ttl.accessed(node);
+    }
+    /**
+     * drop the entry of key; return false if it was absent (or dead)
+    */
+    bool remove(const Key &key) {
+		node_type *node = cache.index.find(key);
+		if (node == nullptr) {return false; }
+		bool live = !ttl.expired(node);
+		discard(node);
+		return live;
+    }
     /**
      * just print everything in the memory
      * to debug or test.
@@ -884,12 +2460,52 @@ public:
      * change the order.
     */
 	void print() {
-		for (typename lru::lmap::iterator it = cache.begin(); it != cache.end(); ++it) {
-			std::cout << it->first.val << " " << it->second << std::endl;
+		for (typename lmap::iterator it = cache.begin(); it != cache.end(); ++it) {
+			print_key(std::cout, it->first);
+			std::cout << " " << it->second << std::endl;
 		}
 	}
+
+private:
+	bool fits(size_t w) const {
+		return w <= capacity && w <= size_t(~0u);  // node->weight has 32 bits
+	}
+	/**
+	 * evict until w more weight fits; the old entry of key, if any,
+	 * no longer counts (it is replaced) and is returned unless it got
+	 * evicted on the way
+	*/
+	node_type *make_room(const Key &key, size_t w) {
+		node_type *old = cache.index.find(key);
+		if (old != nullptr) {
+			used -= old->weight;
+			old->weight = 0;
+		}
+		while (cache.size() > 0 && used + w > capacity) {
+			// delete sth.
+			node_type *node = evict.victim(cache);
+			if (node == old) {old = nullptr; }
+			discard(node);
+			evictions.add();
+		}
+		return old;
+	}
+	void charge(node_type *node, size_t w) {
+		used += w;
+		node->weight = (unsigned int)w;
+	}
+	void discard(node_type *node) {
+		used -= node->weight;
+		evict.removing(cache, node);
+		ttl.removing(node);
+		cache.remove(typename lmap::LIT(node));
+	}
 	
 };
+
+using lru = basic_lru<>;
+using clock_lru = basic_lru<Integer, Matrix<int>, ::Hash, ::Equal, std::allocator<pair<const Integer, Matrix<int> > >,
+	pow2_hash_policy, clock_eviction>;
 }                                                                                                                         
 
 #endif
\ No newline at end of file
@@ -0,0 +1,167 @@
+#ifndef SJTU_SHARDS_HPP
+#define SJTU_SHARDS_HPP
+
+#include "trace.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace sjtu {
+
+/**
+ * Sampler of basic_lru estimating the lru miss-ratio curve of the
+ * live traffic (SHARDS, Waldspurger et al., FAST '15).
+ * a key is sampled iff the top 24 bits of its mixed hash are below a
+ * threshold T, so a sampled key has all its references sampled and
+ * the rate is R = T / 2^24.  stack distances are kept for the sampled
+ * keys only, and a distance d among them stands for d / R among all
+ * keys.  keys that are not sampled cost a hash and a compare.
+ * with max_keys set, the sample holds at most that many keys: when it
+ * would grow past them T is lowered to the largest hash bits in it,
+ * those keys are dropped, and the histogram is scaled by the new rate
+ * over the old one (fixed-size SHARDS).
+ * the curve is adjusted for sampling noise by the difference between
+ * the expected number of sampled requests (requests * R) and the
+ * actual one, credited to distance 0 (SHARDS_adj).
+ * distances go into 16 bins per power of two, so the curve between
+ * their bounds is linear and its memory is constant.
+*/
+class shards_sampler{
+public:
+	/**
+	 * sample a share `rate` of the keys, or with max_keys != 0 start
+	 * there and lower the rate to keep at most max_keys of them
+	*/
+	explicit shards_sampler(double rate = 0.01, size_t max_keys = 0): maxKeys(max_keys), bins(binCount, 0) {
+		if (rate > 1) {rate = 1; }
+		threshold = uint64_t(rate * double(modulus));
+		if (threshold == 0) {threshold = 1; }
+	}
+
+	template<class Key, class Hash>
+	void reference(const Key &key, const Hash &hash, bool request) {
+		uint64_t h = pow2_hash_policy::mix(hash(key));
+		total += request;
+		if ((h >> 40) >= threshold) {return; }
+		sampled(h, request);
+	}
+
+	/**
+	 * share of the keys currently sampled
+	*/
+	double rate() const {
+		return double(threshold) / double(modulus);
+	}
+	size_t sampled_keys() const {
+		return stack.distinct();
+	}
+	/**
+	 * gets seen, sampled or not
+	*/
+	uint64_t requests() const {
+		return total;
+	}
+	/**
+	 * estimated miss ratio of an lru with `capacity` entries
+	*/
+	double miss_ratio(size_t capacity) const {
+		double expected = double(total) * rate();
+		if (expected <= 0) {return 0; }
+		if (capacity == 0) {return 1; }
+		double hits = hits_below(double(capacity) + 1) + (expected - sampledRequests);
+		double ratio = 1.0 - hits / expected;
+		return ratio < 0 ? 0 : ratio > 1 ? 1 : ratio;
+	}
+	/**
+	 * smallest capacity whose estimated miss ratio is at most target
+	 * (a bin bound, or 0 if even the largest seen does not reach it)
+	*/
+	size_t capacity_for(double target) const {
+		for (size_t b = 1; b < binCount; ++b) {
+			size_t c = size_t(bin_high(b)) - 1;
+			if (miss_ratio(c) <= target) {
+				// the curve is linear inside the bin: look for the point
+				size_t lo = size_t(bin_low(b)) - 1;
+				while (lo < c) {
+					size_t mid = lo + (c - lo) / 2;
+					if (miss_ratio(mid) <= target) {c = mid; }
+					else {lo = mid + 1; }
+				}
+				return c;
+			}
+		}
+		return 0;
+	}
+	size_t bytes() const {
+		return stack.bytes() + keys.capacity() * sizeof(keys[0]) + bins.capacity() * sizeof(double);
+	}
+
+private:
+	static const uint64_t modulus = uint64_t(1) << 24;
+	static const size_t binCount = 16 * 61;  // 16 per power of two up to 2^64
+	uint64_t threshold;
+	size_t maxKeys;
+	stack_distance stack;
+	std::vector<std::pair<uint32_t, uint64_t> > keys;  // max-heap of (hash bits, key), max_keys only
+	std::vector<double> bins;  // sampled requests by scaled distance + 1
+	double sampledRequests = 0;
+	uint64_t total = 0;
+
+	void sampled(uint64_t h, bool request) {
+		uint64_t d = stack.reference(h);
+		if (d == stack_distance::cold && maxKeys != 0) {
+			keys.push_back(std::make_pair(uint32_t(h >> 40), h));
+			std::push_heap(keys.begin(), keys.end());
+		}
+		if (request) {
+			sampledRequests += 1;
+			// a cold miss only counts towards the requests
+			if (d != stack_distance::cold) {bins[bin_of(uint64_t(double(d) / rate()) + 1)] += 1; }
+		}
+		if (maxKeys != 0 && stack.distinct() > maxKeys) {lower(); }
+	}
+	void lower() {
+		uint64_t next = keys.front().first;
+		while (!keys.empty() && keys.front().first >= next) {
+			stack.forget(keys.front().second);
+			std::pop_heap(keys.begin(), keys.end());
+			keys.pop_back();
+		}
+		double scale = double(next) / double(threshold);
+		for (auto &b: bins) {b *= scale; }
+		sampledRequests *= scale;
+		threshold = next;
+	}
+	/**
+	 * values below 32 get a bin each, then 16 bins per power of two
+	*/
+	static size_t bin_of(uint64_t v) {
+		if (v < 32) {return size_t(v); }
+		unsigned e = 63 - __builtin_clzll(v);
+		return 16 * (e - 3) + size_t(v >> (e - 4) & 15);
+	}
+	static double bin_low(size_t b) {
+		if (b < 32) {return double(b); }
+		return double(16 + b % 16) * double(uint64_t(1) << (b / 16 - 1));
+	}
+	static double bin_high(size_t b) {
+		if (b < 32) {return double(b + 1); }
+		return bin_low(b) + double(uint64_t(1) << (b / 16 - 1));
+	}
+	/**
+	 * sampled requests with scaled distance + 1 below v
+	*/
+	double hits_below(double v) const {
+		double hits = 0;
+		for (size_t b = 1; b < binCount && bin_low(b) < v; ++b) {
+			double high = bin_high(b);
+			hits += high <= v ? bins[b] : bins[b] * (v - bin_low(b)) / (high - bin_low(b));
+		}
+		return hits;
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,624 @@
+#ifndef SJTU_SHARED_LRU_HPP
+#define SJTU_SHARED_LRU_HPP
+
+#include "frozen.hpp"
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <thread>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sjtu {
+
+/**
+ * pointer kept as the distance from itself to its target, so it stays
+ * valid wherever the memory holding both is mapped; 0 is null (nothing
+ * points at itself).  copying recomputes the distance
+*/
+template<class T> class offset_ptr{
+public:
+	offset_ptr(T *p = nullptr) {set(p); }
+	offset_ptr(const offset_ptr &other) {set(other.get()); }
+	offset_ptr & operator=(const offset_ptr &other) {
+		set(other.get());
+		return *this;
+	}
+	offset_ptr & operator=(T *p) {
+		set(p);
+		return *this;
+	}
+	T *get() const {
+		if (distance == 0) {return nullptr; }
+		return reinterpret_cast<T *>(reinterpret_cast<uintptr_t>(this) + distance);
+	}
+	T *operator->() const {
+		return get();
+	}
+	explicit operator bool() const {
+		return distance != 0;
+	}
+
+private:
+	std::ptrdiff_t distance;
+
+	void set(T *p) {
+		distance = p == nullptr ? 0 : std::ptrdiff_t(reinterpret_cast<uintptr_t>(p) - reinterpret_cast<uintptr_t>(this));
+	}
+};
+
+/**
+ * buddy allocator over one arena of a shared segment: blocks of 2^k
+ * bytes (k >= 5), each at an offset from the arena start that is a
+ * multiple of its size, with a free list per size.  a bigger block is
+ * split in halves down to the size asked for, and a freed block merges
+ * with its buddy (the other half of the block both came from) as long
+ * as that one is free too, so room freed by any entries serves values
+ * of any size again.  a fresh arena is cut into the largest blocks
+ * that fit; a map at its start, one byte per 32-byte unit, tells
+ * which units begin a free block and of which size
+*/
+class segment_arena{
+public:
+	static const unsigned minShift = 5, classes = 40;
+	struct span{
+		const void *at;
+		unsigned c;
+	};
+
+	void reset(char *begin, char *end) {
+		size_t mapBytes;
+		layout(size_t(end - begin), mapBytes, size);
+		map = reinterpret_cast<unsigned char *>(begin);
+		base = begin + mapBytes;
+		std::memset(begin, 0, mapBytes);
+		for (auto &head: free) {head = nullptr; }
+		size_t at = 0;
+		for (unsigned k = classes; k-- > 0; ) {
+			if (size - at < bytes_of(k)) {continue; }
+			push(at, k);
+			at += bytes_of(k);
+		}
+	}
+	static unsigned size_class(size_t n) {
+		unsigned k = minShift;
+		while (k < minShift + classes && (size_t(1) << k) < n) {++k; }
+		return k - minShift;
+	}
+	/**
+	 * whether blocks of classes a and b both fit in a fresh arena over
+	 * total bytes (a value and its node, in an empty shard)
+	*/
+	static bool fits(size_t total, unsigned a, unsigned b) {
+		size_t mapBytes, size;
+		layout(total, mapBytes, size);
+		return a < classes && b < classes && bytes_of(a) + bytes_of(b) <= size;
+	}
+	/**
+	 * a block of class c, nullptr if there is no room
+	*/
+	void *allocate(unsigned c) {
+		unsigned k = c;
+		while (k < classes && !free[k]) {++k; }
+		if (k >= classes) {return nullptr; }
+		size_t at = offset(free[k].get());
+		unlink(at, k);
+		while (k > c) {
+			--k;
+			push(at + bytes_of(k), k);
+		}
+		return base.get() + at;
+	}
+	void deallocate(void *p, unsigned c) {
+		size_t at = offset(p);
+		for (; c + 1 < classes; ++c) {
+			size_t buddy = at ^ bytes_of(c);
+			if (buddy + bytes_of(c) > size || map.get()[buddy >> minShift] != c + 1) {break; }
+			unlink(buddy, c);
+			if (buddy < at) {at = buddy; }
+		}
+		push(at, c);
+	}
+	/**
+	 * whether allocate(c) would succeed once every block is freed but
+	 * the (at most 4) blocks in held, i.e. whether evicting can help
+	*/
+	bool could_allocate(unsigned c, const span *held, size_t n) const {
+		size_t at = 0;
+		for (unsigned k = classes; k-- > 0; ) {
+			if (size - at < bytes_of(k)) {continue; }
+			if (k >= c) {
+				// blocks of class c in this fresh block, less those a held block is in
+				size_t room = size_t(1) << (k - c), taken = 0, units[4], unitCount = 0;
+				for (size_t i = 0; i < n; ++i) {
+					size_t o = offset(held[i].at);
+					if (o < at || o >= at + bytes_of(k)) {continue; }
+					if (held[i].c >= c) {
+						taken += size_t(1) << (held[i].c - c);
+						continue;
+					}
+					size_t unit = (o - at) >> (c + minShift);
+					bool seen = false;
+					for (size_t j = 0; j < unitCount; ++j) {seen = seen || units[j] == unit; }
+					if (!seen) {
+						units[unitCount++] = unit;
+						++taken;
+					}
+				}
+				if (taken < room) {return true; }
+			}
+			at += bytes_of(k);
+		}
+		return false;
+	}
+
+private:
+	struct block{
+		offset_ptr<block> prev, next;
+	};
+	offset_ptr<unsigned char> map;  // class + 1 of the free block at each unit, 0 if none
+	offset_ptr<char> base;
+	size_t size;  // bytes from base on
+	offset_ptr<block> free[classes];
+
+	static size_t bytes_of(unsigned c) {
+		return size_t(1) << (c + minShift);
+	}
+	/**
+	 * the map takes a byte per unit of the whole arena, rounded up to
+	 * a unit, and the blocks the whole units after it
+	*/
+	static void layout(size_t total, size_t &mapBytes, size_t &size) {
+		size_t unit = size_t(1) << minShift;
+		mapBytes = ((total >> minShift) + unit - 1) & ~(unit - 1);
+		size = total > mapBytes ? (total - mapBytes) & ~(unit - 1) : 0;
+	}
+	size_t offset(const void *p) const {
+		return size_t(static_cast<const char *>(p) - base.get());
+	}
+	void push(size_t at, unsigned c) {
+		block *b = new (base.get() + at) block;
+		b->next = free[c].get();
+		if (b->next) {b->next->prev = b; }
+		free[c] = b;
+		map.get()[at >> minShift] = (unsigned char)(c + 1);
+	}
+	void unlink(size_t at, unsigned c) {
+		block *b = reinterpret_cast<block *>(base.get() + at);
+		block *prev = b->prev.get(), *next = b->next.get();
+		if (prev != nullptr) {prev->next = next; } else {free[c] = next; }
+		if (next != nullptr) {next->prev = prev; }
+		map.get()[at >> minShift] = 0;
+	}
+};
+
+/**
+ * lru of Key -> Matrix<E> in a POSIX shared-memory segment, shared by
+ * every process that opens the same name: nodes, bucket arrays, recency
+ * lists and values all live in the segment and link to each other by
+ * offset_ptr, so each process may map it anywhere.
+ * the keys are split over shards by hash; a shard has its own robust,
+ * process-shared mutex, bucket array (sized for its capacity, never
+ * rehashed), lru list and segment_arena for nodes and values.  a shard
+ * is full when it holds capacity / shards entries (rounded up) or its
+ * arena has no block for a new value; then its least recent entries go,
+ * unless even an empty shard would have no room for it (nothing is
+ * evicted for a save that cannot succeed).
+ * if a process dies holding a shard lock, the next process to take it
+ * empties that shard (it may be half updated) and goes on.
+ * values are copied out, or visited under the lock, since a pointer
+ * into a shard would outlive the lock.
+ * keys are stored through frozen_key (frozen.hpp), values as the
+ * records of frozen_matrix; every process must run the same build.
+*/
+template<
+	class Key = Integer,
+	class E = int,
+	class Hash = ::Hash,
+	class Equal = ::Equal
+> class shared_lru{
+	static_assert(std::is_trivially_copyable<E>::value && alignof(E) <= 8, "shared elements are copied as bytes");
+	using stored_key = typename frozen_key<Key>::type;
+
+	struct node{
+		offset_ptr<node> prev, next;  // recency, head is the least recent
+		offset_ptr<node> chain;  // next node in the same bucket
+		offset_ptr<char> value;  // rows, cols, elements
+		uint64_t hash;
+		unsigned valueClass;
+		stored_key key;
+	};
+	struct shard{
+		pthread_mutex_t lock;
+		offset_ptr<offset_ptr<node> > buckets;
+		uint64_t mask;
+		offset_ptr<node> head, tail;
+		size_t count, capacity;
+		offset_ptr<char> arenaBegin, arenaEnd;
+		segment_arena arena;
+		stat_counter hits, misses, inserts, updates, evictions;
+		uint64_t resets;  // counted even without SJTU_STATS
+	};
+	struct header{
+		char magic[8];
+		uint32_t key_bytes, elem_bytes;
+		uint64_t bytes, capacity, shards;
+		std::atomic<uint32_t> ready;
+	};
+
+public:
+	/**
+	 * open the segment `name` ("/something"), creating it with room for
+	 * `capacity` entries in `bytes` bytes over `shards` shards if it does
+	 * not exist yet (otherwise those come from the segment).
+	 * throws runtime_error if it cannot (capacity 0 is refused), or if
+	 * the segment is not a shared_lru of this Key and E
+	*/
+	explicit shared_lru(const char *name, size_t capacity = 1024, size_t bytes = size_t(64) << 20, size_t shards = 16) {
+		int fd = ::shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+		if (fd >= 0) {
+			create(fd, name, capacity, bytes, shards == 0 ? 1 : shards);
+		} else if (errno == EEXIST) {
+			attach(name);
+		} else {
+			throw runtime_error();
+		}
+	}
+	shared_lru(const shared_lru &other) = delete;
+	shared_lru & operator=(const shared_lru &other) = delete;
+	~shared_lru() {
+		::munmap(base, length);
+	}
+	/**
+	 * remove the name; processes that have the segment open keep it
+	*/
+	static bool unlink(const char *name) {
+		return ::shm_unlink(name) == 0;
+	}
+
+	/**
+	 * copy the value into out and mark it as used;
+	 * return false (out untouched) if the key is absent
+	*/
+	bool get(const Key &key, Matrix<E> &out) {
+		return visit(key, [&out](const frozen_matrix<E> &m) {out = m.matrix(); });
+	}
+	/**
+	 * call f(frozen_matrix<E>) on the value under the shard lock and
+	 * mark it as used; return false if the key is absent
+	*/
+	template<class F>
+	bool visit(const Key &key, F &&f) {
+		uint64_t h = hash_of(key);
+		shard &s = shard_of(h);
+		guard g(*this, s);
+		node *n = find(s, key, h);
+		if (n == nullptr) {
+			s.misses.add();
+			return false;
+		}
+		s.hits.add();
+		unlink_list(s, n);
+		link_tail(s, n);
+		f(frozen_matrix<E>(n->value.get()));
+		return true;
+	}
+	/**
+	 * save key -> m, evicting what it takes; false if m cannot fit
+	 * in its shard at all, with the shard (and an old value of key)
+	 * left as it was
+	*/
+	bool save(const Key &key, const Matrix<E> &m) {
+		size_t need = 2 * sizeof(uint64_t) + m.RowSize() * m.ColSize() * sizeof(E);
+		unsigned vc = segment_arena::size_class(need);
+		uint64_t h = hash_of(key);
+		shard &s = shard_of(h);
+		// the arena bounds never change: no lock needed to turn it down
+		if (!segment_arena::fits(size_t(s.arenaEnd.get() - s.arenaBegin.get()), vc, nodeClass())) {return false; }
+		guard g(*this, s);
+		node *n = find(s, key, h);
+		if (n != nullptr) {
+			// last in line while room is made
+			unlink_list(s, n);
+			link_tail(s, n);
+			if (n->valueClass != vc) {
+				// the old value is only given up once the new block is had
+				char *v = static_cast<char *>(allocate(s, vc, n));
+				if (v == nullptr) {return false; }
+				s.arena.deallocate(n->value.get(), n->valueClass);
+				n->value = v;
+				n->valueClass = vc;
+			}
+			write_value(n->value.get(), m);
+			s.updates.add();
+			return true;
+		}
+		if (s.count >= s.capacity) {evict(s); }
+		// the value first: it is the one that may need a big block
+		char *v = static_cast<char *>(allocate(s, vc, nullptr));
+		if (v == nullptr) {return false; }
+		void *p = allocate(s, nodeClass(), nullptr, v, vc);
+		if (p == nullptr) {
+			s.arena.deallocate(v, vc);
+			return false;
+		}
+		n = new (p) node;
+		n->hash = h;
+		n->key = frozen_key<Key>::store(key);
+		n->value = v;
+		n->valueClass = vc;
+		write_value(v, m);
+		offset_ptr<node> &bucket = s.buckets.get()[h & s.mask];
+		n->chain = bucket.get();
+		bucket = n;
+		link_tail(s, n);
+		++s.count;
+		s.inserts.add();
+		return true;
+	}
+	bool remove(const Key &key) {
+		uint64_t h = hash_of(key);
+		shard &s = shard_of(h);
+		guard g(*this, s);
+		node *n = find(s, key, h);
+		if (n == nullptr) {return false; }
+		erase(s, n);
+		return true;
+	}
+	size_t size() {
+		size_t n = 0;
+		for (size_t i = 0; i < head->shards; ++i) {
+			guard g(*this, shards[i]);
+			n += shards[i].count;
+		}
+		return n;
+	}
+	/**
+	 * counters of every process using the segment (0 without
+	 * SJTU_STATS), and the shape of the tables
+	*/
+	lru_stats stats() {
+		lru_stats st;
+		for (size_t i = 0; i < head->shards; ++i) {
+			shard &s = shards[i];
+			guard g(*this, s);
+			st.hits += s.hits.get();
+			st.misses += s.misses.get();
+			st.inserts += s.inserts.get();
+			st.updates += s.updates.get();
+			st.evictions += s.evictions.get();
+			st.weight += s.count;
+			st.capacity += s.capacity;
+			st.table.elements += s.count;
+			st.table.buckets += s.mask + 1;
+			st.table.bucket_bytes += (s.mask + 1) * sizeof(offset_ptr<node>);
+		}
+		return st;
+	}
+	/**
+	 * shards emptied because a process died holding their lock
+	*/
+	uint64_t recovered() {
+		uint64_t n = 0;
+		for (size_t i = 0; i < head->shards; ++i) {
+			guard g(*this, shards[i]);
+			n += shards[i].resets;
+		}
+		return n;
+	}
+	size_t bytes() const {
+		return length;
+	}
+
+private:
+	char *base = nullptr;
+	size_t length = 0;
+	header *head = nullptr;
+	shard *shards = nullptr;
+
+	/**
+	 * the shard lock; takes over the shard of a dead holder
+	*/
+	class guard{
+	public:
+		guard(shared_lru &owner, shard &s): s(s) {
+			int r = ::pthread_mutex_lock(&s.lock);
+			if (r == EOWNERDEAD) {
+				owner.reset(s);
+				++s.resets;
+				::pthread_mutex_consistent(&s.lock);
+			} else if (r != 0) {
+				throw runtime_error();
+			}
+		}
+		guard(const guard &other) = delete;
+		~guard() {
+			::pthread_mutex_unlock(&s.lock);
+		}
+	private:
+		shard &s;
+	};
+
+	static unsigned nodeClass() {
+		return segment_arena::size_class(sizeof(node));
+	}
+	static uint64_t hash_of(const Key &key) {
+		return pow2_hash_policy::mix(Hash()(key));
+	}
+	static size_t round_up(size_t n) {
+		return (n + 63) & ~size_t(63);
+	}
+	shard &shard_of(uint64_t h) {
+		return shards[(h >> 40) % head->shards];
+	}
+
+	void create(int fd, const char *name, size_t capacity, size_t bytes, size_t count) {
+		try {
+			size_t perShard = (capacity + count - 1) / count;
+			size_t buckets = 8;
+			while (buckets < perShard) {buckets <<= 1; }
+			size_t first = round_up(sizeof(header)) + round_up(count * sizeof(shard));
+			size_t region = bytes > first ? (bytes - first) / count & ~size_t(63) : 0;
+			size_t table = round_up(buckets * sizeof(offset_ptr<node>));
+			// room for at least a node and a small value besides the buckets
+			if (capacity == 0 || region < table + 4096 || ::ftruncate(fd, off_t(bytes)) != 0) {
+				::close(fd);
+				throw runtime_error();
+			}
+			map(fd, bytes);
+			head = new (base) header;
+			std::memcpy(head->magic, "SJSHLRU2", 8);
+			head->key_bytes = sizeof(stored_key);
+			head->elem_bytes = sizeof(E);
+			head->bytes = bytes;
+			head->capacity = capacity;
+			head->shards = count;
+			shards = reinterpret_cast<shard *>(base + round_up(sizeof(header)));
+			for (size_t i = 0; i < count; ++i) {
+				shard *s = new (shards + i) shard;
+				char *at = base + first + i * region;
+				s->buckets = new (at) offset_ptr<node>[buckets];
+				s->mask = buckets - 1;
+				s->capacity = perShard;
+				s->resets = 0;
+				s->arenaBegin = at + table;
+				s->arenaEnd = at + region;
+				reset(*s);
+				pthread_mutexattr_t attr;
+				::pthread_mutexattr_init(&attr);
+				::pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+				::pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+				int r = ::pthread_mutex_init(&s->lock, &attr);
+				::pthread_mutexattr_destroy(&attr);
+				if (r != 0) {throw runtime_error(); }
+			}
+			head->ready.store(1, std::memory_order_release);
+		} catch (...) {
+			if (base != nullptr) {::munmap(base, length); }
+			::shm_unlink(name);
+			throw;
+		}
+	}
+	/**
+	 * wait (up to 5 s) for the creator to size and fill the segment
+	*/
+	void attach(const char *name) {
+		int fd = ::shm_open(name, O_RDWR, 0);
+		if (fd < 0) {throw runtime_error(); }
+		struct stat st = {};
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (::fstat(fd, &st) == 0 && size_t(st.st_size) < sizeof(header)
+			&& std::chrono::steady_clock::now() < deadline) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		if (size_t(st.st_size) < sizeof(header)) {
+			::close(fd);
+			throw runtime_error();
+		}
+		map(fd, size_t(st.st_size));
+		head = reinterpret_cast<header *>(base);
+		while (head->ready.load(std::memory_order_acquire) == 0 && std::chrono::steady_clock::now() < deadline) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		if (head->ready.load(std::memory_order_acquire) == 0 || std::memcmp(head->magic, "SJSHLRU2", 8) != 0
+			|| head->key_bytes != sizeof(stored_key) || head->elem_bytes != sizeof(E) || head->bytes != length) {
+			::munmap(base, length);
+			throw runtime_error();
+		}
+		shards = reinterpret_cast<shard *>(base + round_up(sizeof(header)));
+	}
+	/**
+	 * map fd (and close it)
+	*/
+	void map(int fd, size_t bytes) {
+		void *p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (p == MAP_FAILED) {throw runtime_error(); }
+		base = static_cast<char *>(p);
+		length = bytes;
+	}
+
+	/**
+	 * forget every entry of s
+	*/
+	void reset(shard &s) {
+		offset_ptr<node> *b = s.buckets.get();
+		for (uint64_t i = 0; i <= s.mask; ++i) {b[i] = nullptr; }
+		s.head = nullptr;
+		s.tail = nullptr;
+		s.count = 0;
+		s.arena.reset(s.arenaBegin.get(), s.arenaEnd.get());
+	}
+	node *find(shard &s, const Key &key, uint64_t h) {
+		for (node *n = s.buckets.get()[h & s.mask].get(); n != nullptr; n = n->chain.get()) {
+			if (n->hash == h && Equal()(frozen_key<Key>::load(n->key), key)) {return n; }
+		}
+		return nullptr;
+	}
+	/**
+	 * a block of class c, evicting from the head of s until there is
+	 * one, but never keep (the tail) or the block held of class
+	 * heldClass; nullptr, with nothing evicted, if even evicting all the
+	 * rest would not give one
+	*/
+	void *allocate(shard &s, unsigned c, node *keep, const void *held = nullptr, unsigned heldClass = 0) {
+		void *p = s.arena.allocate(c);
+		if (p != nullptr) {return p; }
+		segment_arena::span spans[3];
+		size_t n = 0;
+		if (keep != nullptr) {
+			spans[n++] = {keep, nodeClass()};
+			if (keep->value) {spans[n++] = {keep->value.get(), keep->valueClass}; }
+		}
+		if (held != nullptr) {spans[n++] = {held, heldClass}; }
+		if (!s.arena.could_allocate(c, spans, n)) {return nullptr; }
+		while (p == nullptr && s.head && s.head.get() != keep) {
+			evict(s);
+			p = s.arena.allocate(c);
+		}
+		return p;
+	}
+	void evict(shard &s) {
+		erase(s, s.head.get());
+		s.evictions.add();
+	}
+	void erase(shard &s, node *n) {
+		offset_ptr<node> *link = &s.buckets.get()[n->hash & s.mask];
+		while (link->get() != n) {link = &link->get()->chain; }
+		*link = n->chain.get();
+		unlink_list(s, n);
+		if (n->value) {s.arena.deallocate(n->value.get(), n->valueClass); }
+		n->~node();
+		s.arena.deallocate(n, nodeClass());
+		--s.count;
+	}
+	void unlink_list(shard &s, node *n) {
+		node *prev = n->prev.get(), *next = n->next.get();
+		if (prev != nullptr) {prev->next = next; } else {s.head = next; }
+		if (next != nullptr) {next->prev = prev; } else {s.tail = prev; }
+	}
+	void link_tail(shard &s, node *n) {
+		n->prev = s.tail.get();
+		n->next = nullptr;
+		if (s.tail) {s.tail->next = n; } else {s.head = n; }
+		s.tail = n;
+	}
+	static void write_value(char *v, const Matrix<E> &m) {
+		uint64_t shape[2] = {m.RowSize(), m.ColSize()};
+		std::memcpy(v, shape, sizeof(shape));
+		E *elems = reinterpret_cast<E *>(v + sizeof(shape));
+		for (size_t r = 0; r < shape[0] && shape[1] != 0; ++r) {
+			std::memcpy(elems + r * shape[1], &m[r][0], shape[1] * sizeof(E));
+		}
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,253 @@
+#ifndef SJTU_SNAPSHOT_HPP
+#define SJTU_SNAPSHOT_HPP
+
+#include "lru.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace sjtu {
+
+/**
+ * binary snapshots of linked_hashmap and basic_lru, for warm restarts.
+ * a snapshot is the magic "SJSNAP01", the entry count (64 bits), then
+ * key and value of every entry in list order (least recent first),
+ * each written by its serializer.  files go through 1 MB buffers, and
+ * pieces larger than half of that go to the file directly.
+ * numbers are stored as they are in memory, so a snapshot is for the
+ * same build on the same kind of machine.
+*/
+
+/**
+ * how a key or value is written to a snapshot:
+ *   write(out, v)   out.write(bytes, n) its bytes
+ *   read(in)        build it back from in.read(bytes, n)
+ * trivially copyable types are copied as they are; specialise it for
+ * the others (as for Integer and Matrix here)
+*/
+template<class T> struct serializer{
+	static_assert(std::is_trivially_copyable<T>::value, "specialise sjtu::serializer for this type");
+	template<class Out>
+	static void write(Out &out, const T &v) {
+		out.write(&v, sizeof(T));
+	}
+	template<class In>
+	static T read(In &in) {
+		T v;
+		in.read(&v, sizeof(T));
+		return v;
+	}
+};
+template<> struct serializer<Integer>{
+	template<class Out>
+	static void write(Out &out, const Integer &v) {
+		out.write(&v.val, sizeof(v.val));
+	}
+	template<class In>
+	static Integer read(In &in) {
+		int val;
+		in.read(&val, sizeof(val));
+		return Integer(val);
+	}
+};
+/**
+ * rows and columns, then the elements a row at a time (one write per
+ * row when the elements are trivially copyable)
+*/
+template<class E> struct serializer<Matrix<E> >{
+	template<class Out>
+	static void write(Out &out, const Matrix<E> &m) {
+		uint64_t shape[2] = {m.RowSize(), m.ColSize()};
+		out.write(shape, sizeof(shape));
+		for (size_t i = 0; i < shape[0] && shape[1] != 0; ++i) {
+			if (std::is_trivially_copyable<E>::value) {
+				out.write(&m[i][0], shape[1] * sizeof(E));
+				continue;
+			}
+			for (size_t j = 0; j < shape[1]; ++j) {serializer<E>::write(out, m[i][j]); }
+		}
+	}
+	template<class In>
+	static Matrix<E> read(In &in) {
+		uint64_t shape[2];
+		in.read(shape, sizeof(shape));
+		Matrix<E> m(shape[0], shape[1]);
+		for (size_t i = 0; i < shape[0] && shape[1] != 0; ++i) {
+			if (std::is_trivially_copyable<E>::value) {
+				in.read(&m[i][0], shape[1] * sizeof(E));
+				continue;
+			}
+			for (size_t j = 0; j < shape[1]; ++j) {m[i][j] = serializer<E>::read(in); }
+		}
+		return m;
+	}
+};
+
+class snapshot_writer{
+public:
+	explicit snapshot_writer(const char *path): file(std::fopen(path, "wb")), buffer(1 << 20) {
+		if (file == nullptr) {throw runtime_error(); }
+		write("SJSNAP01", 8);
+	}
+	snapshot_writer(const snapshot_writer &other) = delete;
+	snapshot_writer & operator=(const snapshot_writer &other) = delete;
+	~snapshot_writer() {
+		if (file != nullptr) {std::fclose(file); }
+	}
+
+	void begin(uint64_t count) {
+		write(&count, sizeof(count));
+	}
+	template<class X>
+	void put(const X &x) {
+		serializer<X>::write(*this, x);
+	}
+	void write(const void *data, size_t n) {
+		if (used + n > buffer.size()) {flush(); }
+		if (n > buffer.size() / 2) {
+			check(std::fwrite(data, 1, n, file) == n);
+		} else {
+			std::memcpy(buffer.data() + used, data, n);
+			used += n;
+		}
+		written += n;
+	}
+	/**
+	 * write out the rest and wait until it is on the disk; throws if
+	 * anything failed on the way
+	*/
+	void close() {
+		flush();
+		bool ok = std::fflush(file) == 0 && ::fsync(::fileno(file)) == 0;
+		ok = std::fclose(file) == 0 && ok;
+		file = nullptr;
+		check(ok);
+	}
+	uint64_t bytes() const {
+		return written;
+	}
+
+private:
+	std::FILE *file;
+	std::vector<char> buffer;
+	size_t used = 0;
+	uint64_t written = 0;
+
+	void flush() {
+		check(std::fwrite(buffer.data(), 1, used, file) == used);
+		used = 0;
+	}
+	static void check(bool ok) {
+		if (!ok) {throw runtime_error(); }
+	}
+};
+
+class snapshot_reader{
+public:
+	explicit snapshot_reader(const char *path): file(std::fopen(path, "rb")), buffer(1 << 20) {
+		if (file == nullptr) {throw runtime_error(); }
+		char magic[8];
+		if (std::fread(magic, 1, 8, file) != 8 || std::memcmp(magic, "SJSNAP01", 8) != 0) {
+			std::fclose(file);
+			throw runtime_error();
+		}
+	}
+	snapshot_reader(const snapshot_reader &other) = delete;
+	snapshot_reader & operator=(const snapshot_reader &other) = delete;
+	~snapshot_reader() {
+		std::fclose(file);
+	}
+
+	uint64_t begin() {
+		uint64_t count;
+		read(&count, sizeof(count));
+		return count;
+	}
+	template<class X>
+	X get() {
+		return serializer<X>::read(*this);
+	}
+	/**
+	 * throws runtime_error if the file ends first
+	*/
+	void read(void *data, size_t n) {
+		char *to = static_cast<char *>(data);
+		size_t have = end - pos;
+		if (n <= have) {
+			std::memcpy(to, buffer.data() + pos, n);
+			pos += n;
+			return;
+		}
+		std::memcpy(to, buffer.data() + pos, have);
+		to += have, n -= have;
+		pos = end = 0;
+		if (n > buffer.size() / 2) {
+			if (std::fread(to, 1, n, file) != n) {throw runtime_error(); }
+			return;
+		}
+		end = std::fread(buffer.data(), 1, buffer.size(), file);
+		if (end < n) {throw runtime_error(); }
+		std::memcpy(to, buffer.data(), n);
+		pos = n;
+	}
+
+private:
+	std::FILE *file;
+	std::vector<char> buffer;
+	size_t pos = 0, end = 0;
+};
+
+/**
+ * fsync the directory of path, so that a rename in it is on the disk
+*/
+inline void sync_directory(const char *path) {
+	std::string dir(path);
+	size_t slash = dir.rfind('/');
+	dir = slash == std::string::npos ? "." : slash == 0 ? "/" : dir.substr(0, slash);
+	int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0) {throw runtime_error(); }
+	bool ok = ::fsync(fd) == 0;
+	::close(fd);
+	if (!ok) {throw runtime_error(); }
+}
+
+/**
+ * write map (a linked_hashmap or basic_lru) to path; the file is
+ * written next to it, synced, and renamed over it at the end (the
+ * directory synced too), so a crash leaves either the previous
+ * snapshot or the whole new one.  return the bytes written
+*/
+template<class Map>
+uint64_t save_snapshot(const Map &map, const char *path) {
+	std::string temp = std::string(path) + ".tmp";
+	uint64_t bytes;
+	try {
+		snapshot_writer out(temp.c_str());
+		map.write_to(out);
+		out.close();
+		bytes = out.bytes();
+		if (std::rename(temp.c_str(), path) != 0) {throw runtime_error(); }
+		sync_directory(path);
+	} catch (...) {
+		std::remove(temp.c_str());
+		throw;
+	}
+	return bytes;
+}
+/**
+ * load a snapshot of save_snapshot into map (see read_from of
+ * linked_hashmap and basic_lru)
+*/
+template<class Map>
+void load_snapshot(Map &map, const char *path) {
+	snapshot_reader in(path);
+	map.read_from(in);
+}
+
+}
+
+#endif
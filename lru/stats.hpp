@@ -0,0 +1,154 @@
+#ifndef SJTU_STATS_HPP
+#define SJTU_STATS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace sjtu {
+
+/**
+ * counters of the containers, compiled in with -DSJTU_STATS; without
+ * it stat_counter and stat_timer are empty and every count is 0.
+ * a counter is a relaxed atomic bumped by load + store, which is a
+ * plain add on the owning thread: exact with one writer (the
+ * containers are not thread safe anyway), possibly short by a few
+ * counts when readers of a concurrent_lru shard bump it together.
+ * add_shared() is the exact (and dearer) read-modify-write.
+*/
+#ifdef SJTU_STATS
+const bool stats_enabled = true;
+
+class stat_counter{
+public:
+	stat_counter() = default;
+	stat_counter(const stat_counter &other): value(other.get()) {}
+	stat_counter & operator=(const stat_counter &other) {
+		value.store(other.get(), std::memory_order_relaxed);
+		return *this;
+	}
+	void add(uint64_t n = 1) {
+		value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	}
+	void add_shared(uint64_t n = 1) {
+		value.fetch_add(n, std::memory_order_relaxed);
+	}
+	uint64_t get() const {
+		return value.load(std::memory_order_relaxed);
+	}
+private:
+	std::atomic<uint64_t> value{0};
+};
+
+/**
+ * adds the nanoseconds of its own lifetime to a counter
+*/
+class stat_timer{
+public:
+	explicit stat_timer(stat_counter &c): counter(c), start(std::chrono::steady_clock::now()) {}
+	~stat_timer() {
+		counter.add(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - start).count()));
+	}
+private:
+	stat_counter &counter;
+	std::chrono::steady_clock::time_point start;
+};
+#else
+const bool stats_enabled = false;
+
+class stat_counter{
+public:
+	void add(uint64_t = 1) {}
+	void add_shared(uint64_t = 1) {}
+	uint64_t get() const {return 0; }
+};
+
+class stat_timer{
+public:
+	explicit stat_timer(stat_counter &) {}
+};
+#endif
+
+/**
+ * snapshot of a hash table.
+ * the shape (chains, bytes) is measured when the snapshot is taken, so
+ * it is there without SJTU_STATS; the event counts need it.
+ * a chain is a bucket of chain_index, or for flat_hashmap the probe
+ * distance of an element (its chain length is that distance + 1)
+*/
+struct table_stats{
+	size_t elements = 0;
+	size_t buckets = 0;  // bucket or slot count
+	size_t chains = 0;  // non-empty buckets (flat: elements)
+	size_t chain_total = 0;  // sum of chain lengths (flat: of probe lengths)
+	size_t max_chain = 0;
+	uint64_t finds = 0;  // lookups
+	uint64_t probes = 0;  // nodes or slots looked at by them
+	uint64_t resizes = 0;  // expand / rehash / incremental resizes started
+	uint64_t resize_ns = 0;  // time spent relinking in them
+	size_t node_bytes = 0;  // nodes (flat: slot array)
+	size_t bucket_bytes = 0;  // bucket arrays (flat: probe metadata)
+
+	double load_factor() const {
+		return buckets == 0 ? 0 : double(elements) / buckets;
+	}
+	double mean_chain() const {
+		return chains == 0 ? 0 : double(chain_total) / chains;
+	}
+	double mean_probe() const {
+		return finds == 0 ? 0 : double(probes) / finds;
+	}
+	size_t bytes() const {
+		return node_bytes + bucket_bytes;
+	}
+	table_stats & operator+=(const table_stats &rhs) {
+		elements += rhs.elements;
+		buckets += rhs.buckets;
+		chains += rhs.chains;
+		chain_total += rhs.chain_total;
+		if (rhs.max_chain > max_chain) {max_chain = rhs.max_chain; }
+		finds += rhs.finds;
+		probes += rhs.probes;
+		resizes += rhs.resizes;
+		resize_ns += rhs.resize_ns;
+		node_bytes += rhs.node_bytes;
+		bucket_bytes += rhs.bucket_bytes;
+		return *this;
+	}
+};
+
+/**
+ * snapshot of an lru: its events (SJTU_STATS only) and its table
+*/
+struct lru_stats{
+	uint64_t hits = 0, misses = 0;  // get()
+	uint64_t inserts = 0, updates = 0;  // save / emplace of a new / present key
+	uint64_t evictions = 0;  // entries dropped for room
+	uint64_t expirations = 0;  // dead entries removed
+	size_t weight = 0, capacity = 0;
+	size_t policy_bytes = 0;  // eviction mode (ghosts, sketch)
+	table_stats table;
+
+	double hit_ratio() const {
+		return hits + misses == 0 ? 0 : double(hits) / (hits + misses);
+	}
+	lru_stats & operator+=(const lru_stats &rhs) {
+		hits += rhs.hits;
+		misses += rhs.misses;
+		inserts += rhs.inserts;
+		updates += rhs.updates;
+		evictions += rhs.evictions;
+		expirations += rhs.expirations;
+		weight += rhs.weight;
+		capacity += rhs.capacity;
+		policy_bytes += rhs.policy_bytes;
+		table += rhs.table;
+		return *this;
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,353 @@
+#ifndef SJTU_TRACE_HPP
+#define SJTU_TRACE_HPP
+
+#include "lru.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace sjtu {
+
+/**
+ * key traces of a cache, for offline sizing (tools/trace.cpp).
+ *
+ * a trace file is the magic "SJTRACE1" and then one varint per
+ * request: (zigzag(key - previous key) << 2) | op, so runs of nearby
+ * keys take a byte or two.  keys are 64-bit ids: integers as they are,
+ * other keys by their mixed hash (trace_id).
+ * op is one of
+ *   trace_get     a get (a miss leaves the cache alone)
+ *   trace_save    a save
+ *   trace_access  a get followed by a save on a miss
+*/
+enum trace_op: unsigned {trace_get = 0, trace_save = 1, trace_access = 2};
+
+struct trace_record{
+	trace_op op;
+	uint64_t key;
+};
+
+template<class Key, class Hash>
+uint64_t trace_id(const Key &key, const Hash &hash) {
+	return pow2_hash_policy::mix(hash(key));
+}
+template<class Hash>
+uint64_t trace_id(const Integer &key, const Hash &) {
+	return uint64_t((long long)key.val);
+}
+template<class Hash>
+uint64_t trace_id(const long long &key, const Hash &) {
+	return uint64_t(key);
+}
+template<class Hash>
+uint64_t trace_id(const unsigned long long &key, const Hash &) {
+	return key;
+}
+template<class Hash>
+uint64_t trace_id(const int &key, const Hash &) {
+	return uint64_t((long long)key);
+}
+
+/**
+ * appends records to a trace file, through a buffer of its own
+*/
+class trace_writer{
+public:
+	explicit trace_writer(const char *path): file(std::fopen(path, "wb")) {
+		if (file == nullptr) {throw runtime_error(); }
+		std::fwrite(magic, 1, 8, file);
+	}
+	trace_writer(const trace_writer &other) = delete;
+	trace_writer & operator=(const trace_writer &other) = delete;
+	~trace_writer() {
+		flush();
+		std::fclose(file);
+	}
+
+	void record(trace_op op, uint64_t key) {
+		if (used + 10 > sizeof(buffer)) {flush(); }
+		uint64_t delta = key - previous;
+		uint64_t zigzag = (delta << 1) ^ uint64_t(int64_t(delta) >> 63);
+		previous = key;
+		// op and the low 5 bits in the first byte, 7 bits a byte after
+		uint64_t rest = zigzag >> 5;
+		buffer[used++] = (unsigned char)(op | (zigzag & 0x1f) << 2 | (rest != 0 ? 0x80 : 0));
+		for (; rest != 0; rest >>= 7) {
+			buffer[used++] = (unsigned char)((rest & 0x7f) | (rest >= 0x80 ? 0x80 : 0));
+		}
+		++count;
+	}
+	void flush() {
+		std::fwrite(buffer, 1, used, file);
+		used = 0;
+		std::fflush(file);
+	}
+	uint64_t records() const {
+		return count;
+	}
+
+	static constexpr const char *magic = "SJTRACE1";
+
+private:
+	std::FILE *file;
+	unsigned char buffer[1 << 16];
+	size_t used = 0;
+	uint64_t previous = 0, count = 0;
+};
+
+/**
+ * streams the records of a trace file back, a buffer at a time
+*/
+class trace_reader{
+public:
+	explicit trace_reader(const char *path): file(std::fopen(path, "rb")) {
+		char head[8];
+		if (file == nullptr || std::fread(head, 1, 8, file) != 8 || std::memcmp(head, trace_writer::magic, 8) != 0) {
+			if (file != nullptr) {std::fclose(file); }
+			throw runtime_error();
+		}
+	}
+	trace_reader(const trace_reader &other) = delete;
+	trace_reader & operator=(const trace_reader &other) = delete;
+	~trace_reader() {
+		std::fclose(file);
+	}
+
+	/**
+	 * read the next record; false at the end of the file
+	*/
+	bool next(trace_record &r) {
+		int byte = get();
+		if (byte < 0) {return false; }
+		r.op = trace_op(byte & 3);
+		uint64_t zigzag = uint64_t(byte >> 2 & 0x1f);
+		for (unsigned shift = 5; byte & 0x80; shift += 7) {
+			// a record cut short by the end of the file is dropped
+			if ((byte = get()) < 0) {return false; }
+			if (shift < 64) {zigzag |= uint64_t(byte & 0x7f) << shift; }
+		}
+		previous += (zigzag >> 1) ^ (0 - (zigzag & 1));
+		r.key = previous;
+		return true;
+	}
+
+private:
+	std::FILE *file;
+	unsigned char buffer[1 << 16];
+	size_t pos = 0, end = 0;
+	uint64_t previous = 0;
+
+	int get() {
+		if (pos == end) {
+			end = std::fread(buffer, 1, sizeof(buffer), file);
+			pos = 0;
+			if (end == 0) {return -1; }
+		}
+		return buffer[pos++];
+	}
+};
+
+/**
+ * a cache that writes every get / save to a trace_writer;
+ * Cache is a basic_lru (or anything with its get / save)
+*/
+template<class Cache, class Hash = ::Hash> class traced: public Cache{
+public:
+	template<class... Args>
+	explicit traced(trace_writer &w, Args &&... args): Cache(std::forward<Args>(args)...), out(w) {}
+
+	template<class K>
+	auto get(const K &key) {
+		out.record(trace_get, trace_id(key, Hash()));
+		return Cache::get(key);
+	}
+	template<class V>
+	bool save(V &&v) {
+		out.record(trace_save, trace_id(v.first, Hash()));
+		return Cache::save(std::forward<V>(v));
+	}
+
+private:
+	trace_writer &out;
+};
+
+/**
+ * order-statistic tree over the slots 0 .. n-1, each empty or full,
+ * laid out implicitly in an array (a Fenwick tree): insert, erase and
+ * count_greater are O(log n) with no pointers to chase, and the top
+ * levels that every query passes through stay in cache
+*/
+class order_statistic_tree{
+public:
+	explicit order_statistic_tree(size_t n = 0): tree(n + 1, 0) {}
+
+	size_t slots() const {
+		return tree.size() - 1;
+	}
+	size_t size() const {
+		return count;
+	}
+	void insert(size_t slot) {
+		add(slot, 1);
+		++count;
+	}
+	void erase(size_t slot) {
+		add(slot, uint32_t(-1));
+		--count;
+	}
+	/**
+	 * number of full slots after `slot`
+	*/
+	size_t count_greater(size_t slot) const {
+		size_t n = 0;
+		for (size_t i = slot + 1; i > 0; i -= i & (0 - i)) {n += tree[i]; }
+		return count - n;
+	}
+	/**
+	 * start over with n slots, of which the first `full` are full
+	*/
+	void assign(size_t n, size_t full) {
+		tree.assign(n + 1, 0);
+		for (size_t i = 1; i <= full; ++i) {tree[i] = 1; }
+		for (size_t i = 1; i <= n; ++i) {
+			size_t up = i + (i & (0 - i));
+			if (up <= n) {tree[up] += tree[i]; }
+		}
+		count = full;
+	}
+	size_t bytes() const {
+		return tree.capacity() * sizeof(uint32_t);
+	}
+
+private:
+	std::vector<uint32_t> tree;  // 1-based
+	size_t count = 0;
+
+	void add(size_t slot, uint32_t d) {
+		for (size_t i = slot + 1; i < tree.size(); i += i & (0 - i)) {tree[i] += d; }
+	}
+};
+
+/**
+ * Mattson's lru stack distances in one pass: the distance of a
+ * reference is the number of distinct other keys referenced since the
+ * previous reference to its key (cold for a first reference), and an
+ * lru of capacity c hits exactly the references with distance < c.
+ * every reference takes the next time slot and frees the previous
+ * slot of its key, so the distance is the number of full slots after
+ * that one.  a hashmap gives the slot of each key; when the slots run
+ * out the full ones are packed to the front (amortized O(1), and the
+ * slots stay within 4x the distinct keys).
+*/
+class stack_distance{
+public:
+	static const uint64_t cold = ~uint64_t(0);
+
+	stack_distance(): times(1 << 16), owner(1 << 16) {}
+
+	uint64_t reference(uint64_t key) {
+		if (next == owner.size()) {compact(); }
+		auto it = last.find(key);
+		uint64_t distance = cold;
+		if (it == last.end()) {
+			last.insert(pair<const uint64_t, uint64_t>(key, next));
+		} else {
+			distance = times.count_greater(it->second);
+			times.erase(it->second);
+			it->second = next;
+		}
+		times.insert(next);
+		owner[next++] = key;
+		return distance;
+	}
+	/**
+	 * drop key, as if it had never been referenced
+	*/
+	void forget(uint64_t key) {
+		auto it = last.find(key);
+		if (it == last.end()) {return; }
+		times.erase(it->second);
+		last.remove(key);
+	}
+	size_t distinct() const {
+		return times.size();
+	}
+	size_t bytes() const {
+		return times.bytes() + owner.capacity() * sizeof(uint64_t) + last.stats().bytes();
+	}
+
+private:
+	hashmap<uint64_t, uint64_t> last;  // key -> its slot
+	order_statistic_tree times;
+	std::vector<uint64_t> owner;  // slot -> key, for packing
+	size_t next = 0;
+
+	void compact() {
+		size_t live = 0;
+		for (size_t slot = 0; slot < next; ++slot) {
+			auto it = last.find(owner[slot]);
+			if (it == last.end() || it->second != slot) {continue; }
+			it->second = live;
+			owner[live++] = owner[slot];
+		}
+		size_t n = owner.size();
+		if (live * 2 > n) {n *= 2; }
+		owner.resize(n);
+		times.assign(n, live);
+		next = live;
+	}
+};
+
+/**
+ * histogram of stack distances, read as a miss-ratio curve
+*/
+class miss_ratio_curve{
+public:
+	void add(uint64_t distance) {
+		++total;
+		if (distance == stack_distance::cold) {
+			++coldMisses;
+			return;
+		}
+		if (distance >= hist.size()) {hist.resize(distance + 1, 0); }
+		++hist[distance];
+	}
+	uint64_t requests() const {
+		return total;
+	}
+	uint64_t cold_misses() const {
+		return coldMisses;
+	}
+	/**
+	 * past this capacity only cold misses are left
+	*/
+	size_t max_useful_capacity() const {
+		return hist.size();
+	}
+	/**
+	 * miss ratio of an lru with `capacity` entries, for capacities
+	 * 1 .. max_useful_capacity() in order
+	*/
+	std::vector<double> curve() const {
+		std::vector<double> ratio(hist.size());
+		uint64_t hits = 0;
+		for (size_t c = 0; c < hist.size(); ++c) {
+			hits += hist[c];
+			ratio[c] = total == 0 ? 0 : 1.0 - double(hits) / total;
+		}
+		return ratio;
+	}
+	double miss_ratio(size_t capacity) const {
+		uint64_t hits = 0;
+		for (size_t d = 0; d < capacity && d < hist.size(); ++d) {hits += hist[d]; }
+		return total == 0 ? 0 : 1.0 - double(hits) / total;
+	}
+
+private:
+	std::vector<uint64_t> hist;
+	uint64_t total = 0, coldMisses = 0;
+};
+
+}
+
+#endif
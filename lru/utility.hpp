@@ -2,6 +2,8 @@
 #define SJTU_UTILITY_HPP
 
 #include <utility>
+#include <tuple>
+#include <cstddef>
 namespace sjtu {
 
 template<class T1, class T2>
@@ -12,11 +14,22 @@ public:
 	constexpr pair() : first(), second() {}
 	pair(const T1 &x, const T2 &y) : first(x), second(y) {}
 	template<class U1, class U2>
-	pair(U1 &&x, U2 &&y) : first(x), second(y) {}
+	pair(U1 &&x, U2 &&y) : first(std::forward<U1>(x)), second(std::forward<U2>(y)) {}
 	template<class U1, class U2>
 	pair(const pair<U1, U2> &other) : first(other.first), second(other.second) {}
 	template<class U1, class U2>
-	pair(pair<U1, U2> &&other) : first(other.first), second(other.second) {}
+	pair(pair<U1, U2> &&other) : first(std::forward<U1>(other.first)), second(std::forward<U2>(other.second)) {}
+	/**
+	 * build first and second in place from the two argument tuples
+	*/
+	template<class... Args1, class... Args2>
+	pair(std::piecewise_construct_t, std::tuple<Args1...> args1, std::tuple<Args2...> args2)
+		: pair(args1, args2, std::index_sequence_for<Args1...>(), std::index_sequence_for<Args2...>()) {}
+
+private:
+	template<class Tuple1, class Tuple2, std::size_t... I1, std::size_t... I2>
+	pair(Tuple1 &args1, Tuple2 &args2, std::index_sequence<I1...>, std::index_sequence<I2...>)
+		: first(std::get<I1>(std::move(args1))...), second(std::get<I2>(std::move(args2))...) {}
 };
 
 }
@@ -0,0 +1,178 @@
+/**
+ * the lru as a local cache daemon over Unix domain sockets, and a load
+ * generator for it (lru/cache-server.hpp has the protocol).
+ * build: g++ -std=c++17 -O2 -pthread -I../lru cached.cpp -o cached
+ * usage:
+ *   ./cached serve path [shards] [megabytes]
+ *       serve on path.0 .. path.(shards - 1), one shard per core
+ *       (default: hardware threads, 256 MB in all), until SIGINT or
+ *       SIGTERM
+ *   ./cached load path shards [clients] [ops] [depth] [keys] [bytes] [gets]
+ *       run `clients` threads (default 4), each with its own
+ *       connections, for `ops` requests in all (default 1000000) sent
+ *       `depth` at a time (default 16) over `keys` keys (default
+ *       100000, uniform, all set once first) of values of `bytes`
+ *       (default 100); `gets` percent are gets (default 90), the rest
+ *       sets
+ *   ./cached bench [shards] [clients] [ops] [depth] [keys] [bytes] [gets]
+ *       serve in this process on a socket in /tmp and load it
+ * output of load and bench: csv clients,depth,ops,seconds,kops_per_s,
+ *   hit_ratio,p50_us,p90_us,p99_us,p999_us,max_us; a latency is from
+ *   sending the batch of a request to reading its reply.
+*/
+#include "cache-server.hpp"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+struct load_options{
+	size_t clients = 4, ops = 1000000, depth = 16, keys = 100000, bytes = 100, gets = 90;
+};
+
+size_t arg(int argc, char **argv, int i, size_t otherwise) {
+	return argc > i ? std::strtoull(argv[i], nullptr, 10) : otherwise;
+}
+
+load_options parse_load(int argc, char **argv, int first) {
+	load_options o;
+	o.clients = std::max<size_t>(1, arg(argc, argv, first, o.clients));
+	o.ops = arg(argc, argv, first + 1, o.ops);
+	o.depth = std::max<size_t>(1, arg(argc, argv, first + 2, o.depth));
+	o.keys = std::max<size_t>(1, arg(argc, argv, first + 3, o.keys));
+	o.bytes = arg(argc, argv, first + 4, o.bytes);
+	o.gets = std::min<size_t>(100, arg(argc, argv, first + 5, o.gets));
+	return o;
+}
+
+std::string key_of(size_t i) {
+	return "key:" + std::to_string(i);
+}
+
+/**
+ * one client thread: its share of the ops, latencies in ns
+*/
+void drive(const std::string &path, size_t shards, const load_options &o, size_t ops, unsigned seed,
+	std::vector<uint32_t> &latency, size_t &hits, size_t &gets) {
+	sjtu::cache_client client(path, shards);
+	std::mt19937_64 rng(seed);
+	std::string value(o.bytes, 'v');
+	std::vector<bool> is_get(o.depth);
+	latency.reserve(ops);
+	for (size_t done = 0; done < ops; ) {
+		size_t batch = std::min(o.depth, ops - done);
+		for (size_t i = 0; i < batch; ++i) {
+			std::string key = key_of(rng() % o.keys);
+			is_get[i] = rng() % 100 < o.gets;
+			if (is_get[i]) {
+				client.send_get(key);
+			} else {
+				client.send_set(key, value);
+			}
+		}
+		auto start = Clock::now();
+		for (size_t i = 0; i < batch; ++i) {
+			sjtu::cache_reply r = client.receive();
+			latency.push_back(uint32_t(std::min<int64_t>(
+				std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count(), ~0u)));
+			if (is_get[i]) {
+				++gets;
+				hits += r.status == sjtu::cache_ok;
+			}
+		}
+		done += batch;
+	}
+}
+
+int load(const std::string &path, size_t shards, const load_options &o) {
+	try {
+		// every key once, so that gets may hit
+		sjtu::cache_client filler(path, shards);
+		std::string value(o.bytes, 'v');
+		for (size_t i = 0; i < o.keys; ++i) {
+			filler.send_set(key_of(i), value);
+			if (filler.in_flight() >= 256) {filler.receive(); }
+		}
+		while (filler.in_flight() != 0) {filler.receive(); }
+
+		std::vector<std::vector<uint32_t> > latency(o.clients);
+		std::vector<size_t> hits(o.clients), gets(o.clients);
+		std::vector<std::thread> threads;
+		auto start = Clock::now();
+		for (size_t t = 0; t < o.clients; ++t) {
+			size_t ops = o.ops / o.clients + (t < o.ops % o.clients);
+			threads.emplace_back([&, t, ops] {drive(path, shards, o, ops, unsigned(t + 1), latency[t], hits[t], gets[t]); });
+		}
+		for (auto &t: threads) {t.join(); }
+		double sec = std::chrono::duration<double>(Clock::now() - start).count();
+
+		std::vector<uint32_t> all;
+		size_t hit = 0, get = 0;
+		for (size_t t = 0; t < o.clients; ++t) {
+			all.insert(all.end(), latency[t].begin(), latency[t].end());
+			hit += hits[t];
+			get += gets[t];
+		}
+		std::sort(all.begin(), all.end());
+		auto at = [&all](double q) {return all.empty() ? 0.0 : all[size_t(q * double(all.size() - 1))] / 1e3; };
+		std::cout << "clients,depth,ops,seconds,kops_per_s,hit_ratio,p50_us,p90_us,p99_us,p999_us,max_us" << std::endl;
+		std::cout << o.clients << "," << o.depth << "," << all.size() << "," << sec << "," << all.size() / sec / 1e3 << ","
+			<< (get != 0 ? double(hit) / get : 0) << "," << at(0.5) << "," << at(0.9) << "," << at(0.99) << ","
+			<< at(0.999) << "," << at(1) << std::endl;
+	} catch (const sjtu::exception &) {
+		std::cerr << "cannot talk to the server at " << path << ".*" << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+int serve(const std::string &path, size_t shards, size_t megabytes) {
+	sigset_t stop;
+	sigemptyset(&stop);
+	sigaddset(&stop, SIGINT);
+	sigaddset(&stop, SIGTERM);
+	// the shard threads inherit the mask, so the signal waits for sigwait
+	pthread_sigmask(SIG_BLOCK, &stop, nullptr);
+	try {
+		sjtu::cache_server server(path, shards, megabytes << 20);
+		std::cerr << "serving " << server.shards() << " shards on " << path << ".*" << std::endl;
+		int sig;
+		sigwait(&stop, &sig);
+	} catch (const sjtu::exception &) {
+		std::cerr << "cannot listen on " << path << ".*" << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	std::string command = argc > 1 ? argv[1] : "";
+	size_t cores = std::max(1u, std::thread::hardware_concurrency());
+	if (command == "serve" && argc > 2) {
+		return serve(argv[2], std::max<size_t>(1, arg(argc, argv, 3, cores)), arg(argc, argv, 4, 256));
+	}
+	if (command == "load" && argc > 3) {
+		return load(argv[2], std::max<size_t>(1, arg(argc, argv, 3, 1)), parse_load(argc, argv, 4));
+	}
+	if (command == "bench") {
+		size_t shards = std::max<size_t>(1, arg(argc, argv, 2, cores));
+		std::string path = "/tmp/sjtu-cached-" + std::to_string(getpid());
+		try {
+			sjtu::cache_server server(path, shards, size_t(256) << 20);
+			return load(path, shards, parse_load(argc, argv, 3));
+		} catch (const sjtu::exception &) {
+			std::cerr << "cannot listen on " << path << ".*" << std::endl;
+			return 1;
+		}
+	}
+	std::cerr << "usage: cached serve path [shards] [megabytes]" << std::endl
+		<< "       cached load path shards [clients] [ops] [depth] [keys] [bytes] [gets]" << std::endl
+		<< "       cached bench [shards] [clients] [ops] [depth] [keys] [bytes] [gets]" << std::endl;
+	return 2;
+}
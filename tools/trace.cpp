@@ -0,0 +1,184 @@
+/**
+ * cache sizing from key traces (lru/trace.hpp).
+ * build: g++ -std=c++17 -O2 -I../lru trace.cpp -o trace
+ * usage:
+ *   ./trace convert text log
+ *       text is whitespace separated integer keys, each an access
+ *       (get, and save on a miss); a key may be prefixed by g or s
+ *       for a plain get or save.  "-" reads stdin.
+ *   ./trace mrc log [points]
+ *       the lru miss-ratio curve for every capacity, in one pass:
+ *       csv capacity,miss_ratio at up to `points` (default 64)
+ *       capacities spread geometrically, plus the last useful one
+ *   ./trace replay log capacity,... [mode,...]
+ *       simulate the eviction modes (default all of lru, clock, fifo,
+ *       slru, 2q, arc, tinylfu) at each capacity, all in the same pass,
+ *       next to the stack-distance prediction (mode "mattson"):
+ *       csv mode,capacity,requests,miss_ratio
+ * the log is read a buffer at a time, so traces larger than memory are
+ * fine; memory grows with the distinct keys (and the capacities).
+ * gets and accesses are the requests; saves only move their key.
+ * the curve assumes demand fill, every miss followed by a save of its
+ * key (as with accesses); it is exact for the lru mode then.
+*/
+#include "trace.hpp"
+#include "eviction.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using key_type = unsigned long long;
+using value_type = sjtu::pair<const key_type, unsigned char>;
+
+/**
+ * one cache of the replay
+*/
+struct simulator{
+	std::string mode;
+	size_t capacity;
+	uint64_t requests = 0, misses = 0;
+
+	simulator(const std::string &mode, size_t capacity): mode(mode), capacity(capacity) {}
+	virtual ~simulator() {}
+	virtual void replay(const sjtu::trace_record &r) = 0;
+};
+
+template<template<class> class Eviction>
+struct mode_simulator: simulator{
+	sjtu::basic_lru<key_type, unsigned char, std::hash<key_type>, std::equal_to<key_type>,
+		std::allocator<value_type>, sjtu::pow2_hash_policy, Eviction> cache;
+
+	mode_simulator(const std::string &mode, size_t capacity): simulator(mode, capacity), cache(capacity) {
+		cache.reserve(capacity);
+	}
+	void replay(const sjtu::trace_record &r) override {
+		if (r.op == sjtu::trace_save) {
+			cache.save(value_type(r.key, 0));
+			return;
+		}
+		++requests;
+		if (cache.get(r.key) != nullptr) {return; }
+		++misses;
+		if (r.op == sjtu::trace_access) {cache.save(value_type(r.key, 0)); }
+	}
+};
+
+std::unique_ptr<simulator> make_simulator(const std::string &mode, size_t capacity) {
+	simulator *s = nullptr;
+	if (mode == "lru") {s = new mode_simulator<sjtu::lru_eviction>(mode, capacity); }
+	else if (mode == "clock") {s = new mode_simulator<sjtu::clock_eviction>(mode, capacity); }
+	else if (mode == "fifo") {s = new mode_simulator<sjtu::fifo_eviction>(mode, capacity); }
+	else if (mode == "slru") {s = new mode_simulator<sjtu::slru_eviction>(mode, capacity); }
+	else if (mode == "2q") {s = new mode_simulator<sjtu::two_queue_eviction>(mode, capacity); }
+	else if (mode == "arc") {s = new mode_simulator<sjtu::arc_eviction>(mode, capacity); }
+	else if (mode == "tinylfu") {s = new mode_simulator<sjtu::tinylfu_eviction>(mode, capacity); }
+	return std::unique_ptr<simulator>(s);
+}
+
+std::vector<std::string> split(const std::string &s) {
+	std::vector<std::string> parts;
+	size_t begin = 0;
+	for (size_t comma; (comma = s.find(',', begin)) != std::string::npos; begin = comma + 1) {
+		parts.push_back(s.substr(begin, comma - begin));
+	}
+	parts.push_back(s.substr(begin));
+	return parts;
+}
+
+int convert(const char *text, const char *log) {
+	std::ifstream file;
+	if (std::string(text) != "-") {
+		file.open(text);
+		if (!file) {
+			std::cerr << "cannot read " << text << std::endl;
+			return 1;
+		}
+	}
+	std::istream &in = std::string(text) == "-" ? std::cin : file;
+	sjtu::trace_writer out(log);
+	for (std::string word; in >> word; ) {
+		sjtu::trace_op op = sjtu::trace_access;
+		size_t at = 0;
+		if (word[0] == 'g') {op = sjtu::trace_get, at = 1; }
+		else if (word[0] == 's') {op = sjtu::trace_save, at = 1; }
+		out.record(op, (uint64_t)std::strtoll(word.c_str() + at, nullptr, 10));
+	}
+	std::cerr << out.records() << " records" << std::endl;
+	return 0;
+}
+
+int mrc(const char *log, size_t points) {
+	sjtu::trace_reader in(log);
+	sjtu::stack_distance stack;
+	sjtu::miss_ratio_curve curve;
+	for (sjtu::trace_record r; in.next(r); ) {
+		uint64_t d = stack.reference(r.key);
+		if (r.op != sjtu::trace_save) {curve.add(d); }
+	}
+	std::vector<double> ratio = curve.curve();
+	std::cerr << curve.requests() << " requests, " << stack.distinct() << " keys, "
+		<< curve.cold_misses() << " cold misses" << std::endl;
+	std::cout << "capacity,miss_ratio" << std::endl;
+	size_t last = 0;
+	for (size_t i = 0; i < points && !ratio.empty(); ++i) {
+		size_t c = points == 1 ? ratio.size()
+			: (size_t)std::llround(std::pow(double(ratio.size()), double(i) / (points - 1)));
+		if (c <= last) {continue; }
+		std::cout << c << "," << ratio[c - 1] << std::endl;
+		last = c;
+	}
+	return 0;
+}
+
+int replay(const char *log, const std::string &capacities, const std::string &modes) {
+	std::vector<size_t> sizes;
+	for (auto &s: split(capacities)) {sizes.push_back(std::strtoull(s.c_str(), nullptr, 10)); }
+	std::vector<std::unique_ptr<simulator> > sims;
+	for (auto &m: split(modes)) {
+		for (auto c: sizes) {
+			sims.push_back(make_simulator(m, c));
+			if (!sims.back()) {
+				std::cerr << "unknown mode " << m << std::endl;
+				return 1;
+			}
+		}
+	}
+	sjtu::trace_reader in(log);
+	sjtu::stack_distance stack;
+	sjtu::miss_ratio_curve curve;
+	for (sjtu::trace_record r; in.next(r); ) {
+		uint64_t d = stack.reference(r.key);
+		if (r.op != sjtu::trace_save) {curve.add(d); }
+		for (auto &s: sims) {s->replay(r); }
+	}
+	std::cout << "mode,capacity,requests,miss_ratio" << std::endl;
+	for (auto c: sizes) {
+		std::cout << "mattson," << c << "," << curve.requests() << "," << curve.miss_ratio(c) << std::endl;
+	}
+	for (auto &s: sims) {
+		std::cout << s->mode << "," << s->capacity << "," << s->requests << ","
+			<< (s->requests == 0 ? 0 : double(s->misses) / s->requests) << std::endl;
+	}
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	std::string cmd = argc > 1 ? argv[1] : "";
+	try {
+		if (cmd == "convert" && argc == 4) {return convert(argv[2], argv[3]); }
+		if (cmd == "mrc" && (argc == 3 || argc == 4)) {
+			return mrc(argv[2], argc == 4 ? std::strtoull(argv[3], nullptr, 10) : 64);
+		}
+		if (cmd == "replay" && (argc == 4 || argc == 5)) {
+			return replay(argv[2], argv[3], argc == 5 ? argv[4] : "lru,clock,fifo,slru,2q,arc,tinylfu");
+		}
+	} catch (const sjtu::exception &) {
+		std::cerr << "cannot open or parse the log" << std::endl;
+		return 1;
+	}
+	std::cerr << "usage: " << argv[0] << " convert text log | mrc log [points] | replay log capacity,... [mode,...]" << std::endl;
+	return 1;
+}